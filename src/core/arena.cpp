@@ -0,0 +1,184 @@
+// Headers
+#include "core/core.hpp"
+#include "arena.hpp"
+
+thread_local shared_ptr<Raytracing::MemoryArena> Raytracing::MemoryArena::active = nullptr;
+
+Raytracing::MemoryArena::MemoryArena(size_t block_size, bool huge_pages) : block_size(block_size), huge_pages(huge_pages)
+{
+    if (huge_pages && !enable_huge_pages())
+    {
+        Logger::warn("ARENA", "Huge pages are not available (missing \"Lock pages in memory\" privilege?). Falling back to regular pages.");
+        this->huge_pages = false;
+    }
+}
+
+Raytracing::MemoryArena::~MemoryArena()
+{
+    for (const auto& b : blocks)
+        release_block(b);
+}
+
+void* Raytracing::MemoryArena::allocate(size_t bytes, size_t alignment)
+{
+    auto align = [alignment](std::byte* p)
+    {
+        return reinterpret_cast<std::byte*>((reinterpret_cast<uintptr_t>(p) + alignment - 1) & ~(uintptr_t(alignment) - 1));
+    };
+
+    // Big requests get a block of their own so the current block is not abandoned half empty
+    if (bytes > block_size / 8)
+    {
+        bytes_used += bytes;
+        return align(new_block(bytes + alignment).data);
+    }
+
+    std::byte* p = align(cursor);
+
+    if (!cursor || p + bytes > limit)
+    {
+        allocate_block(bytes + alignment);
+        p = align(cursor);
+    }
+
+    cursor = p + bytes;
+    bytes_used += bytes;
+
+    return p;
+}
+
+size_t Raytracing::MemoryArena::get_bytes_used() const
+{
+    return bytes_used;
+}
+
+size_t Raytracing::MemoryArena::get_bytes_reserved() const
+{
+    return bytes_reserved;
+}
+
+size_t Raytracing::MemoryArena::get_block_count() const
+{
+    return blocks.size();
+}
+
+bool Raytracing::MemoryArena::uses_huge_pages() const
+{
+    return huge_pages;
+}
+
+string Raytracing::MemoryArena::to_string() const
+{
+    return std::format("{:.2f} MB used in {} blocks ({:.2f} MB reserved{})",
+        double(bytes_used) / (1 << 20), blocks.size(), double(bytes_reserved) / (1 << 20), huge_pages ? ", huge pages" : "");
+}
+
+Raytracing::MemoryArena::Scope::Scope(const shared_ptr<MemoryArena>& arena) : previous(active)
+{
+    active = arena;
+}
+
+Raytracing::MemoryArena::Scope::~Scope()
+{
+    active = previous;
+}
+
+const shared_ptr<Raytracing::MemoryArena>& Raytracing::MemoryArena::current()
+{
+    return active;
+}
+
+void Raytracing::MemoryArena::allocate_block(size_t min_size)
+{
+    const block& b = new_block(std::max(block_size, min_size));
+
+    cursor = b.data;
+    limit = b.data + b.size;
+}
+
+const Raytracing::MemoryArena::block& Raytracing::MemoryArena::new_block(size_t size)
+{
+    block b = { nullptr, size, false };
+
+    if (huge_pages)
+    {
+        b.data = allocate_huge_pages(b.size);
+        b.huge_pages = b.data != nullptr;
+    }
+
+    if (!b.data)
+        b.data = static_cast<std::byte*>(::operator new(b.size, std::align_val_t(block_alignment)));
+
+    blocks.push_back(b);
+    bytes_reserved += b.size;
+
+    return blocks.back();
+}
+
+std::byte* Raytracing::MemoryArena::allocate_huge_pages(size_t& size)
+{
+#ifdef _WIN32
+    const size_t page_size = GetLargePageMinimum();
+
+    if (page_size == 0)
+        return nullptr;
+
+    const size_t rounded_size = (size + page_size - 1) / page_size * page_size;
+    void* data = VirtualAlloc(nullptr, rounded_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+    // Large pages can run out when physical memory is fragmented, regular pages are used then
+    if (!data)
+        return nullptr;
+
+    size = rounded_size;
+
+    return static_cast<std::byte*>(data);
+#else
+    return nullptr;
+#endif
+}
+
+void Raytracing::MemoryArena::release_block(const block& b)
+{
+#ifdef _WIN32
+    if (b.huge_pages)
+    {
+        VirtualFree(b.data, 0, MEM_RELEASE);
+        return;
+    }
+#endif
+
+    ::operator delete(b.data, std::align_val_t(block_alignment));
+}
+
+bool Raytracing::MemoryArena::enable_huge_pages()
+{
+#ifdef _WIN32
+    // The privilege only has to be enabled once per process
+    static const bool enabled = []()
+    {
+        if (GetLargePageMinimum() == 0)
+            return false;
+
+        HANDLE token;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+            return false;
+
+        TOKEN_PRIVILEGES privileges = {};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+        bool success = LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)
+                    && AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr)
+                    && GetLastError() == ERROR_SUCCESS; // AdjustTokenPrivileges succeeds even when the privilege is not held
+
+        CloseHandle(token);
+
+        return success;
+    }();
+
+    return enabled;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+// Headers
+#include "core/core.hpp"
+
+namespace Raytracing
+{
+    // Bump allocator that owns the objects of one scene. Memory is carved from large blocks and only given back when
+    // the arena is destroyed, so building a scene costs a pointer increment per object and tearing it down costs one
+    // release per block. Objects allocated consecutively (a BVH built depth first, the triangles of a surface) end up
+    // next to each other in memory.
+    // Blocks can be backed by huge pages (Windows large pages, which need the "Lock pages in memory" privilege). When
+    // they are not available the arena silently falls back to regular pages.
+    // An arena is not thread safe: it is filled by the thread that opened its Scope.
+    class MemoryArena
+    {
+    public:
+        static constexpr size_t default_block_size = size_t(2) << 20;   // 2 MB, the x64 large page size
+
+        MemoryArena(size_t block_size = default_block_size, bool huge_pages = false);
+        ~MemoryArena();
+
+        MemoryArena(const MemoryArena&) = delete;
+        MemoryArena& operator=(const MemoryArena&) = delete;
+
+        void* allocate(size_t bytes, size_t alignment);
+
+        size_t get_bytes_used() const;
+        size_t get_bytes_reserved() const;
+        size_t get_block_count() const;
+        bool uses_huge_pages() const;
+        string to_string() const;
+
+        // Arena used by make_arena_shared on the current thread while the scope is alive. Scopes nest.
+        class Scope
+        {
+        public:
+            Scope(const shared_ptr<MemoryArena>& arena);
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            shared_ptr<MemoryArena> previous;
+        };
+
+        static const shared_ptr<MemoryArena>& current();
+
+    private:
+        struct block
+        {
+            std::byte* data;
+            size_t size;
+            bool huge_pages;
+        };
+
+        static constexpr size_t block_alignment = 64;           // Regular blocks start on a cache line
+
+        vector<block> blocks;
+        std::byte* cursor = nullptr;
+        std::byte* limit = nullptr;
+
+        size_t block_size;
+        size_t bytes_used = 0;
+        size_t bytes_reserved = 0;
+        bool huge_pages;
+
+        static thread_local shared_ptr<MemoryArena> active;
+
+        void allocate_block(size_t min_size);                   // Replaces the block being filled
+        const block& new_block(size_t size);
+        static std::byte* allocate_huge_pages(size_t& size);
+        static void release_block(const block& b);
+        static bool enable_huge_pages();
+    };
+
+    // Standard allocator over a MemoryArena. Every allocation keeps the arena alive, so objects can outlive the scene
+    // that created them (meshes shared between a parsed scene and the render scene). Deallocation is a no-op.
+    template <typename T>
+    class ArenaAllocator
+    {
+    public:
+        using value_type = T;
+
+        ArenaAllocator(const shared_ptr<MemoryArena>& arena) : arena(arena) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.get_arena()) {}
+
+        T* allocate(size_t n)
+        {
+            return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T*, size_t) {}
+
+        const shared_ptr<MemoryArena>& get_arena() const { return arena; }
+
+        template <typename U>
+        bool operator==(const ArenaAllocator<U>& other) const { return arena == other.get_arena(); }
+
+    private:
+        shared_ptr<MemoryArena> arena;
+    };
+
+    // make_shared that places the object (and its control block) in the current arena, if a scope is open
+    template <typename T, typename... Args>
+    shared_ptr<T> make_arena_shared(Args&&... args)
+    {
+        const auto& arena = MemoryArena::current();
+
+        if (arena)
+            return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+
+        return std::make_shared<T>(std::forward<Args>(args)...);
+    }
+}
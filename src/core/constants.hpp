@@ -12,4 +12,5 @@ namespace Raytracing
 {
     constexpr double infinity = std::numeric_limits<double>::infinity();
     constexpr double pi = 3.14159265358979323846264338327950288;
+    constexpr double one_minus_epsilon = 0x1.fffffffffffffp-1;     // Largest double below 1, keeps sample values in [0, 1)
 }
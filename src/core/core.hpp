@@ -34,6 +34,8 @@
 #include <atomic>
 #include <stop_token>
 #include <mutex>
+#include <functional>
+#include <bit>
 
 // C++ std usings
 using std::make_shared;
@@ -0,0 +1,44 @@
+#pragma once
+
+// SIMD instruction sets available at compile time. Every kernel guarded by these macros keeps a scalar fallback
+// so the Emscripten build (no SIMD flags) produces the same results.
+
+// AVX (8 floats / 4 doubles)
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define RAYTRACING_SIMD_AVX 1
+
+    // MSVC does not define __FMA__ but /arch:AVX2 guarantees FMA3 support
+    #if defined(__FMA__) || defined(__AVX2__)
+        #define raytracing_fmadd_pd(a, b, c) _mm256_fmadd_pd(a, b, c)
+        #define raytracing_fmadd_ps(a, b, c) _mm256_fmadd_ps(a, b, c)
+    #else
+        #define raytracing_fmadd_pd(a, b, c) _mm256_add_pd(_mm256_mul_pd(a, b), c)
+        #define raytracing_fmadd_ps(a, b, c) _mm256_add_ps(_mm256_mul_ps(a, b), c)
+    #endif
+#else
+    #define RAYTRACING_SIMD_AVX 0
+#endif
+
+// AVX2 (integer operations on 8 lanes), MSVC defines __AVX2__ with /arch:AVX2
+#if defined(__AVX2__)
+    #define RAYTRACING_SIMD_AVX2 1
+#else
+    #define RAYTRACING_SIMD_AVX2 0
+#endif
+
+// F16C (half float conversions), part of every AVX2 processor. MSVC has no __F16C__ and enables it with /arch:AVX2.
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+    #include <immintrin.h>
+    #define RAYTRACING_SIMD_F16C 1
+#else
+    #define RAYTRACING_SIMD_F16C 0
+#endif
+
+// SSE2 (4 floats), baseline on every x64 target
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define RAYTRACING_SIMD_SSE 1
+#else
+    #define RAYTRACING_SIMD_SSE 0
+#endif
@@ -94,6 +94,8 @@ void RayTracingEngine::render_gui()
     // Enum names
     vector<const char*> image_format_names = get_enum_names<IMAGE_FORMAT>();
     vector<const char*> background_type_names = get_enum_names<BACKGROUND_TYPE>();
+    vector<const char*> light_sampling_names = get_enum_names<LIGHT_SAMPLING>();
+    vector<const char*> sampler_type_names = get_enum_names<SAMPLER_TYPE>();
 
     // Set window position
     float panel_width = webgpu_context->screen_width * 0.20f; // 20% of screen width
@@ -126,6 +128,28 @@ void RayTracingEngine::render_gui()
             ImGui::SliderInt("Max Bounce Depth", &settings.bounce_max_depth, 1, 1000);
             ImGui::SliderFloat("Min Hit Distance", &settings.min_hit_distance, 0.001f, 10.0f);
             ImGui::SliderInt("Samples per Pixel", &settings.samples_per_pixel, 1, 1000);
+            ImGui::Combo("Sampler", (int*)&settings.sampler_type, sampler_type_names.data(), int(sampler_type_names.size()));
+            ImGui::Checkbox("Adaptive Sampling", &settings.adaptive_sampling);
+
+            if (settings.adaptive_sampling)
+            {
+                ImGui::SliderInt("Min Samples per Pixel", &settings.min_samples_per_pixel, 1, settings.samples_per_pixel);
+                ImGui::SliderFloat("Error Threshold", &settings.adaptive_threshold, 0.001f, 0.1f, "%.3f", ImGuiSliderFlags_Logarithmic);
+            }
+
+            ImGui::Checkbox("Progressive", &settings.progressive);
+            ImGui::Checkbox("Time Budget", &settings.time_budget);
+
+            if (settings.time_budget)
+                ImGui::SliderFloat("Budget (s)", &settings.time_budget_seconds, 1.0f, 3600.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+
+            if (settings.progressive || settings.time_budget)
+                ImGui::SliderInt("Samples per Pass", &settings.samples_per_pass, 1, settings.samples_per_pixel);
+
+            ImGui::Checkbox("Denoise", &settings.denoise);
+
+            if (settings.denoise)
+                ImGui::SliderInt("Denoiser Iterations", &settings.denoise_iterations, 1, 8);
 
             ImGui::NewLine();
 
@@ -133,6 +157,8 @@ void RayTracingEngine::render_gui()
             ImGui::Checkbox("BVH", &settings.bvh_optimization);
             ImGui::Checkbox("Russian Roulette", &settings.russian_roulette);
             ImGui::Checkbox("Parallel Computation", &settings.parallelize);
+            ImGui::Checkbox("Huge Pages", &settings.huge_pages);
+            ImGui::Combo("Light Sampling", (int*)&settings.light_sampling, light_sampling_names.data(), int(light_sampling_names.size()));
 
             ImGui::NewLine();
 
@@ -151,7 +177,7 @@ void RayTracingEngine::render_gui()
                 ImGui::ColorEdit3("Secondary Blend Color", (float*)&settings.secondary_blend_color);
                 break;
             case BACKGROUND_TYPE::SKYBOX:
-                // TO BE IMPLEMENTED
+                ImGui::Checkbox("Sample as Light", &settings.skybox_sampling);
                 break;
             }
 
@@ -181,6 +207,12 @@ void RayTracingEngine::render_gui()
                 ImGui::SliderInt("Quality", &settings.quality, 1, 100, "%d");
             }
 
+            ImGui::Checkbox("Save Samples Map", &settings.save_sample_map);
+            ImGui::Checkbox("Save AOVs (EXR layers)", &settings.save_aovs);
+
+            if (settings.progressive || settings.time_budget)
+                ImGui::Checkbox("Save Every Pass", &settings.save_passes);
+
             ImGui::NewLine();
 
             // === GENERATE ===
@@ -206,7 +238,7 @@ void RayTracingEngine::render_gui()
 
                 // Parse scene nodes to meshes for raytracer
                 vector<Node*> scene_nodes = main_scene->get_nodes();
-                shared_ptr<ParsedScene> parsed_scene = parse_nodes(scene_nodes, settings.bvh_optimization);
+                shared_ptr<ParsedScene> parsed_scene = parse_nodes(scene_nodes, settings.bvh_optimization, settings.huge_pages);
 
                 // Parse camera data
                 Camera* engine_camera = renderer->get_camera();
@@ -12,6 +12,7 @@
 #include "materials/texture.hpp"
 #include "hittables/triangle.hpp"
 #include "graphics/raytracing_renderer.hpp"
+#include "graphics/denoiser.hpp"
 
 // External headers
 #include <omp.h>
@@ -39,6 +40,9 @@ void Raytracing::Camera::initialize(const RendererSettings& settings, std::atomi
     lookat = data.lookat;
     world_up = data.world_up;
 
+    sampler_type = settings.sampler_type;
+    write_aovs = settings.save_aovs;
+
     this->render_progress = render_progress;
 
     initialize(scene, image);
@@ -75,9 +79,8 @@ void Raytracing::Camera::initialize(const Scene& scene, ImageWriter& image)
     defocus_disk_u = side * defocus_radius * focus_distance;
     defocus_disk_v = up * defocus_radius * focus_distance;
 
-    // Calculate the square root of samples per pixel and its inverse for stratified sampling
-    pixel_sample_sqrt = int(sqrt(scene.samples_per_pixel));
-    pixel_sample_sqrt_inv = 1.0 / pixel_sample_sqrt;
+    // Ray cones start as wide as a pixel
+    pixel_spread_angle = std::atan(2 * h / image.get_height());
 
     // Log info
     Logger::info("CAMERA", "Camera settings succesfully initialized.");
@@ -96,59 +99,158 @@ void Raytracing::Camera::render(const Scene& scene, ImageWriter& image, std::sto
     // Aux vars
     auto dynamic_range = image.get_dynamic_range();
     uint32_t total_pixels = image.get_height() * image.get_width();
-    uint32_t progress = 0;
+
+    // Every pixel starts with an empty estimate, passes keep adding samples to it
+    accumulation.assign(total_pixels, PixelEstimate());
+    pixel_samples.assign(total_pixels, 0);
+
+    image_width = image.get_width();
+    image_height = image.get_height();
+
+    // Guides are needed by the denoiser and written as AOVs
+    collect_guides = scene.denoise || write_aovs;
+    guide_albedo.assign(collect_guides ? 3 * total_pixels : 0, 0.0f);
+    guide_normal.assign(collect_guides ? 3 * total_pixels : 0, 0.0f);
+    guide_depth.assign(collect_guides ? total_pixels : 0, 0.0f);
+    guide_primitive_id.assign(collect_guides ? total_pixels : 0, -1);
+    guide_material_id.assign(collect_guides ? total_pixels : 0, -1);
+    elapsed_nanoseconds.assign(write_aovs ? total_pixels : 0, 0);
+
+    // With a time budget the deadline ends the render, samples_per_pixel no longer limits the pixels
+    const bool budgeted = scene.time_budget > 0;
+    const double budget_miliseconds = scene.time_budget * 1000.0;
+
+    const int max_samples = budgeted ? budget_max_samples : scene.samples_per_pixel;
+    const int min_samples = scene.adaptive_sampling ? std::clamp(scene.min_samples_per_pixel, 1, max_samples) : max_samples;
+
+    // A single pass takes every sample of a pixel before moving to the next one
+    const bool multipass = scene.progressive || budgeted;
+    const int samples_per_pass = multipass ? std::clamp(scene.samples_per_pass, 1, std::max(max_samples, 1)) : std::max(max_samples, 1);
+    const int total_passes = (max_samples + samples_per_pass - 1) / samples_per_pass;
+    passes = 0;
 
     // Start render chrono
     render_chrono.start();
 
-    // Stratified sample square
-    #pragma omp parallel for schedule(dynamic, 1) if(scene.parallelize)
-    for (int pixel_row = 0; pixel_row < image.get_height(); pixel_row++)
+    for (int pass = 0; pass < total_passes && !s_token.stop_requested(); pass++)
     {
-        for (int pixel_column = 0; pixel_column < image.get_width(); pixel_column++)
+        const int first_sample = pass * samples_per_pass;
+        const int last_sample = std::min(first_sample + samples_per_pass, max_samples);
+        const auto pass_start = render_chrono.elapsed_miliseconds();
+        uint32_t progress = 0;
+        int64_t pass_samples = 0;
+
+        #pragma omp parallel for schedule(dynamic, 1) reduction(+:pass_samples) if(scene.parallelize)
+        for (int pixel_row = 0; pixel_row < image.get_height(); pixel_row++)
         {
-            // Final pixel color
-            color pixel_color(0, 0, 0);
+            // Sample values of the paths traced by this thread
+            auto sampler = Sampler::create(sampler_type);
 
-            // Sample points with stratified sampling for antialisasing
-            for (int sample_row = 0; sample_row < pixel_sample_sqrt; sample_row++)
+            for (int pixel_column = 0; pixel_column < image.get_width(); pixel_column++)
             {
-                for (int sample_column = 0; sample_column < pixel_sample_sqrt; sample_column++)
+                const int pixel_index = pixel_row * image.get_width() + pixel_column;
+                PixelEstimate& estimate = accumulation[pixel_index];
+                const auto pixel_start = std::chrono::steady_clock::now();
+
+                // Sample points for antialiasing, the sample indices continue across passes so any count keeps them
+                // well distributed over the pixel
+                for (int sample = first_sample; sample < last_sample && !estimate.converged; sample++)
                 {
                     // Skip execution check
                     if (s_token.stop_requested())
-                        continue;
+                        break;
+
+                    sampler->start_pixel_sample(pixel_row, pixel_column, sample);
 
                     // Get ray sample around pixel location
-                    auto sample_ray = get_ray_sample(pixel_row, pixel_column, sample_row, sample_column);
+                    auto sample_ray = get_ray_sample(pixel_row, pixel_column, *sampler);
 
                     // Get pixel color of the sample point that ray sample points to
-                    pixel_color += ray_color(sample_ray, scene.bounce_max_depth, scene, s_token);
+                    SurfaceGuide guide;
+                    color sample_color = ray_color(sample_ray, scene, *sampler, collect_guides ? &guide : nullptr);
+                    estimate.add(sample_color);
+
+                    if (collect_guides)
+                    {
+                        for (int c = 0; c < 3; c++)
+                        {
+                            guide_albedo[3 * pixel_index + c] += float(guide.albedo[c]);
+                            guide_normal[3 * pixel_index + c] += float(guide.normal[c]);
+                        }
+
+                        guide_depth[pixel_index] += float(guide.depth);
+
+                        if (estimate.samples == 1)
+                        {
+                            guide_primitive_id[pixel_index] = guide.primitive_id;
+                            guide_material_id[pixel_index] = guide.material_id;
+                        }
+                    }
+
+                    // Pixels that have converged stop once they have taken the minimum samples
+                    const int samples = estimate.samples;
+                    if (samples >= min_samples && samples < max_samples && samples % adaptive_check_interval == 0
+                        && has_converged(estimate.mean, estimate.squared_deviations, samples, scene.adaptive_threshold))
+                        estimate.converged = true;
                 }
-            }
 
-            // Avarage samples
-            pixel_color /= scene.samples_per_pixel;
+                if (write_aovs)
+                    elapsed_nanoseconds[pixel_index] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - pixel_start).count();
 
-            // Compute color
-            auto color_tuple = compute_color(pixel_color, dynamic_range);
+                pass_samples += estimate.samples - pixel_samples[pixel_index];
+                pixel_samples[pixel_index] = estimate.samples;
 
-            // Save pixel color into image buffer (row-major order)
-            image.write_pixel(pixel_row, pixel_column, color_tuple);
+                // Avarage samples
+                color pixel_color = estimate.sum / std::max(estimate.samples, 1);
 
-            // Update progress atomically
-            #pragma omp atomic update
-                progress++;
+                // Compute color
+                auto color_tuple = compute_color(pixel_color, dynamic_range);
+
+                // Save pixel color into image buffer (row-major order)
+                image.write_pixel(pixel_row, pixel_column, color_tuple);
+
+                // Update progress atomically
+                #pragma omp atomic update
+                    progress++;
+            }
+
+            // Calculate progress percentage, every pass takes the same share of the render
+            auto pass_progress = static_cast<float>(progress) / static_cast<float>(total_pixels);
+            auto progress_percentage = (pass + pass_progress) / total_passes;
+
+            // A budgeted render progresses with the time spent
+            if (budgeted)
+                progress_percentage = std::min(1.0f, float(render_chrono.elapsed_miliseconds() / budget_miliseconds));
+
+            // Update progress info for showing
+            if (render_progress)
+                render_progress->store(progress_percentage);
+            else if (!scene.parallelize)
+                std::clog << "\rProgress: " << std::fixed << std::setprecision(2) << 100.0f * progress_percentage << '% ' << std::flush;
         }
 
-        // Calculate progress percentage
-        auto progress_percentage = (static_cast<float>(progress) / static_cast<float>(total_pixels)); 
+        // A pass cut by a stop request leaves an uneven image, only complete passes are published
+        if (s_token.stop_requested())
+            break;
+
+        // Every pixel has converged, more passes would not change the image
+        if (pass_samples == 0)
+            break;
+
+        passes++;
+
+        if (multipass && on_pass_completed)
+            on_pass_completed(image, last_sample);
+
+        // The next pass is expected to last as long as this one, it only starts if it can end before the deadline
+        if (budgeted)
+        {
+            const auto elapsed = render_chrono.elapsed_miliseconds();
+            const auto pass_duration = elapsed - pass_start;
 
-        // Update progress info for showing
-        if (render_progress)
-            render_progress->store(progress_percentage);
-        else if (!scene.parallelize)
-            std::clog << "\rProgress: " << std::fixed << std::setprecision(2) << 100.0f * progress_percentage << '% ' << std::flush;
+            if (elapsed + pass_duration > budget_miliseconds)
+                break;
+        }
     }
 
     // End render chrono
@@ -157,170 +259,445 @@ void Raytracing::Camera::render(const Scene& scene, ImageWriter& image, std::sto
     // Progress info end line
     std::cout << std::endl;
 
+    // Samples actually taken
+    const int64_t total_samples = std::accumulate(pixel_samples.begin(), pixel_samples.end(), int64_t(0));
+    average_samples_per_pixel = double(total_samples) / total_pixels;
+
+    if (budgeted)
+        Logger::info("CAMERA", std::format("Time budget of {} s reached {:.1f} samples per pixel in {} passes of {} samples.", scene.time_budget, average_samples_per_pixel, passes, samples_per_pass));
+    else if (scene.progressive)
+        Logger::info("CAMERA", std::format("Progressive rendering completed {} of {} passes of {} samples.", passes, total_passes, samples_per_pass));
+
+    if (scene.adaptive_sampling)
+        Logger::info("CAMERA", std::format("Adaptive sampling took {:.1f} samples per pixel on average ({} to {}).", average_samples_per_pixel, min_samples, max_samples));
+
     // Benchmark rays
-    primary_rays = total_pixels * pixel_sample_sqrt * pixel_sample_sqrt;
-    rays_casted = primary_rays + background_rays + light_rays + reflected_rays + refracted_rays + unknwon_rays;
-    average_rays_per_second = rays_casted / int(render_chrono.elapsed_miliseconds());
+    primary_rays = int(total_samples);
+    rays_casted = primary_rays + background_rays + light_rays + reflected_rays + refracted_rays + shadow_rays + unknwon_rays;
+    average_rays_per_second = rays_casted / std::max(1, int(render_chrono.elapsed_miliseconds()));
+}
+
+void Raytracing::Camera::denoise(const Scene& scene, ImageWriter& image)
+{
+    const int width = image.get_width();
+    const int height = image.get_height();
+    const int total_pixels = width * height;
+
+    if (!collect_guides || int(accumulation.size()) != total_pixels)
+    {
+        Logger::error("CAMERA", "The render has no guide buffers, denoising skipped.");
+        return;
+    }
+
+    denoise_chrono.start();
+
+    // Pixel averages, the normal is renormalized after averaging and a pixel without any surface keeps a zero normal
+    DenoiserBuffers buffers(width, height);
+
+    #pragma omp parallel for if(scene.parallelize)
+    for (int p = 0; p < total_pixels; p++)
+    {
+        const PixelEstimate& estimate = accumulation[p];
+        const double samples = std::max(estimate.samples, 1);
+
+        vec3 normal(guide_normal[3 * p], guide_normal[3 * p + 1], guide_normal[3 * p + 2]);
+        const double normal_length = normal.length();
+
+        if (normal_length > 0)
+            normal /= normal_length;
+
+        for (int c = 0; c < 3; c++)
+        {
+            buffers.color[c][p] = float(estimate.sum[c] / samples);
+            buffers.albedo[c][p] = float(guide_albedo[3 * p + c] / samples);
+            buffers.normal[c][p] = float(normal[c]);
+        }
+
+        buffers.depth[p] = float(guide_depth[p] / samples);
+
+        // Variance of the mean luminance, a single sample says nothing about it and is trusted as little as its value
+        buffers.variance[p] = float(estimate.samples > 1 ? estimate.squared_deviations / ((estimate.samples - 1) * samples) : estimate.mean * estimate.mean);
+    }
+
+    Denoiser denoiser;
+    denoiser.iterations = scene.denoise_iterations;
+    denoiser.parallelize = scene.parallelize;
+    denoiser.denoise(buffers);
+
+    // Write the filtered frame
+    auto dynamic_range = image.get_dynamic_range();
+
+    #pragma omp parallel for if(scene.parallelize)
+    for (int pixel_row = 0; pixel_row < height; pixel_row++)
+    {
+        for (int pixel_column = 0; pixel_column < width; pixel_column++)
+        {
+            const int p = pixel_row * width + pixel_column;
+            color pixel_color(buffers.color[0][p], buffers.color[1][p], buffers.color[2][p]);
+
+            image.write_pixel(pixel_row, pixel_column, compute_color(pixel_color, dynamic_range));
+        }
+    }
+
+    denoise_chrono.end();
+
+    Logger::info("CAMERA", "Denoising completed in " + denoise_chrono.elapsed_to_string() + ".");
+}
+
+vector<Raytracing::ImageLayer> Raytracing::Camera::get_aovs() const
+{
+    const size_t total_pixels = size_t(image_width) * image_height;
+
+    if (!write_aovs || accumulation.size() != total_pixels)
+    {
+        Logger::error("CAMERA", "The render kept no AOVs.");
+        return {};
+    }
+
+    ImageLayer beauty { "", { "R", "G", "B" }, vector<vector<float>>(3, vector<float>(total_pixels)) };
+    ImageLayer albedo { "albedo", { "R", "G", "B" }, vector<vector<float>>(3, vector<float>(total_pixels)) };
+    ImageLayer normal { "normal", { "X", "Y", "Z" }, vector<vector<float>>(3, vector<float>(total_pixels)) };
+    ImageLayer depth { "depth", { "Z" }, vector<vector<float>>(1, vector<float>(total_pixels)) };
+    ImageLayer ids { "id", { "material", "primitive" }, vector<vector<float>>(2, vector<float>(total_pixels)) };
+    ImageLayer samples { "samples", { "count" }, vector<vector<float>>(1, vector<float>(total_pixels)) };
+    ImageLayer time { "time", { "microseconds" }, vector<vector<float>>(1, vector<float>(total_pixels)) };
+
+    for (size_t p = 0; p < total_pixels; p++)
+    {
+        const PixelEstimate& estimate = accumulation[p];
+        const double sample_count = std::max(estimate.samples, 1);
+
+        vec3 pixel_normal(guide_normal[3 * p], guide_normal[3 * p + 1], guide_normal[3 * p + 2]);
+        if (pixel_normal.length() > 0)
+            pixel_normal = unit_vector(pixel_normal);
+
+        for (int c = 0; c < 3; c++)
+        {
+            beauty.planes[c][p] = float(estimate.sum[c] / sample_count);
+            albedo.planes[c][p] = float(guide_albedo[3 * p + c] / sample_count);
+            normal.planes[c][p] = float(pixel_normal[c]);
+        }
+
+        depth.planes[0][p] = float(guide_depth[p] / sample_count);
+        ids.planes[0][p] = float(guide_material_id[p]);
+        ids.planes[1][p] = float(guide_primitive_id[p]);
+        samples.planes[0][p] = float(estimate.samples);
+        time.planes[0][p] = float(elapsed_nanoseconds[p] * 1e-3);
+    }
+
+    return { beauty, albedo, normal, depth, ids, samples, time };
 }
 
+void Raytracing::Camera::PixelEstimate::add(const color& sample_color)
+{
+    sum += sample_color;
+    samples++;
+
+    // Running mean and sum of squared deviations of the sample luminance (Welford)
+    const double sample_luminance = luminance(sample_color);
+    const double delta = sample_luminance - mean;
+    mean += delta / samples;
+    squared_deviations += delta * (sample_luminance - mean);
+}
 
-const Ray Raytracing::Camera::get_ray_sample(int pixel_row, int pixel_column, int sample_row, int sample_column) const
+const Ray Raytracing::Camera::get_ray_sample(int pixel_row, int pixel_column, Sampler& sampler) const
 {
-    auto offset = sample_square_stratified(sample_row, sample_column, pixel_sample_sqrt_inv);
+    // Sample values are drawn in the same order for every ray, so each one always reads the same sampler dimension
+    auto offset = sampler.get_2d();
+    auto lens = sampler.get_2d();
+    auto ray_time = sampler.get_1d();
 
     auto pixel_sample = pixel00_loc
-        + ((pixel_row + offset.y) * pixel_delta_v)
-        + ((pixel_column + offset.x) * pixel_delta_u);
+        + ((pixel_row + offset.second - 0.5) * pixel_delta_v)
+        + ((pixel_column + offset.first - 0.5) * pixel_delta_u);
 
-    auto ray_origin = (defocus_angle <= 0) ? lookfrom : defocus_disk_sample(lookfrom, defocus_disk_u, defocus_disk_v);
+    auto ray_origin = (defocus_angle <= 0) ? lookfrom : defocus_disk_sample(lookfrom, defocus_disk_u, defocus_disk_v, lens);
     auto ray_direction = pixel_sample - ray_origin;
-    auto ray_time = random_number<double>();
 
     auto ray = Ray(ray_origin, ray_direction, ray_time);
 
     return ray;
 }
 
-color Raytracing::Camera::ray_color(const Ray& sample_ray, int depth, const Scene& scene, std::stop_token s_token)
+color Raytracing::Camera::ray_color(const Ray& sample_ray, const Scene& scene, Sampler& sampler, SurfaceGuide* guide)
 {
-    // Halt execution check
-    if (s_token.stop_requested())
-        return color(0,0,0);
+    // Path state
+    color radiance(0, 0, 0);        // Light gathered by the path so far
+    color throughput(1, 1, 1);      // Product of the scattering weights of every bounce, scales the light found next
+    Ray ray = sample_ray;
 
-    // If we've exceeded the ray bounce limit, no more light is gathered.
-    if (depth <= 0)
-        return color(0, 0, 0);
+    // Last diffuse bounce, needed to weight the emission found by its BSDF sampled ray against light sampling
+    point3 scattering_point;
+    double scattering_pdf = 0;
+    bool specular_path = true;      // Camera rays and specular bounces cannot sample lights, emission counts in full
 
-    // Intersection details
-    hit_record hrec;
+    // Ray cone of the path (Akenine-Moller et al.), its width at a hit selects the mip level of the textures read there
+    double cone_width = 0;
+    double cone_spread = pixel_spread_angle;
 
     // Define ray intersection interval
     Interval ray_t(scene.min_hit_distance, Raytracing::infinity);
 
-    // Background hit  
-    if (!scene.hit(sample_ray, ray_t, hrec))
+    // Follow the path until it escapes, hits a light or exceeds the ray bounce limit (no more light is gathered then)
+    for (int depth = 0; depth < scene.bounce_max_depth; depth++)
     {
-        #pragma omp atomic update
-            background_rays++;
+        // Intersection details
+        hit_record hrec;
 
-        return compute_background_color(scene, sample_ray);
-    }
+        // Background hit
+        if (!scene.hit(ray, ray_t, hrec))
+        {
+            #pragma omp atomic update
+                background_rays++;
 
-    // Hit object type
-    HITTABLE_TYPE hit_object_type = hrec.type;
+            color background = compute_background_color(scene, ray);
 
-    // If the ray hits an object, calculate the color of the hit point
-    switch (hit_object_type)
-    {
-    case CONSTANT_MEDIUM:
+            // A sky that is sampled as a light was also reached by the light sample of the last diffuse bounce
+            if (!specular_path && scene.skybox_selection_probability > 0)
+            {
+                double light_pdf = scene.skybox_selection_probability * scene.skybox->pdf_value(ray.direction());
+                background *= power_heuristic(scattering_pdf, light_pdf);
+            }
 
-    case TRIANGLE:
+            // The background only gives the albedo, it has no surface to compare with its neighbours
+            if (guide)
+                guide->albedo = saturate(throughput * background);
 
-    case QUAD:
+            return radiance + throughput * background;
+        }
 
-    case SPHERE:
-    {
-        // Intersection point computed colors
-        color color_from_scatter;
-        color color_from_emission = hrec.material->emitted(sample_ray, hrec);
+        // Evaluate normal, texture coordinates and material of the closest hit only
+        scene.resolve_hit(ray, hrec);
 
-        // Material scattering details
-        scatter_record srec;
+        // Cone width at the hit, stretched over the surface by the incidence angle
+        cone_width += cone_spread * hrec.t * ray.direction().length();
+        double incidence_cosine = std::abs(dot(unit_vector(ray.direction()), hrec.normal));
+        hrec.texture_footprint = hrec.texture_scale * cone_width / std::max(incidence_cosine, 0.05);
 
-        // If the ray does not scatter, it has hit an emissive material
-        if (!hrec.material->scatter(sample_ray, hrec, srec))
+        if (guide && depth == 0)
         {
-            #pragma omp atomic update
-                light_rays++;
-
-            return color_from_emission;
+            guide->depth = hrec.t * ray.direction().length();
+            guide->primitive_id = scene.primitive_id(hrec);
+            guide->material_id = int(hrec.material_id);
         }
 
-        // Deal with specular materials apart from the rest (PDF skip)
-        if (srec.is_specular)
+        // Hit object type
+        HITTABLE_TYPE hit_object_type = hrec.type;
+
+        // If the ray hits an object, add its emission and continue the path along the scattered ray
+        switch (hit_object_type)
         {
-            switch (srec.scatter_type)
-            {
-                case REFLECT: // Metal or Dielectric
-                    #pragma omp atomic update
-                        reflected_rays++;
-                    break; 
-                case REFRACT: // Dielectric
-                    #pragma omp atomic update
-                        refracted_rays++;
-                    break; 
-            }
+        case CONSTANT_MEDIUM:
 
-            return srec.attenuation * ray_color(srec.specular_ray.value(), depth - 1, scene, s_token);
-        }
+        case TRIANGLE:
 
-        // Aux variables (to make code more understandable)
-        auto hittables_with_pdf = scene.hittables_with_pdf;
-        auto material_pdf = srec.pdf;
-        vec3 surface_hit_point = hrec.p;
+        case QUAD:
 
-        // Create the sampling PDF
-        shared_ptr<PDF> sampling_pdf;
+        case BOX:
 
-        // Determine the sampling PDF
-        if (hittables_with_pdf.empty())
-        {
-            // Material associated samplig PDF
-            sampling_pdf = material_pdf;
-        }
-        else
+        case SPHERE:
         {
-            // Generate mixture of PDFs (hittable pdf + material pdf)
-            auto _hittables_pdf = make_shared<hittables_pdf>(hittables_with_pdf, surface_hit_point);
-            auto _mixture_pdf = make_shared<mixture_pdf>(_hittables_pdf, material_pdf);
-            sampling_pdf = _mixture_pdf;
-        }
+            // Intersection point emitted color. Lights reached by a diffuse bounce were also sampled directly at
+            // that bounce, so the emission is weighted by the power heuristic instead of being counted twice.
+            color emission = hrec.material->emitted(ray, hrec);
+            const Hittable* light = specular_path ? nullptr : scene.lights.find(hrec.primitive);
 
-        // Generate random scatter ray using the sampling PDF
-        vec3 scatter_direction = sampling_pdf->generate();
-        auto scattered = Ray(surface_hit_point, scatter_direction, sample_ray.time());
+            if (light)
+            {
+                double light_pdf = (1.0 - scene.skybox_selection_probability) * scene.lights.probability(scattering_point, light) * light->pdf_value(scattering_point, ray.direction());
+                emission *= power_heuristic(scattering_pdf, light_pdf);
+            }
 
-        // Get the weight of the generated scatter ray sample
-        auto sampling_pdf_value = sampling_pdf->value(scatter_direction);
+            radiance += throughput * emission;
 
-        // Get the material's associated scattering PDF
-        auto scattering_pdf_value = hrec.material->scattering_pdf_value(sample_ray, hrec, scattered);
+            // Material scattering details
+            scatter_record srec;
 
-        // Update reflecting rays count
-        #pragma omp atomic update
-            reflected_rays++;
+            // If the ray does not scatter, it has hit an emissive material
+            if (!hrec.material->scatter(ray, hrec, srec))
+            {
+                if (guide)
+                {
+                    guide->albedo = saturate(throughput * emission);
+                    guide->normal = hrec.normal;
+                }
 
-        // === Russian Roulette ===
-        double rr_probability = 1;
-        if (scene.russian_roulette)
-        {
-            if (depth >= 3)
+                #pragma omp atomic update
+                    light_rays++;
+
+                return radiance;
+            }
+
+            // Deal with specular materials apart from the rest (PDF skip)
+            if (srec.is_specular)
+            {
+                switch (srec.scatter_type)
+                {
+                    case REFLECT: // Metal or Dielectric
+                        #pragma omp atomic update
+                            reflected_rays++;
+                        break;
+                    case REFRACT: // Dielectric
+                        #pragma omp atomic update
+                            refracted_rays++;
+                        break;
+                }
+
+                throughput *= srec.attenuation;
+                ray = srec.specular_ray.value();
+                specular_path = true;
+                break;
+            }
+
+            // First diffuse surface of the path, later bounces leave the guide alone
+            if (guide)
             {
-                rr_probability = std::clamp(srec.attenuation.max_component(), 0.1, 1.0);
-                if (random_number<double>() > rr_probability)
-                    return color_from_emission;
+                guide->albedo = saturate(throughput * srec.attenuation);
+                guide->normal = hrec.normal;
+                guide = nullptr;
             }
+
+            // Sample values of the bounce, drawn before anything can end it early so the dimensions stay aligned
+            double u_light = sampler.get_1d();
+            auto u_light_point = sampler.get_2d();
+            auto u_scatter = sampler.get_2d();
+
+            // Next event estimation: direct light through a shadow ray
+            radiance += throughput * sample_direct_light(ray, hrec, srec, scene, u_light, u_light_point);
+
+            // Generate scatter ray and its weight using the material PDF
+            vec3 scatter_direction = srec.pdf.generate(u_scatter);
+            double sampling_pdf_value = srec.pdf.value(scatter_direction);
+
+            auto scattered = Ray(hrec.p, scatter_direction, ray.time());
+
+            // Get the material's associated scattering PDF
+            auto scattering_pdf_value = hrec.material->scattering_pdf_value(ray, hrec, scattered);
+
+            // Update reflecting rays count
+            #pragma omp atomic update
+                reflected_rays++;
+
+            // A direction the sampling PDF cannot produce carries no light
+            if (sampling_pdf_value <= 0)
+                return radiance;
+
+            // Bidirectional Reflectance Distribution Function (BRDF) weight of the bounce
+            throughput *= srec.attenuation * scattering_pdf_value / sampling_pdf_value;
+            ray = scattered;
+
+            scattering_point = hrec.p;
+            scattering_pdf = sampling_pdf_value;
+            specular_path = false;
+
+            // The cone widens to the solid angle the scattered direction stands for, 1 / pdf (specular bounces keep
+            // their spread, surfaces are treated as flat)
+            cone_spread = std::max(cone_spread, std::min(2.0 * std::sqrt(1.0 / (Raytracing::pi * sampling_pdf_value)), 2.0));
+            break;
         }
+        default: // Unknown hit
 
-        // Recursive call
-        color sample_color = ray_color(scattered, depth - 1, scene, s_token);
+            #pragma omp atomic update
+                unknwon_rays++;
+
+            return radiance + throughput * compute_background_color(scene, ray);
+        }
 
-        // Bidirectional Reflectance Distribution Function (BRDF)
-        if (scene.russian_roulette)
-            color_from_scatter = (srec.attenuation * scattering_pdf_value * sample_color) / (sampling_pdf_value * rr_probability);
-        else
-            color_from_scatter = (srec.attenuation * scattering_pdf_value * sample_color) / (sampling_pdf_value);
+        // === Russian Roulette ===
+        // Paths whose throughput has become small are terminated randomly, survivors are reweighted to stay unbiased
+        if (scene.russian_roulette && depth >= 3)
+        {
+            double rr_probability = std::clamp(throughput.max_component(), 0.05, 1.0);
+            if (sampler.get_1d() > rr_probability)
+                return radiance;
 
-        // Combine scatter and emission colors
-        return color_from_emission + color_from_scatter;
+            throughput /= rr_probability;
+        }
     }
-    default: // Unknown hit
 
-        #pragma omp atomic update
-            unknwon_rays++;
+    return radiance;
+}
 
-        return compute_background_color(scene, sample_ray);
-    }
+color Raytracing::Camera::sample_direct_light(const Ray& incoming_ray, const hit_record& hrec, const scatter_record& srec, const Scene& scene, double u_light, const pair<double, double>& u_point)
+{
+    // The skybox takes the first part of the selection sample, the rest is stretched over the scene lights
+    const double skybox_probability = scene.skybox_selection_probability;
+
+    if (u_light < skybox_probability)
+        return sample_skybox_light(incoming_ray, hrec, srec, scene, u_point);
+
+    u_light = (u_light - skybox_probability) / (1.0 - skybox_probability);
+
+    // Choose a light and a point on it
+    double selection_probability;
+    const Hittable* light = scene.lights.sample(hrec.p, u_light, selection_probability);
+
+    if (!light)
+        return color(0, 0, 0);
+
+    vec3 light_direction = light->random_scattering_ray(hrec.p, u_point);
+    double light_pdf = (1.0 - skybox_probability) * selection_probability * light->pdf_value(hrec.p, light_direction);
+
+    if (light_pdf <= 0)
+        return color(0, 0, 0);
+
+    // Shadow ray, the light is visible if it is the closest hit (instanced lights are hit through their primitive)
+    auto shadow_ray = Ray(hrec.p, light_direction, incoming_ray.time());
+    hit_record light_rec;
+
+    #pragma omp atomic update
+        shadow_rays++;
+
+    if (!scene.hit(shadow_ray, Interval(scene.min_hit_distance, Raytracing::infinity), light_rec) || scene.lights.find(light_rec.primitive) != light)
+        return color(0, 0, 0);
+
+    scene.resolve_hit(shadow_ray, light_rec);
+
+    color emission = light_rec.material->emitted(shadow_ray, light_rec);
+    double scattering_pdf_value = hrec.material->scattering_pdf_value(incoming_ray, hrec, shadow_ray);
+
+    // Weighted against the chance of the material PDF generating the same direction
+    double weight = power_heuristic(light_pdf, srec.pdf.value(light_direction));
+
+    return srec.attenuation * scattering_pdf_value * emission * weight / light_pdf;
+}
+
+color Raytracing::Camera::sample_skybox_light(const Ray& incoming_ray, const hit_record& hrec, const scatter_record& srec, const Scene& scene, const pair<double, double>& u_direction)
+{
+    // Direction toward a bright part of the sky
+    double direction_pdf;
+    vec3 light_direction = scene.skybox->sample(u_direction, direction_pdf);
+    double light_pdf = scene.skybox_selection_probability * direction_pdf;
+
+    if (light_pdf <= 0)
+        return color(0, 0, 0);
+
+    // Shadow ray, the sky is visible if nothing is hit
+    auto shadow_ray = Ray(hrec.p, light_direction, incoming_ray.time());
+    hit_record occluder_rec;
+
+    #pragma omp atomic update
+        shadow_rays++;
+
+    if (scene.hit(shadow_ray, Interval(scene.min_hit_distance, Raytracing::infinity), occluder_rec))
+        return color(0, 0, 0);
+
+    color emission = scene.skybox->value(light_direction);
+    double scattering_pdf_value = hrec.material->scattering_pdf_value(incoming_ray, hrec, shadow_ray);
+
+    double weight = power_heuristic(light_pdf, srec.pdf.value(light_direction));
+
+    return srec.attenuation * scattering_pdf_value * emission * weight / light_pdf;
+}
+
+bool Raytracing::Camera::has_converged(double mean, double squared_deviations, int samples, double threshold)
+{
+    // Sample variance over the count gives the variance of the pixel estimate. Dark pixels are judged against a small
+    // floor instead of their own luminance, which would ask for an error close to zero.
+    const double variance = squared_deviations / (samples - 1);
+    const double standard_error = std::sqrt(variance / samples);
+
+    return standard_error <= threshold * (mean + adaptive_luminance_floor);
 }
 
 Raytracing::color Raytracing::Camera::compute_background_color(const Scene& scene, const Ray& sample_ray) const
@@ -357,25 +734,3 @@ Raytracing::color Raytracing::Camera::compute_background_color(const Scene& scen
         return scene.background; // Fallback to background color
     }
 }
-
-
-optional<color> Raytracing::Camera::barycentric_color_interpolation(const hit_record& rec, Triangle* t) const
-{
-    if (!rec.bc.has_value() || !t->has_vertex_colors())
-        return nullopt;
-
-    // Barycentric coordinates
-    barycentric_coordinates bc = rec.bc.value();
-    double u = bc.u;
-    double v = bc.v;
-    double w = bc.w;
-
-    // Vertex colors
-    vec3 color_u = t->A.color.value();
-    vec3 color_v = t->B.color.value();
-    vec3 color_w = t->C.color.value();
-
-    color c = u * color_u + v * color_v + w * color_w;
-
-    return c;
-}
@@ -5,16 +5,19 @@
 #include "math/vec3.hpp"
 #include "utils/chrono.hpp"
 #include "hittables/hittable.hpp"
+#include "sampler.hpp"
 
 // Forward declarations
 struct Ray;
-class Triangle;
+struct scatter_record;
 
 // Namespace forward declarations
 namespace Raytracing
 {
     class Scene;
+    class Sampler;
     struct ImageWriter;
+    struct ImageLayer;
     struct RendererSettings;
 }
 
@@ -53,22 +56,38 @@ namespace Raytracing
         point3 lookat = point3(0, 0, -1);   // Point camera is looking at
         vec3   world_up = vec3(0, 1, 0);    // Camera-relative "up" direction
 
+        // Sampling
+        SAMPLER_TYPE sampler_type = SAMPLER_TYPE::SOBOL;   // Generator of the sample values of every path
+
+        // Output
+        bool write_aovs = false;                            // Keeps the arbitrary output variables of the render for get_aovs
+
         // Benchmark
         int primary_rays = 0;
         int background_rays = 0;
         int light_rays = 0;
         int reflected_rays = 0;
         int refracted_rays = 0;
+        int shadow_rays = 0;
         int unknwon_rays = 0;
         int rays_casted = 0;
         int average_rays_per_second = 0;
+        double average_samples_per_pixel = 0;
+        vector<int> pixel_samples;                      // Samples taken by each pixel (row-major), fewer than requested with adaptive sampling
+        int passes = 0;                                 // Passes completed over the whole frame, one unless rendering progressively
         Chrono render_chrono;
+        Chrono denoise_chrono;
+
+        // Called from the render thread after each progressive pass with the image holding the frame so far and the samples per pixel it was given
+        std::function<void(ImageWriter&, int)> on_pass_completed;
 
         Camera();
 
         void initialize(const Raytracing::RendererSettings& settings, std::atomic<float>* render_progres, const Scene& scene, ImageWriter& image);
         void initialize(const Raytracing::Scene& scene, ImageWriter& image); 
         void render(const Raytracing::Scene& scene, ImageWriter& image, std::stop_token s_token = std::stop_token{});
+        void denoise(const Raytracing::Scene& scene, ImageWriter& image);   // Filters the last render guided by its first hit buffers and writes it again into the image
+        vector<ImageLayer> get_aovs() const;                                 // Linear color, albedo, normal, depth, IDs, sample count and time of each pixel of the last render
 
     private:
 
@@ -79,17 +98,60 @@ namespace Raytracing
         vec3   side, up, view;                              // Camera frame basis vectors
         vec3   defocus_disk_u;                              // Defocus disk horizontal radius
         vec3   defocus_disk_v;                              // Defocus disk vertical radius    
-        int    pixel_sample_sqrt;	                        // Square root of samples per pixel
-        double pixel_sample_sqrt_inv;                       // Inverse of square root of samples per pixel
+        double pixel_spread_angle = 0;                      // Angle between the rays of neighbouring pixels, the initial spread of the ray cones
         std::atomic<float>* render_progress = nullptr;    // Atomic pointer to render progress for ImGui progress bar
 
         // Auxiliar variables
-        vector<unsigned long long> elapsed_nanoseconds;
-
-        const Ray get_ray_sample(int pixel_row, int pixel_column, int sample_row, int sample_column) const; // Construct a camera ray originating from the defocus disk and directed at randomly sampled point around the pixel location pixel_row, pixel_column for stratified sample square sample_row, sample_column.
-        Raytracing::color ray_color(const Ray& sample_ray, int depth, const Raytracing::Scene& scene, std::stop_token s_token);
+        vector<unsigned long long> elapsed_nanoseconds;     // Time spent on each pixel (row-major), only kept for the AOVs
+        int image_width = 0;
+        int image_height = 0;
+
+        // Running estimate of a pixel, kept between passes
+        struct PixelEstimate
+        {
+            color sum = color(0, 0, 0);         // Sum of the sample colors
+            double mean = 0;                    // Mean sample luminance
+            double squared_deviations = 0;      // Sum of squared deviations from the mean luminance
+            int samples = 0;
+            bool converged = false;             // Set by adaptive sampling, later passes skip the pixel
+
+            void add(const color& sample_color);
+        };
+
+        vector<PixelEstimate> accumulation;     // Float accumulation buffer of the frame (row-major)
+
+        // First surface of a path that is not a mirror or glass, the guide of the denoiser
+        struct SurfaceGuide
+        {
+            color albedo = color(0, 0, 0);      // Reflectance, tinted by the specular bounces in front of it
+            vec3 normal = vec3(0, 0, 0);        // Zero when no such surface was found
+            double depth = 0;                   // Distance to the first hit of the camera ray
+            int primitive_id = -1;              // Primitive and material of the first hit, -1 for the background
+            int material_id = -1;
+        };
+
+        // Per pixel sums of the guides (row-major, three floats per pixel for albedo and normal), only kept when
+        // denoising or writing AOVs. IDs cannot be averaged, they are the ones of the first sample.
+        bool collect_guides = false;
+        vector<float> guide_albedo;
+        vector<float> guide_normal;
+        vector<float> guide_depth;
+        vector<int> guide_primitive_id;
+        vector<int> guide_material_id;
+
+        // Adaptive sampling
+        static constexpr int adaptive_check_interval = 8;           // Samples between two error estimates of a pixel
+        static constexpr double adaptive_luminance_floor = 0.01;    // Keeps the error target of dark pixels above zero
+
+        // Time budget
+        static constexpr int budget_max_samples = 1 << 24;          // Samples per pixel limit of a budgeted render, only there to bound the sample indices
+
+        const Ray get_ray_sample(int pixel_row, int pixel_column, Sampler& sampler) const; // Construct a camera ray originating from the defocus disk and directed at a point of the pixel pixel_row, pixel_column, both given by the sampler, which must have started the pixel sample.
+        Raytracing::color ray_color(const Ray& sample_ray, const Raytracing::Scene& scene, Sampler& sampler, SurfaceGuide* guide = nullptr); // Radiance along the path started by sample_ray, traced iteratively up to the scene bounce limit. Fills guide when given.
+        Raytracing::color sample_direct_light(const Ray& incoming_ray, const hit_record& hrec, const scatter_record& srec, const Raytracing::Scene& scene, double u_light, const pair<double, double>& u_point); // Light sampled contribution at a diffuse hit, MIS weighted
+        Raytracing::color sample_skybox_light(const Ray& incoming_ray, const hit_record& hrec, const scatter_record& srec, const Raytracing::Scene& scene, const pair<double, double>& u_direction); // Same for a direction toward the skybox
         Raytracing::color compute_background_color(const Raytracing::Scene& scene, const Ray& sample_ray) const;
-        optional<Raytracing::color> barycentric_color_interpolation(const hit_record& rec, Triangle* t) const;
+        static bool has_converged(double mean, double squared_deviations, int samples, double threshold); // Standard error of the mean luminance below threshold times that luminance
 
     };
 }
@@ -23,6 +23,16 @@ const Raytracing::color GRAY(0.5, 0.5, 0.5);
 const Raytracing::color ORANGE(1.0, 0.65, 0.0);
 const Raytracing::color SKY_BLUE(135.0 / 255.0, 206.0 / 255.0, 235.0 / 255.0);
 
+inline double luminance(const Raytracing::color& c) // Rec. 709 relative luminance of a linear color
+{
+    return 0.2126 * c.x + 0.7152 * c.y + 0.0722 * c.z;
+}
+
+inline Raytracing::color saturate(const Raytracing::color& c) // Every component clamped to [0, 1]
+{
+    return Raytracing::color(std::clamp(c.x, 0.0, 1.0), std::clamp(c.y, 0.0, 1.0), std::clamp(c.z, 0.0, 1.0));
+}
+
 inline double linear_to_gamma(double linear_component, double gamma = 2.2)
 {
     if (linear_component <= 0)
@@ -0,0 +1,390 @@
+// Headers
+#include "core/core.hpp"
+#include "core/simd.hpp"
+#include "denoiser.hpp"
+#include <bit>
+
+Raytracing::DenoiserBuffers::DenoiserBuffers(int width, int height) : width(width), height(height)
+{
+    const size_t total_pixels = size_t(width) * height;
+
+    for (int c = 0; c < 3; c++)
+    {
+        color[c].assign(total_pixels, 0.0f);
+        albedo[c].assign(total_pixels, 0.0f);
+        normal[c].assign(total_pixels, 0.0f);
+    }
+
+    depth.assign(total_pixels, 0.0f);
+    variance.assign(total_pixels, 0.0f);
+}
+
+void Raytracing::Denoiser::denoise(DenoiserBuffers& buffers) const
+{
+    const int width = buffers.width;
+    const int height = buffers.height;
+    const int total_pixels = width * height;
+
+    // Below this albedo the radiance is filtered as it is, dividing by it would only amplify the noise
+    const float min_albedo = 1e-3f;
+
+    // Demodulate the albedo, the variance of the luminance is scaled by the luminance of the albedo
+    std::array<vector<float>, 3> color;
+    vector<float> variance(total_pixels);
+
+    for (int c = 0; c < 3; c++)
+        color[c].resize(total_pixels);
+
+    #pragma omp parallel for if(parallelize)
+    for (int p = 0; p < total_pixels; p++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            const float albedo = buffers.albedo[c][p];
+            color[c][p] = albedo > min_albedo ? buffers.color[c][p] / albedo : buffers.color[c][p];
+        }
+
+        const float albedo_luminance = 0.2126f * buffers.albedo[0][p] + 0.7152f * buffers.albedo[1][p] + 0.0722f * buffers.albedo[2][p];
+        variance[p] = albedo_luminance > min_albedo ? buffers.variance[p] / (albedo_luminance * albedo_luminance) : buffers.variance[p];
+    }
+
+    // Depth change to the neighbouring pixels of the same surface, the smaller one-sided difference on each axis so a
+    // silhouette next to the pixel does not count as slope
+    vector<float> depth_gradient(total_pixels, 0.0f);
+
+    auto has_surface = [&](int p)
+    {
+        return buffers.normal[0][p] != 0.0f || buffers.normal[1][p] != 0.0f || buffers.normal[2][p] != 0.0f;
+    };
+
+    #pragma omp parallel for if(parallelize)
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const int p = y * width + x;
+
+            if (!has_surface(p))
+                continue;
+
+            auto axis_gradient = [&](int previous, int next, bool has_previous, bool has_next)
+            {
+                float gradient = std::numeric_limits<float>::max();
+
+                if (has_previous && has_surface(previous))
+                    gradient = std::abs(buffers.depth[p] - buffers.depth[previous]);
+                if (has_next && has_surface(next))
+                    gradient = std::min(gradient, std::abs(buffers.depth[next] - buffers.depth[p]));
+
+                return gradient == std::numeric_limits<float>::max() ? 0.0f : gradient;
+            };
+
+            const float gradient_x = axis_gradient(p - 1, p + 1, x > 0, x + 1 < width);
+            const float gradient_y = axis_gradient(p - width, p + width, y > 0, y + 1 < height);
+
+            depth_gradient[p] = std::max(gradient_x, gradient_y);
+        }
+    }
+
+    // Ping-pong planes of the iterations
+    std::array<vector<float>, 3> filtered_color;
+    for (int c = 0; c < 3; c++)
+        filtered_color[c].resize(total_pixels);
+
+    vector<float> filtered_variance(total_pixels);
+    vector<float> luminance(total_pixels);
+    vector<float> inverse_deviation(total_pixels);
+    vector<float> blurred_variance(total_pixels);
+
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        // Luminance of every pixel and its tolerance, taken from the variance blurred by a 3x3 gaussian because the
+        // estimate of a single pixel is itself noisy. The blur is separable and repeats the border pixels.
+        #pragma omp parallel for if(parallelize)
+        for (int y = 0; y < height; y++)
+        {
+            const float* row = variance.data() + size_t(y) * width;
+            float* blurred_row = blurred_variance.data() + size_t(y) * width;
+
+            for (int x = 0; x < width; x++)
+            {
+                const int p = y * width + x;
+                luminance[p] = 0.2126f * color[0][p] + 0.7152f * color[1][p] + 0.0722f * color[2][p];
+                blurred_row[x] = 0.25f * row[std::max(x - 1, 0)] + 0.5f * row[x] + 0.25f * row[std::min(x + 1, width - 1)];
+            }
+        }
+
+        #pragma omp parallel for if(parallelize)
+        for (int y = 0; y < height; y++)
+        {
+            const float* above = blurred_variance.data() + size_t(std::max(y - 1, 0)) * width;
+            const float* row = blurred_variance.data() + size_t(y) * width;
+            const float* below = blurred_variance.data() + size_t(std::min(y + 1, height - 1)) * width;
+            float* deviation_row = inverse_deviation.data() + size_t(y) * width;
+
+            for (int x = 0; x < width; x++)
+            {
+                const float pixel_variance = std::max(0.25f * above[x] + 0.5f * row[x] + 0.25f * below[x], 0.0f);
+                deviation_row[x] = 1.0f / (luminance_sigma * std::sqrt(pixel_variance) + 1e-4f);
+            }
+        }
+
+        Iteration it;
+        it.width = width;
+        it.height = height;
+        it.step = 1 << iteration;
+        it.luminance = luminance.data();
+        it.variance = variance.data();
+        it.inverse_deviation = inverse_deviation.data();
+        it.depth = buffers.depth.data();
+        it.depth_gradient = depth_gradient.data();
+        it.filtered_variance = filtered_variance.data();
+
+        for (int c = 0; c < 3; c++)
+        {
+            it.color[c] = color[c].data();
+            it.normal[c] = buffers.normal[c].data();
+            it.filtered_color[c] = filtered_color[c].data();
+        }
+
+        #pragma omp parallel for schedule(dynamic, 4) if(parallelize)
+        for (int y = 0; y < height; y++)
+            filter_row(it, y);
+
+        for (int c = 0; c < 3; c++)
+            std::swap(color[c], filtered_color[c]);
+
+        std::swap(variance, filtered_variance);
+    }
+
+    // Modulate the albedo back in
+    #pragma omp parallel for if(parallelize)
+    for (int p = 0; p < total_pixels; p++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            const float albedo = buffers.albedo[c][p];
+            buffers.color[c][p] = albedo > min_albedo ? color[c][p] * albedo : color[c][p];
+        }
+    }
+}
+
+void Raytracing::Denoiser::filter_row(const Iteration& it, int y) const
+{
+    // Vector runs need every horizontal tap inside the row, pixels closer to the borders are filtered one by one
+    const int border = 2 * it.step;
+    int x = 0;
+
+    while (x < it.width)
+    {
+#if RAYTRACING_SIMD_AVX2
+        if (x >= border && x + 7 + border < it.width)
+        {
+            filter_pixels_avx2(it, x, y);
+            x += 8;
+            continue;
+        }
+#endif
+        filter_pixel(it, x, y);
+        x++;
+    }
+}
+
+void Raytracing::Denoiser::filter_pixel(const Iteration& it, int x, int y) const
+{
+    const int p = y * it.width + x;
+
+    const float nx = it.normal[0][p], ny = it.normal[1][p], nz = it.normal[2][p];
+
+    // Escaped paths have nothing to be compared with and are kept as they are
+    if (nx == 0.0f && ny == 0.0f && nz == 0.0f)
+    {
+        for (int c = 0; c < 3; c++)
+            it.filtered_color[c][p] = it.color[c][p];
+
+        it.filtered_variance[p] = it.variance[p];
+        return;
+    }
+
+    const float luminance = it.luminance[p];
+    const float inverse_deviation = it.inverse_deviation[p];
+    const float depth = it.depth[p];
+
+    // Expected depth change at one and two taps of distance
+    const float depth_tolerance = depth_sigma * it.depth_gradient[p] * it.step;
+    const float depth_epsilon = 5e-3f * depth + 1e-6f;
+    const float inverse_depth_tolerance[2] = { 1.0f / (depth_tolerance + depth_epsilon), 1.0f / (2.0f * depth_tolerance + depth_epsilon) };
+
+    // The center tap always has full weight
+    const float center_weight = kernel[2] * kernel[2];
+    float weight_sum = center_weight;
+    float sum[3] = { center_weight * it.color[0][p], center_weight * it.color[1][p], center_weight * it.color[2][p] };
+    float variance_sum = center_weight * center_weight * it.variance[p];
+
+    for (int j = -2; j <= 2; j++)
+    {
+        const int yy = y + j * it.step;
+
+        if (yy < 0 || yy >= it.height)
+            continue;
+
+        for (int i = -2; i <= 2; i++)
+        {
+            const int xx = x + i * it.step;
+
+            if ((i == 0 && j == 0) || xx < 0 || xx >= it.width)
+                continue;
+
+            const int q = yy * it.width + xx;
+            const int distance = std::max(std::abs(i), std::abs(j));
+
+            const float cosine = nx * it.normal[0][q] + ny * it.normal[1][q] + nz * it.normal[2][q];
+            const float exponent = std::abs(luminance - it.luminance[q]) * inverse_deviation + std::abs(depth - it.depth[q]) * inverse_depth_tolerance[distance - 1];
+            const float weight = kernel[i + 2] * kernel[j + 2] * normal_weight(cosine) * fast_exp(exponent);
+
+            weight_sum += weight;
+            for (int c = 0; c < 3; c++)
+                sum[c] += weight * it.color[c][q];
+
+            variance_sum += weight * weight * it.variance[q];
+        }
+    }
+
+    for (int c = 0; c < 3; c++)
+        it.filtered_color[c][p] = sum[c] / weight_sum;
+
+    it.filtered_variance[p] = variance_sum / (weight_sum * weight_sum);
+}
+
+#if RAYTRACING_SIMD_AVX2
+void Raytracing::Denoiser::filter_pixels_avx2(const Iteration& it, int x, int y) const
+{
+    // Same computation as filter_pixel for 8 neighbouring pixels, one per lane
+    const int p = y * it.width + x;
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+    const __m256 nx = _mm256_loadu_ps(it.normal[0] + p);
+    const __m256 ny = _mm256_loadu_ps(it.normal[1] + p);
+    const __m256 nz = _mm256_loadu_ps(it.normal[2] + p);
+
+    const __m256 luminance = _mm256_loadu_ps(it.luminance + p);
+    const __m256 inverse_deviation = _mm256_loadu_ps(it.inverse_deviation + p);
+    const __m256 depth = _mm256_loadu_ps(it.depth + p);
+
+    const __m256 depth_tolerance = _mm256_mul_ps(_mm256_set1_ps(depth_sigma * it.step), _mm256_loadu_ps(it.depth_gradient + p));
+    const __m256 depth_epsilon = raytracing_fmadd_ps(_mm256_set1_ps(5e-3f), depth, _mm256_set1_ps(1e-6f));
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 inverse_depth_tolerance[2] =
+    {
+        _mm256_div_ps(one, _mm256_add_ps(depth_tolerance, depth_epsilon)),
+        _mm256_div_ps(one, raytracing_fmadd_ps(_mm256_set1_ps(2.0f), depth_tolerance, depth_epsilon))
+    };
+
+    const __m256 center_weight = _mm256_set1_ps(kernel[2] * kernel[2]);
+    __m256 weight_sum = center_weight;
+    __m256 sum[3];
+    for (int c = 0; c < 3; c++)
+        sum[c] = _mm256_mul_ps(center_weight, _mm256_loadu_ps(it.color[c] + p));
+
+    __m256 variance_sum = _mm256_mul_ps(_mm256_mul_ps(center_weight, center_weight), _mm256_loadu_ps(it.variance + p));
+
+    // Constants of the exponential and of the normal weight
+    const __m256 max_exponent = _mm256_set1_ps(87.0f);
+    const __m256 minus_log2e = _mm256_set1_ps(-1.44269504f);
+
+    for (int j = -2; j <= 2; j++)
+    {
+        const int yy = y + j * it.step;
+
+        if (yy < 0 || yy >= it.height)
+            continue;
+
+        for (int i = -2; i <= 2; i++)
+        {
+            if (i == 0 && j == 0)
+                continue;
+
+            const int q = yy * it.width + x + i * it.step;
+            const int distance = std::max(std::abs(i), std::abs(j));
+
+            // Normal weight, the cosine raised to 128 by repeated squaring
+            __m256 cosine = _mm256_mul_ps(nx, _mm256_loadu_ps(it.normal[0] + q));
+            cosine = raytracing_fmadd_ps(ny, _mm256_loadu_ps(it.normal[1] + q), cosine);
+            cosine = raytracing_fmadd_ps(nz, _mm256_loadu_ps(it.normal[2] + q), cosine);
+            __m256 weight = _mm256_max_ps(cosine, zero);
+            for (int k = 0; k < 7; k++)
+                weight = _mm256_mul_ps(weight, weight);
+
+            // Luminance and depth differences share one exponential
+            const __m256 luminance_difference = _mm256_and_ps(_mm256_sub_ps(luminance, _mm256_loadu_ps(it.luminance + q)), sign_mask);
+            const __m256 depth_difference = _mm256_and_ps(_mm256_sub_ps(depth, _mm256_loadu_ps(it.depth + q)), sign_mask);
+            __m256 exponent = _mm256_mul_ps(luminance_difference, inverse_deviation);
+            exponent = raytracing_fmadd_ps(depth_difference, inverse_depth_tolerance[distance - 1], exponent);
+
+            // e^-x = 2^(-x log2 e), the fractional power by a polynomial and the integer one in the exponent bits
+            const __m256 power = _mm256_mul_ps(_mm256_min_ps(exponent, max_exponent), minus_log2e);
+            const __m256 integer_part = _mm256_floor_ps(power);
+            const __m256 f = _mm256_sub_ps(power, integer_part);
+            __m256 polynomial = _mm256_set1_ps(1.33335581e-3f);
+            polynomial = raytracing_fmadd_ps(polynomial, f, _mm256_set1_ps(9.61812911e-3f));
+            polynomial = raytracing_fmadd_ps(polynomial, f, _mm256_set1_ps(5.55041087e-2f));
+            polynomial = raytracing_fmadd_ps(polynomial, f, _mm256_set1_ps(2.40226507e-1f));
+            polynomial = raytracing_fmadd_ps(polynomial, f, _mm256_set1_ps(6.93147181e-1f));
+            polynomial = raytracing_fmadd_ps(polynomial, f, one);
+            const __m256i exponent_bits = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvttps_epi32(integer_part), _mm256_set1_epi32(127)), 23);
+            const __m256 exponential = _mm256_mul_ps(polynomial, _mm256_castsi256_ps(exponent_bits));
+
+            weight = _mm256_mul_ps(weight, _mm256_mul_ps(exponential, _mm256_set1_ps(kernel[i + 2] * kernel[j + 2])));
+
+            weight_sum = _mm256_add_ps(weight_sum, weight);
+            for (int c = 0; c < 3; c++)
+                sum[c] = raytracing_fmadd_ps(weight, _mm256_loadu_ps(it.color[c] + q), sum[c]);
+
+            variance_sum = raytracing_fmadd_ps(_mm256_mul_ps(weight, weight), _mm256_loadu_ps(it.variance + q), variance_sum);
+        }
+    }
+
+    // Escaped paths keep their values
+    const __m256 no_surface = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(nx, zero, _CMP_EQ_OQ), _mm256_cmp_ps(ny, zero, _CMP_EQ_OQ)), _mm256_cmp_ps(nz, zero, _CMP_EQ_OQ));
+    const __m256 inverse_weight_sum = _mm256_div_ps(one, weight_sum);
+
+    for (int c = 0; c < 3; c++)
+    {
+        const __m256 filtered = _mm256_mul_ps(sum[c], inverse_weight_sum);
+        _mm256_storeu_ps(it.filtered_color[c] + p, _mm256_blendv_ps(filtered, _mm256_loadu_ps(it.color[c] + p), no_surface));
+    }
+
+    const __m256 filtered_variance = _mm256_mul_ps(variance_sum, _mm256_mul_ps(inverse_weight_sum, inverse_weight_sum));
+    _mm256_storeu_ps(it.filtered_variance + p, _mm256_blendv_ps(filtered_variance, _mm256_loadu_ps(it.variance + p), no_surface));
+}
+#endif
+
+float Raytracing::Denoiser::fast_exp(float x)
+{
+    // Same evaluation as the vector kernel: e^-x = 2^i * 2^f, with a degree 5 polynomial for 2^f on [0, 1)
+    const float power = -std::min(x, 87.0f) * 1.44269504f;
+    const float integer_part = std::floor(power);
+    const float f = power - integer_part;
+
+    float polynomial = 1.33335581e-3f;
+    polynomial = polynomial * f + 9.61812911e-3f;
+    polynomial = polynomial * f + 5.55041087e-2f;
+    polynomial = polynomial * f + 2.40226507e-1f;
+    polynomial = polynomial * f + 6.93147181e-1f;
+    polynomial = polynomial * f + 1.0f;
+
+    return polynomial * std::bit_cast<float>(uint32_t(int32_t(integer_part) + 127) << 23);
+}
+
+float Raytracing::Denoiser::normal_weight(float cosine)
+{
+    // Cosine to the power of 128, which only tolerates a few degrees between the normals
+    float weight = std::max(cosine, 0.0f);
+
+    for (int k = 0; k < 7; k++)
+        weight *= weight;
+
+    return weight;
+}
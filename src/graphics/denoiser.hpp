@@ -0,0 +1,72 @@
+#pragma once
+
+// Headers
+#include "core/core.hpp"
+#include "core/simd.hpp"
+
+namespace Raytracing
+{
+    // Images the denoiser works on, one plane per channel (row-major). The guides describe the first surface seen
+    // through each pixel that is not a mirror or glass, averaged over its samples.
+    struct DenoiserBuffers
+    {
+        int width = 0;
+        int height = 0;
+
+        std::array<vector<float>, 3> color;     // Linear radiance, replaced by the filtered one
+        std::array<vector<float>, 3> albedo;    // Surface reflectance, the texture detail that must survive the filter
+        std::array<vector<float>, 3> normal;    // Shading normal, zero where the path escaped or was lost
+        vector<float> depth;                    // Distance from the camera to the first hit
+        vector<float> variance;                 // Variance of the luminance estimate of the pixel
+
+        DenoiserBuffers(int width, int height);
+    };
+
+    // Edge-avoiding a-trous wavelet filter (Dammertz et al.) with the variance guided edge stopping of SVGF (Schied
+    // et al.). The radiance is divided by the albedo first, so only the smooth incoming light is blurred and textures
+    // stay sharp. Every iteration applies a 5x5 B3 spline kernel whose taps are twice as far apart as in the previous
+    // one, and each tap is weighted down when its normal, depth or luminance differs from the center pixel. The
+    // luminance tolerance follows the noise of the pixel, which the filter reduces at every step.
+    // Rows are filtered in parallel and runs of 8 pixels away from the borders use an AVX2 kernel.
+    class Denoiser
+    {
+    public:
+        int iterations = 5;             // Kernel footprint is 4 * 2^iterations pixels wide
+        float luminance_sigma = 4.0f;   // Luminance tolerance in standard deviations of the pixel noise
+        float depth_sigma = 1.0f;       // Depth tolerance relative to the depth change expected from the surface slope
+        bool parallelize = true;
+
+        void denoise(DenoiserBuffers& buffers) const;
+
+    private:
+        // Planes read and written by one iteration
+        struct Iteration
+        {
+            int width = 0;
+            int height = 0;
+            int step = 1;                               // Pixels between two taps
+
+            const float* color[3] = {};
+            const float* luminance = nullptr;
+            const float* variance = nullptr;
+            const float* inverse_deviation = nullptr;   // Reciprocal of the luminance tolerance of each pixel
+            const float* normal[3] = {};
+            const float* depth = nullptr;
+            const float* depth_gradient = nullptr;      // Depth change to the next pixel
+
+            float* filtered_color[3] = {};
+            float* filtered_variance = nullptr;
+        };
+
+        static constexpr float kernel[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+        void filter_row(const Iteration& it, int y) const;
+        void filter_pixel(const Iteration& it, int x, int y) const;
+#if RAYTRACING_SIMD_AVX2
+        void filter_pixels_avx2(const Iteration& it, int x, int y) const;  // Pixels x to x + 7, every tap inside the row
+#endif
+
+        static float fast_exp(float x);         // e^-x for x >= 0, about 1e-4 relative error
+        static float normal_weight(float cosine);
+    };
+}
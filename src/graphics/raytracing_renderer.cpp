@@ -56,11 +56,14 @@ void RayTracingRenderer::clean()
 void RayTracingRenderer::update(float delta_time)
 {
     Renderer::update(delta_time);
+
+    // GPU resources are only touched from the main thread
+    upload_preview();
 }
 
 void RayTracingRenderer::render()
 {
-    if (manual_scene)
+    if (manual_scene || show_preview)
         screen_mesh->render();
 
     Renderer::render();
@@ -89,15 +92,8 @@ void RayTracingRenderer::resize_window(int width, int height)
     }
 }
 
-void RayTracingRenderer::render_manual_scene()
+void RayTracingRenderer::create_screen()
 {
-    // Set render type
-    manual_scene = true;
-
-    // Set 2D camera to generate the frame
-    camera_2d->set_view(glm::mat4x4(1.0f));
-    camera_2d->set_projection(glm::mat4x4(1.0f));
-
     // Create quad mesh to show gpu texture on window
     Surface* screen_surface = new Surface();
     screen_mesh = new MeshInstance3D();
@@ -117,6 +113,82 @@ void RayTracingRenderer::render_manual_scene()
     screen_material->set_diffuse_texture(screen_texture);
     screen_material->set_shader(RendererStorage::get_shader_from_source(shaders::mesh_forward::source, shaders::mesh_forward::path, shaders::mesh_forward::libraries, screen_material));
     screen_surface->set_material(screen_material);
+}
+
+void RayTracingRenderer::publish_preview(const ImageWriter& image)
+{
+    // The screen texture has four channels whatever the pixel type of the image
+    const int channels = image.get_num_channels();
+    const auto ubyte_data = image.get_ubyte_data();
+    const size_t total_pixels = size_t(image.get_width()) * image.get_height();
+
+    vector<uint8_t> pixels(4 * total_pixels, 255);
+
+    for (size_t i = 0; i < total_pixels; i++)
+    {
+        // Grayscale images fill the three color channels with their only one
+        for (int c = 0; c < 3; c++)
+            pixels[4 * i + c] = ubyte_data[channels * i + (channels < 3 ? 0 : c)];
+
+        if (channels == 2 || channels == 4)
+            pixels[4 * i + 3] = ubyte_data[channels * i + channels - 1];
+    }
+
+    std::lock_guard<std::mutex> guard(preview_mutex);
+    preview_pixels = std::move(pixels);
+    preview_width = image.get_width();
+    preview_height = image.get_height();
+    preview_pending = true;
+}
+
+void RayTracingRenderer::upload_preview()
+{
+    std::lock_guard<std::mutex> guard(preview_mutex);
+
+    // The preview covers the scene while a progressive render runs, the final image goes to disk. The render thread
+    // publishes its last pass before it stops rendering, so nothing is pending once both are seen under the lock.
+    if (!preview_pending)
+    {
+        if (!is_rendering)
+            show_preview = false;
+
+        return;
+    }
+
+    // Set 2D camera to show the frame
+    camera_2d->set_view(glm::mat4x4(1.0f));
+    camera_2d->set_projection(glm::mat4x4(1.0f));
+
+    if (!screen_mesh)
+        create_screen();
+
+    // The screen texture is created with the window size, which may have changed since the render started
+    if (uploaded_width != preview_width || uploaded_height != preview_height)
+    {
+        screen_texture->create(WGPUTextureDimension_2D, WGPUTextureFormat_RGBA8UnormSrgb, { uint32_t(preview_width), uint32_t(preview_height), 1 }, WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding, 1, 1, nullptr);
+        screen_mesh->get_surface_material(0)->set_dirty_flag(PROP_DIFFUSE_TEXTURE);
+
+        uploaded_width = preview_width;
+        uploaded_height = preview_height;
+    }
+
+    screen_texture->update(preview_pixels.data(), 0, {});
+
+    preview_pending = false;
+    show_preview = true;
+}
+
+void RayTracingRenderer::render_manual_scene()
+{
+    // Set render type
+    manual_scene = true;
+
+    // Set 2D camera to generate the frame
+    camera_2d->set_view(glm::mat4x4(1.0f));
+    camera_2d->set_projection(glm::mat4x4(1.0f));
+
+    // Quad showing the generated frame
+    create_screen();
 
     // Log space
     std::cout << std::endl;
@@ -187,6 +259,22 @@ void RayTracingRenderer::render_frame_async(std::stop_token s_token, shared_ptr<
         // Build scene
         scene.build(meshes);
 
+        // Every progressive pass is shown on screen and, if requested, written over the same file
+        if (settings.progressive || settings.time_budget)
+        {
+            string progress_name = get_current_timestamp() + "_progress";
+
+            camera.on_pass_completed = [this, &settings, progress_name](ImageWriter& pass_image, int samples)
+            {
+                publish_preview(pass_image);
+
+                if (settings.save_passes)
+                    pass_image.save(progress_name);
+
+                Logger::info("RayTracingRenderer", "Progressive pass published at " + std::to_string(samples) + " samples per pixel.");
+            };
+        }
+
         // Render scene
         camera.render(scene, image, s_token);
 
@@ -198,9 +286,23 @@ void RayTracingRenderer::render_frame_async(std::stop_token s_token, shared_ptr<
             return;
         }
 
+        // Filter the noise left by the samples
+        if (settings.denoise)
+            camera.denoise(scene, image);
+
         // Encode and save image with desired format
         image.save();
 
+        if (settings.save_aovs)
+            image.save_layers(camera.get_aovs());
+
+        // A budgeted render has no sample limit, the map is scaled to the pixel that took the most
+        if (settings.save_sample_map)
+        {
+            int max_samples = scene.time_budget > 0 ? std::ranges::max(camera.pixel_samples) : scene.samples_per_pixel;
+            image.save_sample_map(camera.pixel_samples, max_samples);
+        }
+
         // Scene end
         scene.end();
 
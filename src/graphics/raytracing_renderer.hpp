@@ -26,11 +26,26 @@ namespace Raytracing
         int bounce_max_depth = 50;
         float min_hit_distance = 0.001f;
         int samples_per_pixel = 100;
+        bool adaptive_sampling = false;
+        int min_samples_per_pixel = 16;
+        float adaptive_threshold = 0.01f;
+        bool progressive = false;
+        int samples_per_pass = 1;
+        bool time_budget = false;
+        float time_budget_seconds = 90.0f;
+
+        // Denoising
+        bool denoise = false;
+        int denoise_iterations = 5;
 
         // Optimizations
         bool bvh_optimization = true;
         bool russian_roulette = false;
         bool parallelize = true;
+        bool huge_pages = false;
+        LIGHT_SAMPLING light_sampling = LIGHT_SAMPLING::LIGHT_BVH;
+        bool skybox_sampling = true;
+        SAMPLER_TYPE sampler_type = SAMPLER_TYPE::SOBOL;
 
         // Background
         BACKGROUND_TYPE background_type = BACKGROUND_TYPE::SKYBOX;
@@ -50,6 +65,9 @@ namespace Raytracing
         IMAGE_FORMAT format = PNG_8;
         int quality = 100;
         string image_path = output_path;
+        bool save_sample_map = false;
+        bool save_passes = false;
+        bool save_aovs = false;
     };
 }
 
@@ -69,6 +87,20 @@ private:
 
     // Render
     void render_manual_scene();
+    void create_screen();
+
+    // Progressive preview, written by the render thread and uploaded to the screen texture by the main thread
+    std::mutex preview_mutex;
+    vector<uint8_t> preview_pixels;     // RGBA8 pixels of the last completed pass
+    int preview_width = 0;
+    int preview_height = 0;
+    int uploaded_width = 0;             // Size the screen texture was last created with for the preview
+    int uploaded_height = 0;
+    bool preview_pending = false;       // New pixels not uploaded yet, only accessed under preview_mutex
+    bool show_preview = false;
+
+    void publish_preview(const Raytracing::ImageWriter& image);
+    void upload_preview();              // Uploads pending pixels and hides the preview once the render is over
 
     // Aux vars
     bool manual_scene = false;
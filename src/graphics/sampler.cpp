@@ -0,0 +1,250 @@
+// Headers
+#include "core/core.hpp"
+#include "sampler.hpp"
+#include "utils/utilities.hpp"
+
+unique_ptr<Raytracing::Sampler> Raytracing::Sampler::create(SAMPLER_TYPE type)
+{
+    switch (type)
+    {
+    case SAMPLER_TYPE::INDEPENDENT:
+        return std::make_unique<IndependentSampler>();
+    case SAMPLER_TYPE::SOBOL:
+        return std::make_unique<SobolSampler>();
+    case SAMPLER_TYPE::BLUE_NOISE:
+        return std::make_unique<BlueNoiseSampler>();
+    default:
+        string error = Logger::error("SAMPLER", "Unknown sampler type");
+        throw std::invalid_argument(error);
+    }
+}
+
+void Raytracing::Sampler::start_pixel_sample(int pixel_row, int pixel_column, int sample_index)
+{
+    this->pixel_row = pixel_row;
+    this->pixel_column = pixel_column;
+    this->sample_index = uint32_t(sample_index);
+    this->dimension = 0;
+}
+
+uint64_t Raytracing::Sampler::hash(uint64_t a, uint64_t b, uint64_t c)
+{
+    // SplitMix64 finalizer applied after folding in each value
+    auto mix = [](uint64_t x)
+    {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    };
+
+    return mix(mix(mix(a) ^ b) ^ c);
+}
+
+double Raytracing::Sampler::to_unit(uint32_t bits)
+{
+    return std::min(double(bits) * 0x1p-32, one_minus_epsilon);
+}
+
+double Raytracing::IndependentSampler::get_1d()
+{
+    return random_number<double>();
+}
+
+pair<double, double> Raytracing::IndependentSampler::get_2d()
+{
+    return make_pair(random_number<double>(), random_number<double>());
+}
+
+double Raytracing::SobolSampler::get_1d()
+{
+    const uint32_t index = shuffled_index();
+    const double u = to_unit(owen_scramble(sobol(index, 0), seed(0)));
+    dimension++;
+
+    return u;
+}
+
+pair<double, double> Raytracing::SobolSampler::get_2d()
+{
+    const uint32_t index = shuffled_index();
+    const double u = to_unit(owen_scramble(sobol(index, 0), seed(0)));
+    const double v = to_unit(owen_scramble(sobol(index, 1), seed(1)));
+    dimension++;
+
+    return make_pair(u, v);
+}
+
+uint32_t Raytracing::SobolSampler::shuffled_index() const
+{
+    // Every dimension reuses the same two Sobol dimensions, so without a per dimension order of the samples the
+    // values of different dimensions would be strongly correlated. Scrambling the index permutes the samples within
+    // each power of two block, so any prefix of 2^k samples is still the same well distributed set.
+    return owen_scramble(sample_index, seed(2));
+}
+
+uint32_t Raytracing::SobolSampler::sobol(uint32_t index, int dimension)
+{
+    // The first dimension is the van der Corput sequence, the bits of the index mirrored
+    if (dimension == 0)
+        return reverse_bits(index);
+
+    const auto& matrix = sobol_matrix();
+    uint32_t bits = 0;
+
+    for (int bit = 0; index; bit++, index >>= 1)
+    {
+        if (index & 1)
+            bits ^= matrix[bit];
+    }
+
+    return bits;
+}
+
+uint32_t Raytracing::SobolSampler::owen_scramble(uint32_t bits, uint32_t seed)
+{
+    // Hash based nested uniform scrambling (Laine-Karras permutation with Burley's constants): every bit is flipped
+    // depending on the bits above it, so the hash runs on the reversed value where those bits are the low ones
+    bits = reverse_bits(bits);
+    bits += seed;
+    bits ^= bits * 0x6c50b47c;
+    bits ^= bits * 0xb82f1e52;
+    bits ^= bits * 0xc7afe638;
+    bits ^= bits * 0x8d22f6e6;
+
+    return reverse_bits(bits);
+}
+
+uint32_t Raytracing::SobolSampler::seed(uint32_t component) const
+{
+    const uint64_t pixel = (uint64_t(uint32_t(pixel_row)) << 32) | uint32_t(pixel_column);
+
+    return uint32_t(hash(pixel, dimension, component));
+}
+
+uint32_t Raytracing::SobolSampler::reverse_bits(uint32_t v)
+{
+    v = (v << 16) | (v >> 16);
+    v = ((v & 0x00ff00ff) << 8) | ((v & 0xff00ff00) >> 8);
+    v = ((v & 0x0f0f0f0f) << 4) | ((v & 0xf0f0f0f0) >> 4);
+    v = ((v & 0x33333333) << 2) | ((v & 0xcccccccc) >> 2);
+    v = ((v & 0x55555555) << 1) | ((v & 0xaaaaaaaa) >> 1);
+
+    return v;
+}
+
+const std::array<uint32_t, 32>& Raytracing::SobolSampler::sobol_matrix()
+{
+    // Primitive polynomial x + 1 with initial direction number 1: every column is the previous one xor itself shifted
+    static const std::array<uint32_t, 32> matrix = []()
+    {
+        std::array<uint32_t, 32> columns;
+        columns[0] = 1u << 31;
+
+        for (int i = 1; i < 32; i++)
+            columns[i] = columns[i - 1] ^ (columns[i - 1] >> 1);
+
+        return columns;
+    }();
+
+    return matrix;
+}
+
+double Raytracing::BlueNoiseSampler::get_1d()
+{
+    const double shift = mask_value(0);
+    const double u = SobolSampler::get_1d() + shift;
+
+    return u < 1 ? u : u - 1;
+}
+
+pair<double, double> Raytracing::BlueNoiseSampler::get_2d()
+{
+    const double shift_u = mask_value(0);
+    const double shift_v = mask_value(1);
+    auto [u, v] = SobolSampler::get_2d();
+
+    u += shift_u;
+    v += shift_v;
+
+    return make_pair(u < 1 ? u : u - 1, v < 1 ? v : v - 1);
+}
+
+uint32_t Raytracing::BlueNoiseSampler::seed(uint32_t component) const
+{
+    // Shared by every pixel, the mask is what tells pixels apart
+    return uint32_t(hash(0, dimension, component));
+}
+
+double Raytracing::BlueNoiseSampler::mask_value(uint32_t component) const
+{
+    const uint64_t offset = hash(1, dimension, component);
+
+    const int x = (pixel_column + int(offset & (mask_size - 1))) & (mask_size - 1);
+    const int y = (pixel_row + int((offset >> 8) & (mask_size - 1))) & (mask_size - 1);
+
+    return mask()[y * mask_size + x];
+}
+
+const vector<double>& Raytracing::BlueNoiseSampler::mask()
+{
+    static const vector<double> blue_noise = generate_mask();
+
+    return blue_noise;
+}
+
+vector<double> Raytracing::BlueNoiseSampler::generate_mask()
+{
+    const int count = mask_size * mask_size;
+    const double sigma = 1.5;
+
+    // Gaussian energy that a pixel adds at each toroidal offset
+    vector<double> kernel(count);
+
+    for (int dy = 0; dy < mask_size; dy++)
+    {
+        for (int dx = 0; dx < mask_size; dx++)
+        {
+            const int wx = std::min(dx, mask_size - dx);
+            const int wy = std::min(dy, mask_size - dy);
+            kernel[dy * mask_size + dx] = std::exp(-(wx * wx + wy * wy) / (2 * sigma * sigma));
+        }
+    }
+
+    // Tiny deterministic jitter breaks the ties of the empty mask, which would otherwise grow a regular lattice
+    std::mt19937 generator(0x5eed);
+    std::uniform_real_distribution<double> jitter(0, 1e-9);
+
+    vector<double> energy(count);
+    for (auto& e : energy)
+        e = jitter(generator);
+
+    vector<bool> occupied(count, false);
+    vector<double> ranks(count);
+
+    // Each new pixel goes into the largest void, the free pixel with the lowest energy. The insertion order is the rank.
+    for (int rank = 0; rank < count; rank++)
+    {
+        int best = -1;
+
+        for (int i = 0; i < count; i++)
+        {
+            if (!occupied[i] && (best < 0 || energy[i] < energy[best]))
+                best = i;
+        }
+
+        occupied[best] = true;
+        ranks[best] = (rank + 0.5) / count;
+
+        const int bx = best % mask_size;
+        const int by = best / mask_size;
+
+        for (int y = 0; y < mask_size; y++)
+        {
+            for (int x = 0; x < mask_size; x++)
+                energy[y * mask_size + x] += kernel[((y - by) & (mask_size - 1)) * mask_size + ((x - bx) & (mask_size - 1))];
+        }
+    }
+
+    return ranks;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// Headers
+#include "core/core.hpp"
+
+// Source of the random numbers of a camera path
+enum class SAMPLER_TYPE
+{
+    INDEPENDENT,    // Uniform random numbers
+    SOBOL,          // Owen scrambled Sobol points, decorrelated per pixel
+    BLUE_NOISE,     // Owen scrambled Sobol points shared by every pixel and shifted by a blue noise mask
+};
+
+namespace Raytracing
+{
+    // Generates the sample values a camera path consumes: the pixel position, lens, time, light choice, light point,
+    // scattering direction and Russian roulette decisions. Every call to get_1d or get_2d uses the next dimension of
+    // the current pixel sample, so paths that make the same decisions read the same dimensions and the samples of a
+    // pixel stay well distributed in each of them.
+    // A sampler holds the state of one pixel sample and is used by a single thread.
+    class Sampler
+    {
+    public:
+        virtual ~Sampler() = default;
+
+        static unique_ptr<Sampler> create(SAMPLER_TYPE type);
+
+        virtual void start_pixel_sample(int pixel_row, int pixel_column, int sample_index);  // Restarts at the first dimension
+
+        virtual double get_1d() = 0;                     // Value in [0, 1)
+        virtual pair<double, double> get_2d() = 0;       // Point in [0, 1)^2
+
+    protected:
+        int pixel_row = 0;
+        int pixel_column = 0;
+        uint32_t sample_index = 0;
+        uint32_t dimension = 0;
+
+        static uint64_t hash(uint64_t a, uint64_t b, uint64_t c);
+        static double to_unit(uint32_t bits);
+    };
+
+    class IndependentSampler : public Sampler
+    {
+    public:
+        double get_1d() override;
+        pair<double, double> get_2d() override;
+    };
+
+    // Padded Sobol sampler. Every dimension (or pair of dimensions) takes the first two Sobol dimensions, which form a
+    // (0,2)-sequence: any prefix of samples is stratified over every elementary interval of the square, whatever the
+    // sample count. Each dimension of each pixel gets its own Owen scrambling and its own order of the samples, which
+    // keeps that stratification while removing the correlation between dimensions and pixels.
+    class SobolSampler : public Sampler
+    {
+    public:
+        double get_1d() override;
+        pair<double, double> get_2d() override;
+
+        static uint32_t sobol(uint32_t index, int dimension);     // First two Sobol dimensions, as 32 bit fractions
+        static uint32_t owen_scramble(uint32_t bits, uint32_t seed);
+
+    protected:
+        virtual uint32_t seed(uint32_t component) const;          // Scrambling seed of the current dimension
+        uint32_t shuffled_index() const;                         // Order of the samples in the current dimension
+
+    private:
+        static uint32_t reverse_bits(uint32_t v);
+        static const std::array<uint32_t, 32>& sobol_matrix();    // Generator matrix of the second dimension, one column per index bit
+    };
+
+    // Same points in every pixel, each pixel rotates them (Cranley-Patterson rotation) by the value of a blue noise
+    // mask. The error of neighbouring pixels is then negatively correlated and the remaining noise has no low
+    // frequencies, which the eye perceives as much finer grain at low sample counts. Every dimension reads the mask
+    // with a different offset.
+    class BlueNoiseSampler : public SobolSampler
+    {
+    public:
+        double get_1d() override;
+        pair<double, double> get_2d() override;
+
+    protected:
+        uint32_t seed(uint32_t component) const override;
+
+    private:
+        static constexpr int mask_size = 64;
+
+        double mask_value(uint32_t component) const;
+        static const vector<double>& mask();
+        static vector<double> generate_mask();                   // Ranks of a void and cluster blue noise pattern
+    };
+}
@@ -2,20 +2,6 @@
 #include "core/core.hpp"
 #include "tone_mapper.hpp"
 
-const Raytracing::Matrix33 ToneMapper::ACESInputMat = Raytracing::Matrix33
-(
-    0.59719, 0.35458, 0.04823,
-    0.07600, 0.90834, 0.01566,
-    0.02840, 0.13383, 0.83777
-);
-
-const Raytracing::Matrix33 ToneMapper::ACESOutputMat = Raytracing::Matrix33
-(
-    1.60475, -0.53108, -0.07367,
-    -0.10208, 1.10813, -0.00605,
-    -0.00327, -0.07276, 1.07602
-);
-
 vec3 ToneMapper::RRTAndODTFit(vec3 v)
 {
     vec3 a = v * (v + 0.0245786f) - 0.000090537f;
@@ -1,8 +1,6 @@
 // Headers
 #include "core/core.hpp"
 #include "box.hpp"
-#include "quad.hpp"
-#include "hittable_list.hpp"
 #include "math/interval.hpp"
 #include "math/matrix.hpp"
 #include "utils/utilities.hpp"
@@ -12,8 +10,9 @@
 using Raytracing::Material;
 using Raytracing::Matrix44;
 using Raytracing::AABB;
+using Raytracing::infinity;
 
-Box::Box(point3 p0, point3 p1, const shared_ptr<Material>& material, const optional<Matrix44>& model, bool use_bvh) : material (material), use_bvh(use_bvh)
+Box::Box(point3 p0, point3 p1, const shared_ptr<Material>& material, const optional<Matrix44>& model, bool pdf) : material (material)
 {
 	// Validate that p0 and p1 are not aligned in any coordinate (this would define a line or a point instead of a box)
 	if (p0.x == p1.x || p0.y == p1.y || p0.z == p1.z)
@@ -22,85 +21,263 @@ Box::Box(point3 p0, point3 p1, const shared_ptr<Material>& material, const optio
 		throw std::invalid_argument(error);
 	}
 
-	// Define Box 
+	// Define Box
 	type = BOX;
-	this->p0 = p0;
-    this->p1 = p1;
+    this->pdf = pdf;
 
 	// Construct the two opposite vertices with the minimum and maximum coordinates.
-	auto min = min_vector(p0, p1);
-	auto max = max_vector(p0, p1);
-
-	// Construct the coordinate system of the box.
-	auto dx = vec3(max.x - min.x, 0, 0);
-	auto dy = vec3(0, max.y - min.y, 0);
-	auto dz = vec3(0, 0, max.z - min.z);
-
-	// Construct the box from the six quads that make up its sides.
-	auto quad1 = make_shared<Quad>(point3(min.x, min.y, max.z), dx, dy, material, model, false); // front
-	auto quad2 = make_shared<Quad>(point3(max.x, min.y, max.z), -dz, dy, material, model, false); // right
-	auto quad3 = make_shared<Quad>(point3(max.x, min.y, min.z), -dx, dy, material, model, false); // back
-	auto quad4 = make_shared<Quad>(point3(min.x, min.y, min.z), dz, dy, material, model, false); // left
-	auto quad5 = make_shared<Quad>(point3(min.x, max.y, max.z), dx, -dz, material, model, false); // top
-	auto quad6 = make_shared<Quad>(point3(min.x, min.y, min.z), dx, dz, material, model, false); // bottom
-
-	// Create sides
-	auto sides_list = hittable_list();
-	sides_list.add(quad1);
-	sides_list.add(quad2);
-	sides_list.add(quad3);
-	sides_list.add(quad4);
-	sides_list.add(quad5);
-	sides_list.add(quad6);
-
-    // Use bvh or hittable list
-    if (use_bvh)
+	min = min_vector(p0, p1);
+	max = max_vector(p0, p1);
+    size = max - min;
+
+    set_bbox();
+    set_model(model);
+}
+
+bool Box::hit(const Ray& r, const Interval& ray_t, hit_record& rec) const
+{
+    const Ray local_ray = transformed ? transform_ray(r) : r;
+    const point3& origin = local_ray.origin();
+    const vec3& direction = local_ray.direction();
+
+    // Slab test, remembering which face bounds the entry and the exit parameters
+    double t_enter = -infinity, t_exit = infinity;
+    int enter_face = 0, exit_face = 0;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const double inv_direction = 1.0 / direction[axis];
+        double t0 = (min[axis] - origin[axis]) * inv_direction;
+        double t1 = (max[axis] - origin[axis]) * inv_direction;
+        int face0 = 2 * axis, face1 = 2 * axis + 1;
+
+        if (inv_direction < 0)
+        {
+            std::swap(t0, t1);
+            std::swap(face0, face1);
+        }
+
+        if (t0 > t_enter)
+        {
+            t_enter = t0;
+            enter_face = face0;
+        }
+
+        if (t1 < t_exit)
+        {
+            t_exit = t1;
+            exit_face = face1;
+        }
+    }
+
+    if (t_enter > t_exit)
+        return false;
+
+    // Entry face first, the exit face is hit when the ray starts inside the box (dielectrics, volumes)
+    double t;
+    int face;
+
+    if (ray_t.contains(t_enter))
     {
-        auto sides_bvh = bvh_node(sides_list);
-        sides = make_shared<bvh_node>(sides_bvh);
-        set_stats(sides_bvh);
+        t = t_enter;
+        face = enter_face;
+    }
+    else if (ray_t.contains(t_exit))
+    {
+        t = t_exit;
+        face = exit_face;
     }
     else
     {
-        sides = make_shared<hittable_list>(sides_list);
+        return false;
     }
 
-    set_bbox();
-    set_model(model);
+    // Hit record
+    rec.set_primitive(this, t);
+    rec.primitive_index = uint32_t(face);
+
+    if (transformed)
+        record_instance(rec);
+
+    return true;
 }
 
-bool Box::hit(const Ray& r, const Interval& ray_t, hit_record& rec) const
+void Box::register_materials(Raytracing::MaterialTable& table)
+{
+    if (!material)
+        return;
+
+    material_id = table.add(material);
+    material.reset();
+}
+
+optional<Raytracing::material_index> Box::get_material_index() const
+{
+    return material_id;
+}
+
+void Box::surface_attributes(const Ray& local_ray, hit_record& rec) const
 {
-    if (!transformed)
-        return sides->hit(r, ray_t, rec);
+    const int face = int(rec.primitive_index);
+    const int axis = face / 2;
 
-    const Ray local_ray = transform_ray(r);
+    vec3 outward_normal = vec3(0, 0, 0);
+    outward_normal[axis] = (face % 2) ? 1.0 : -1.0;
 
-    const bool hit = sides->hit(local_ray, ray_t, rec);
+    rec.normal = outward_normal;
+    rec.material_id = material_id;
+    rec.texture_coordinates = face_uv(face, local_ray.at(rec.t));
+    rec.texture_scale = 1.0 / std::sqrt(face_area(face));
+    rec.type = type;
+}
 
-    if (hit)
-        transform_hit_record(rec);
+bool Box::can_bake_transform(const Matrix44& model) const
+{
+    // The box stays axis aligned only under translations and axis scaling
+    if (!model.is_affine())
+        return false;
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            if (i != j && model[i][j] != 0)
+                return false;
+        }
+    }
 
-    return hit;
+    return true;
+}
+
+void Box::bake_transform(const Matrix44& model)
+{
+    const point3 p0 = model.transform_point(min);
+    const point3 p1 = model.transform_point(max);
+
+	min = min_vector(p0, p1);
+	max = max_vector(p0, p1);
+    size = max - min;
+
+    clear_model();
+    set_bbox();
 }
 
 void Box::set_bbox()
 {
-    // Set bvh bounding box as the bounding box of the box
-    bbox = original_bbox = sides->get_bbox();
+    bbox = original_bbox = AABB(min, max);
+}
+
+double Box::pdf_value(const point3& origin, const vec3& direction) const
+{
+    hit_record rec;
+    auto ray = Ray(origin, direction);
+
+    if (!this->hit(ray, Interval(0.001, infinity), rec))
+        return 0;
+
+    Hittable::compute_surface_attributes(ray, rec);
+
+    double areas[6];
+    auto visible_area = visible_face_areas(instance.inverse_transform_point(origin), areas);
+
+    auto distance_squared = rec.t * rec.t * direction.length_squared();
+    auto cosine = fabs(dot(direction, rec.normal) / direction.length());
+
+    return distance_squared / (cosine * visible_area);
+}
+
+vec3 Box::random_scattering_ray(const point3& origin, const pair<double, double>& u) const
+{
+    // Choose a face among the ones seen from the origin proportionally to its area
+    double areas[6];
+    auto x = u.first * visible_face_areas(instance.inverse_transform_point(origin), areas);
+
+    int face = 0;
+    while (face < 5 && x >= areas[face])
+        x -= areas[face++];
+
+    // What is left of the first coordinate is uniform again within the chosen face
+    const double s = areas[face] > 0 ? std::min(x / areas[face], Raytracing::one_minus_epsilon) : 0;
+
+    // Uniform point on that face
+    const int axis = face / 2;
+    const int a1 = (axis + 1) % 3;
+    const int a2 = (axis + 2) % 3;
+
+    point3 p = min;
+    p[axis] = (face % 2) ? max[axis] : min[axis];
+    p[a1] += s * size[a1];
+    p[a2] += u.second * size[a2];
+
+    return instance.transform_point(p) - origin;
 }
 
-void Box::set_stats(const bvh_node& sides)
+double Box::get_area() const
 {
-    stats = sides.get_stats();
+    double total = 0;
+
+    for (int face = 0; face < 6; face++)
+        total += face_area(face);
+
+    return total;
 }
 
-const bvh_stats Box::get_stats() const
+shared_ptr<Material> Box::get_material()
 {
-    return stats;
+    return material;
 }
 
-const bool Box::is_bvh() const
+pair<double, double> Box::face_uv(int face, const point3& p) const
 {
-    return use_bvh;
+    // Same parametrization as the six quads the box used to be made of
+    const double x = (p.x - min.x) / size.x;
+    const double y = (p.y - min.y) / size.y;
+    const double z = (p.z - min.z) / size.z;
+
+    switch (face)
+    {
+    case 0: return make_pair(z, y);         // left
+    case 1: return make_pair(1 - z, y);     // right
+    case 2: return make_pair(x, z);         // bottom
+    case 3: return make_pair(x, 1 - z);     // top
+    case 4: return make_pair(1 - x, y);     // back
+    default: return make_pair(x, y);        // front
+    }
+}
+
+double Box::face_area(int face) const
+{
+    const int axis = face / 2;
+
+    vec3 e1 = vec3(0, 0, 0), e2 = vec3(0, 0, 0);
+    e1[(axis + 1) % 3] = size[(axis + 1) % 3];
+    e2[(axis + 2) % 3] = size[(axis + 2) % 3];
+
+    return cross(instance.transform_vector(e1), instance.transform_vector(e2)).length();
+}
+
+double Box::visible_face_areas(const point3& local_origin, double areas[6]) const
+{
+    double total = 0;
+
+    for (int face = 0; face < 6; face++)
+    {
+        const int axis = face / 2;
+        const bool facing = (face % 2) ? local_origin[axis] > max[axis] : local_origin[axis] < min[axis];
+
+        areas[face] = facing ? face_area(face) : 0;
+        total += areas[face];
+    }
+
+    // From inside the box every face is visible
+    if (total == 0)
+    {
+        for (int face = 0; face < 6; face++)
+        {
+            areas[face] = face_area(face);
+            total += areas[face];
+        }
+    }
+
+    return total;
 }
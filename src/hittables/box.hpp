@@ -3,27 +3,36 @@
 // Headers
 #include "hittable.hpp"
 #include "math/vec3.hpp"
-#include "utils/scene_stats.hpp"
-#include "hittables/bvh.hpp"
 #include "math/aabb.hpp"
 
+// Axis aligned box in object space, intersected analytically with the slab method. Oriented boxes come from the
+// instance transform. Faces are numbered 2 * axis + side (side 0 at the minimum corner, 1 at the maximum corner).
 class Box : public Hittable
 {
 public:
-	Box(point3 p0, point3 p1, const shared_ptr<Raytracing::Material>& material, const optional<Raytracing::Matrix44>& model = nullopt, bool use_bvh = true);
+	Box(point3 p0, point3 p1, const shared_ptr<Raytracing::Material>& material, const optional<Raytracing::Matrix44>& model = nullopt, bool pdf = false);
 
 	bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+    void register_materials(Raytracing::MaterialTable& table) override;
+    optional<Raytracing::material_index> get_material_index() const override;
+    bool can_bake_transform(const Raytracing::Matrix44& model) const override;
+    void bake_transform(const Raytracing::Matrix44& model) override;
     void set_bbox();
-    void set_stats(const bvh_node& sides);
-    const bvh_stats get_stats() const;
-    const bool is_bvh() const;
+    double pdf_value(const point3& hit_point, const vec3& scattering_direction) const override;
+    vec3 random_scattering_ray(const point3& hit_point, const pair<double, double>& u) const override;
+    double get_area() const override;
+    shared_ptr<Raytracing::Material> get_material();
 
-private:
-	vec3 p0, p1;
-	shared_ptr<Raytracing::Material> material;
-	shared_ptr<Hittable> sides;
-    bool use_bvh = true;
-    bvh_stats stats = bvh_stats();
-};
+protected:
+    void surface_attributes(const Ray& local_ray, hit_record& rec) const override;
 
+private:
+	point3 min, max;
+    vec3 size;
+	shared_ptr<Raytracing::Material> material;     // Released once registered in the scene material table
+    Raytracing::material_index material_id = 0;
 
+    pair<double, double> face_uv(int face, const point3& p) const;
+    double face_area(int face) const;                                           // World space area
+    double visible_face_areas(const point3& local_origin, double areas[6]) const; // Faces facing the origin (all of them from inside), returns their total area
+};
@@ -4,9 +4,11 @@
 #include "hittables/hittable_list.hpp"
 #include "utils/chrono.hpp"
 #include "ray.hpp"
+#include "core/arena.hpp"
 
 // Usings
 using Raytracing::AABB;
+using Raytracing::make_arena_shared;
 
 bvh_node::bvh_node(hittable_list list, const optional<Raytracing::Matrix44>& model)
 {
@@ -87,8 +89,8 @@ bvh_node::bvh_node(vector<shared_ptr<Hittable>>& objects, size_t start, size_t e
 
         // Create nodes
         auto mid = start + object_span / 2;
-        auto left_node = make_shared<bvh_node>(objects, start, mid, stats);
-        auto right_node = make_shared<bvh_node>(objects, mid, end, stats);
+        auto left_node = make_arena_shared<bvh_node>(objects, start, mid, stats);
+        auto right_node = make_arena_shared<bvh_node>(objects, mid, end, stats);
 
         // Update depth and nodes based on the children
         depth = std::max(left_node->depth, right_node->depth) + 1;
@@ -111,17 +113,33 @@ bool bvh_node::hit(const Ray& r, const Interval& ray_t, hit_record& rec) const
 
     bool hit_left = false, hit_right = false;
 
-    hit_left = left->hit(r, ray_t, rec);
+    hit_left = left->hit(local_ray, ray_t, rec);
 
     if (right != nullptr)
-        hit_right = right->hit(r, Interval(ray_t.min, hit_left ? rec.t : ray_t.max), rec);
+        hit_right = right->hit(local_ray, Interval(ray_t.min, hit_left ? rec.t : ray_t.max), rec);
 
     if (transformed && (hit_left || hit_right))
-        transform_hit_record(rec);
+        record_instance(rec);
 
     return hit_left || hit_right;
 }
 
+void bvh_node::register_materials(Raytracing::MaterialTable& table)
+{
+    left->register_materials(table);
+
+    if (right != nullptr)
+        right->register_materials(table);
+}
+
+vector<shared_ptr<Hittable>> bvh_node::get_children() const
+{
+    if (right == nullptr)
+        return { left };
+
+    return { left, right };
+}
+
 const bvh_stats bvh_node::get_stats() const
 {
     return stats;
@@ -24,6 +24,8 @@ public:
 
     bvh_node(vector<shared_ptr<Hittable>>& objects, size_t start, size_t end, bvh_stats& stats);
     bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+    void register_materials(Raytracing::MaterialTable& table) override;
+    vector<shared_ptr<Hittable>> get_children() const override;
 
     const bvh_stats get_stats() const;
 
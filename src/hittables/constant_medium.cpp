@@ -6,6 +6,7 @@
 #include "math/interval.hpp"
 #include "materials/material.hpp"
 #include "utils/utilities.hpp"
+#include "core/arena.hpp"
 
 // Usings
 using Raytracing::AABB;
@@ -14,15 +15,16 @@ using Raytracing::Texture;
 using Raytracing::color;
 using Raytracing::Isotropic;
 using Raytracing::infinity;
+using Raytracing::make_arena_shared;
 
 constant_medium::constant_medium(shared_ptr<Hittable> boundary, double density, shared_ptr<Texture> tex) 
-    : boundary(boundary), neg_inv_density(-1 / density), phase_function(make_shared<Isotropic>(tex))
+    : boundary(boundary), neg_inv_density(-1 / density), phase_function(make_arena_shared<Isotropic>(tex))
 {
     type = CONSTANT_MEDIUM;
 }
 
 constant_medium::constant_medium(shared_ptr<Hittable> boundary, double density, const color& albedo)
-    : boundary(boundary), neg_inv_density(-1 / density), phase_function(make_shared<Isotropic>(albedo))
+    : boundary(boundary), neg_inv_density(-1 / density), phase_function(make_arena_shared<Isotropic>(albedo))
 {
     type = CONSTANT_MEDIUM;
 }
@@ -53,13 +55,23 @@ bool constant_medium::hit(const Ray& r, const Interval& ray_t, hit_record& rec)
     if (hit_distance > distance_inside_boundary)
         return false;
 
-    rec.t = rec1.t + hit_distance / ray_length;
-    rec.p = r.at(rec.t);
+    rec.set_primitive(this, rec1.t + hit_distance / ray_length);
 
+    return true;
+}
+
+void constant_medium::register_materials(Raytracing::MaterialTable& table)
+{
+    if (!phase_function)
+        return;
+
+    phase_function_id = table.add(phase_function);
+    phase_function.reset();
+}
+
+void constant_medium::surface_attributes(const Ray& local_ray, hit_record& rec) const
+{
     rec.normal = vec3(1, 0, 0);  // arbitrary
-    rec.front_face = true;     // also arbitrary
-    rec.material = phase_function;
+    rec.material_id = phase_function_id;
     rec.type = type;
-
-    return true;
 }
@@ -18,11 +18,16 @@ public:
     constant_medium(shared_ptr<Hittable> boundary, double density, const Raytracing::color& albedo);
 
     bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+    void register_materials(Raytracing::MaterialTable& table) override;
+
+protected:
+    void surface_attributes(const Ray& local_ray, hit_record& rec) const override;
 
 private:
     shared_ptr<Hittable> boundary;
     double neg_inv_density;
-    shared_ptr<Raytracing::Material> phase_function;
+    shared_ptr<Raytracing::Material> phase_function;   // Released once registered in the scene material table
+    Raytracing::material_index phase_function_id = 0;
 };
 
 
@@ -10,6 +10,16 @@
 // Usings
 using Raytracing::Matrix44;
 
+void hit_record::set_primitive(const Hittable* primitive, double t, double u, double v)
+{
+    this->t = t;
+    this->primitive = primitive;
+    this->u = u;
+    this->v = v;
+    primitive_index = 0;
+    num_instances = 0;
+}
+
 void hit_record::determine_normal_direction(const vec3& ray_direction, const vec3& outward_normal)
 {
     // NOTE: The parameter `outward_normal` is assumed to have unit length.
@@ -50,12 +60,12 @@ HITTABLE_TYPE Hittable::get_type() const
 
 bool Hittable::is_primitive() const
 {
-    return type == TRIANGLE || type == SPHERE || type == QUAD;
+    return type == TRIANGLE || type == SPHERE || type == QUAD || type == BOX;
 }
 
 bool Hittable::is_bvh_tree() const
 {
-    return type == BOX || type == MESH || type == SURFACE;
+    return type == MESH || type == SURFACE || type == SPHERE_CLOUD;
 }
 
 double Hittable::pdf_value(const point3& hit_point, const vec3& scattering_direction) const
@@ -63,12 +73,53 @@ double Hittable::pdf_value(const point3& hit_point, const vec3& scattering_direc
     return 0.0;
 }
 
+void Hittable::register_materials(Raytracing::MaterialTable& table)
+{
+
+}
+
+double Hittable::get_area() const
+{
+    return 0;
+}
+
+normal_bounds Hittable::get_normal_bounds() const
+{
+    return normal_bounds();
+}
+
+optional<Raytracing::material_index> Hittable::get_material_index() const
+{
+    return nullopt;
+}
+
+vector<shared_ptr<Hittable>> Hittable::get_children() const
+{
+    return {};
+}
+
+bool Hittable::can_bake_transform(const Matrix44& model) const
+{
+    return false;
+}
+
+void Hittable::bake_transform(const Matrix44& model)
+{
+    string error = Logger::error("HITTABLE", "Transform baking requested from a hittable that does not support it");
+    throw std::runtime_error(error);
+}
+
+Matrix44 Hittable::compose_model(const Matrix44& parent_model) const
+{
+    return transformed ? parent_model * model : parent_model;
+}
+
 const bool Hittable::has_pdf() const
 {
     return pdf;
 }
 
-vec3 Hittable::random_scattering_ray(const point3& hit_point) const
+vec3 Hittable::random_scattering_ray(const point3& hit_point, const pair<double, double>& u) const
 {
     return vec3(1, 0, 0);
 }
@@ -90,8 +141,8 @@ void Hittable::translate(const vec3& translation)
 
     transform.set_translation(translation);
     model = transform.get_model();
-    inverse_model = model.inverse();
-    transformed = true;
+    instance = Raytracing::AffineTransform(model);
+    transformed = !instance.is_identity();
 
     transform_bbox(model);
 }
@@ -103,8 +154,8 @@ void Hittable::rotate(const vec3& axis, const double& angle)
 
     transform.set_rotation(axis, angle);
     model = transform.get_model();
-    inverse_model = model.inverse();
-    transformed = true;
+    instance = Raytracing::AffineTransform(model);
+    transformed = !instance.is_identity();
 
     transform_bbox(model);
 }
@@ -116,8 +167,8 @@ void Hittable::scale(const vec3& scaling)
 
     transform.set_scaling(scaling);
     model = transform.get_model();
-    inverse_model = model.inverse();
-    transformed = true;
+    instance = Raytracing::AffineTransform(model);
+    transformed = !instance.is_identity();
 
     transform_bbox(model);
 }
@@ -132,13 +183,13 @@ void Hittable::set_model(const optional<Raytracing::Matrix44>& model)
     if (!model.has_value())
         return;
 
-    if (model.value() == Raytracing::Matrix44::identity(4))
+    if (model.value() == Raytracing::Matrix44::identity())
         return;
 
     transform.set_model(model.value());
     this->model = model.value();
-    inverse_model = model.value().inverse();
-    transformed = true;
+    instance = Raytracing::AffineTransform(this->model);
+    transformed = !instance.is_identity();
 
     transform_bbox(model);
 }
@@ -150,12 +201,21 @@ void Hittable::set_model(const glm::mat4x4& model)
 
     transform = Raytracing::Transform(model);
     this->model = model;
-    inverse_model = glm::inverse(model);
-    transformed = true;
+    instance = Raytracing::AffineTransform(this->model);
+    transformed = !instance.is_identity();
 
     transform_bbox(model);
 }
 
+void Hittable::clear_model()
+{
+    transform = Raytracing::Transform();
+    model = Matrix44::identity();
+    instance = Raytracing::AffineTransform();
+    transformed = false;
+    bbox = original_bbox;
+}
+
 void Hittable::transform_bbox(const optional<Raytracing::Matrix44>& model)
 {
     if (!original_bbox.has_value())
@@ -169,17 +229,57 @@ void Hittable::transform_bbox(const optional<Raytracing::Matrix44>& model)
 
 const Ray Hittable::transform_ray(const Ray& r) const
 {
+    if (instance.is_identity())
+        return r;
+
     // Transform ray into object space
-    auto transformed_origin = (inverse_model * vec4(r.origin(), 1.0)).dehomogenize();
-    auto transformed_direction = inverse_model * vec4(r.direction(), 0.0);
+    auto transformed_origin = instance.inverse_transform_point(r.origin());
+    auto transformed_direction = instance.inverse_transform_vector(r.direction());
     auto transformed_ray = Ray(transformed_origin, transformed_direction, r.time());
 
     return transformed_ray;
 }
 
-void Hittable::transform_hit_record(hit_record& rec) const
+void Hittable::record_instance(hit_record& rec) const
+{
+    // Surface attributes are brought back into world space once, after traversal
+    if (rec.num_instances < hit_record::max_instance_depth)
+        rec.instances[rec.num_instances++] = this;
+}
+
+void Hittable::surface_attributes(const Ray& local_ray, hit_record& rec) const
 {
-    // Transform hit record results back into world space
-    rec.p = (model * vec4(rec.p, 1.0)).dehomogenize();
-    rec.normal = (model * vec4(rec.normal, 0.0)).normalize();
+    string error = Logger::error("HITTABLE", "Surface attributes requested from a non primitive hittable");
+    throw std::runtime_error(error);
+}
+
+void Hittable::compute_surface_attributes(const Ray& r, hit_record& rec)
+{
+    // Take the ray into the primitive object space, outermost instance first
+    Ray local_ray = r;
+    for (int i = rec.num_instances - 1; i >= 0; i--)
+        local_ray = rec.instances[i]->transform_ray(local_ray);
+
+    rec.primitive->surface_attributes(local_ray, rec);
+
+    // Normals go through the inverse-transpose so they stay perpendicular under non-uniform scale
+    vec3 outward_normal = rec.normal;
+    double area_scale = 1;
+    for (int i = 0; i < rec.num_instances; i++)
+    {
+        outward_normal = rec.instances[i]->instance.transform_normal(outward_normal);
+        area_scale *= rec.instances[i]->instance.determinant();
+    }
+
+    // The texture scale is given per unit of local length, the instances stretch the surface around the hit by the
+    // square root of its area change
+    if (rec.num_instances > 0 && rec.texture_scale > 0)
+    {
+        area_scale *= outward_normal.length() / rec.normal.length();
+        rec.texture_scale = area_scale > 0 ? rec.texture_scale / std::sqrt(area_scale) : 0;
+    }
+
+    // The ray parameter is preserved by affine transforms, so the world hit point comes straight from the world ray
+    rec.p = r.at(rec.t);
+    rec.determine_normal_direction(r.direction(), rec.num_instances > 0 ? unit_vector(outward_normal) : outward_normal);
 }
@@ -6,6 +6,8 @@
 #include "math/aabb.hpp"
 #include "math/matrix.hpp"
 #include "math/transform.hpp"
+#include "math/affine_transform.hpp"
+#include "materials/material_table.hpp"
 
 // Forward declarations
 struct Ray;
@@ -26,37 +28,51 @@ enum HITTABLE_TYPE
     BOX,
     MESH,
     SURFACE,
+    SPHERE_CLOUD,
     BVH_NODE,
     HITTABLE_LIST,
 	NOT_SPECIFIED
 };
 
-struct barycentric_coordinates
-{
-	double u, v, w;
-};
+// Forward declarations
+class Hittable;
 
 struct hit_record
 {
 public:
-    // General attributes
+    static constexpr int max_instance_depth = 8;
+
+    // Traversal attributes (written by every closer candidate)
+    double t;
+    const Hittable* primitive = nullptr;                    // Closest primitive found so far
+    double u = 0, v = 0;                                    // Primitive parametric coordinates (barycentrics for triangles)
+    uint32_t primitive_index = 0;                           // Element hit inside an aggregate primitive (sphere clouds)
+    const Hittable* instances[max_instance_depth];          // Transformed ancestors of the primitive, innermost first
+    int num_instances = 0;
+
+    // Surface attributes (evaluated once for the closest hit by Hittable::compute_surface_attributes)
     point3 p;
     vec3 normal;
-    double t;
     bool front_face;
-    shared_ptr<Raytracing::Material> material;
+    Raytracing::material_index material_id = 0;
+    const Raytracing::Material* material = nullptr;                 // Resolved from the scene material table
     optional<pair<double, double>> texture_coordinates = nullopt;
+    double texture_scale = 0;                                       // Texture coordinate change per unit of length on the surface, 0 if unknown
+    double texture_footprint = 0;                                   // Width of the ray cone at the hit in texture coordinates, set by the camera
+    optional<vec3> vertex_color = nullopt;
     HITTABLE_TYPE type = NOT_SPECIFIED;
-    vector<unsigned long long> elapsed_nanoseconds;
-
-    // Triangle attributes
-    optional<barycentric_coordinates> bc;
-
-    virtual ~hit_record() = default; 
 
+    void set_primitive(const Hittable* primitive, double t, double u = 0, double v = 0);          // Records a closer candidate and resets its instance chain
     void determine_normal_direction(const vec3& ray_direction, const vec3& outward_normal);     // Sets the hit record normal vector direction.
 };
 
+// Directions a surface faces, a cone around an axis. Used to bound the emission of lights.
+struct normal_bounds
+{
+    vec3 axis = vec3(0, 0, 1);
+    double cos_theta = -1;      // Cosine of the cone half angle, -1 covers every direction (curved or closed surfaces)
+};
+
 class Hittable
 {
 public:
@@ -70,7 +86,19 @@ public:
     bool is_bvh_tree() const;
     virtual double pdf_value(const point3& hit_point, const vec3& scattering_direction) const;
     const bool has_pdf() const;
-    virtual vec3 random_scattering_ray(const point3& hit_point) const;
+    virtual vec3 random_scattering_ray(const point3& hit_point, const pair<double, double>& u) const;
+    virtual double get_area() const;                                // World space surface area of primitives that can be sampled as lights
+    virtual normal_bounds get_normal_bounds() const;                // World space directions of the surface normals
+
+    static void compute_surface_attributes(const Ray& r, hit_record& rec); // Evaluates the deferred surface attributes of the closest hit
+    virtual void register_materials(Raytracing::MaterialTable& table);     // Moves primitive materials into the scene table and keeps their index
+    virtual optional<Raytracing::material_index> get_material_index() const; // Index of a registered primitive material, nullopt for aggregates
+
+    // Scene flattening (build time only)
+    virtual vector<shared_ptr<Hittable>> get_children() const;                  // Direct children of aggregates, empty for primitives
+    virtual bool can_bake_transform(const Raytracing::Matrix44& model) const;   // Whether the geometry can absorb the given model
+    virtual void bake_transform(const Raytracing::Matrix44& model);             // Moves the geometry by the model and drops its own instance transform
+    Raytracing::Matrix44 compose_model(const Raytracing::Matrix44& parent_model) const;
 
     Raytracing::Matrix44 get_model() const;
     Raytracing::Transform get_transform() const;
@@ -85,17 +113,20 @@ protected:
     optional<Raytracing::AABB> original_bbox = nullopt;
     optional<Raytracing::AABB> bbox = nullopt;
     Raytracing::Transform transform = Raytracing::Transform();
-    Raytracing::Matrix44 model = Raytracing::Matrix::identity(4);
-    Raytracing::Matrix44 inverse_model = Raytracing::Matrix::identity(4);
+    Raytracing::Matrix44 model = Raytracing::Matrix44::identity();
+    Raytracing::AffineTransform instance = Raytracing::AffineTransform();    // Cached model, inverse and normal matrix used when intersecting
     HITTABLE_TYPE type = NOT_SPECIFIED;
     bool transformed = false;
     bool pdf = false;
 
     void set_model(const optional<Raytracing::Matrix44>& model);
     void set_model(const glm::mat4x4& model);
+    void clear_model();
+
+    virtual void surface_attributes(const Ray& local_ray, hit_record& rec) const; // Fills material, uvs and the object space outward normal
 
     const Ray transform_ray(const Ray& r) const;
-    void transform_hit_record(hit_record& rec) const;
+    void record_instance(hit_record& rec) const;
 
 private:
     void transform_bbox(const optional<Raytracing::Matrix44>& model);
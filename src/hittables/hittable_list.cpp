@@ -70,26 +70,36 @@ bool hittable_list::hit(const Ray& r, const Interval& ray_t, hit_record& rec) co
 {
     const Ray local_ray = transformed ? transform_ray(r) : r;
 
-    hit_record temp_rec;
     bool hit_anything = false;
     auto closest_object_so_far = ray_t.max;
 
+    // Primitives only write the record on a closer hit, so it can be passed down without a temporary copy
     for (const auto& object : objects)
     {
-        if (object->hit(r, Interval(ray_t.min, closest_object_so_far), temp_rec))
+        if (object->hit(local_ray, Interval(ray_t.min, closest_object_so_far), rec))
         {
             hit_anything = true;
-            closest_object_so_far = temp_rec.t;
-            rec = temp_rec;
+            closest_object_so_far = rec.t;
         }
     }
 
     if (transformed && hit_anything)
-        transform_hit_record(rec);
+        record_instance(rec);
 
     return hit_anything;
 }
 
+void hittable_list::register_materials(Raytracing::MaterialTable& table)
+{
+    for (const auto& object : objects)
+        object->register_materials(table);
+}
+
+vector<shared_ptr<Hittable>> hittable_list::get_children() const
+{
+    return objects;
+}
+
 shared_ptr<Hittable> hittable_list::operator[](int i) const
 {
     return objects[i];
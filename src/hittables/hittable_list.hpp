@@ -26,6 +26,8 @@ public:
 	size_t size() const;
     void reserve(size_t size);
     bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+    void register_materials(Raytracing::MaterialTable& table) override;
+    vector<shared_ptr<Hittable>> get_children() const override;
   
 	shared_ptr<Hittable> operator[](int i) const;
 };
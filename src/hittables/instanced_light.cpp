@@ -0,0 +1,76 @@
+// Headers
+#include "core/core.hpp"
+#include "instanced_light.hpp"
+#include "ray.hpp"
+
+// Usings
+using Raytracing::Matrix44;
+
+InstancedLight::InstancedLight(const shared_ptr<Hittable>& primitive, const Matrix44& model) : primitive(primitive)
+{
+    type = primitive->get_type();
+    pdf = true;
+
+    bbox = original_bbox = primitive->get_bbox();
+    set_model(model);
+}
+
+bool InstancedLight::hit(const Ray& r, const Interval& ray_t, hit_record& rec) const
+{
+    if (!primitive->hit(transform_ray(r), ray_t, rec))
+        return false;
+
+    record_instance(rec);
+
+    return true;
+}
+
+optional<Raytracing::material_index> InstancedLight::get_material_index() const
+{
+    return primitive->get_material_index();
+}
+
+double InstancedLight::pdf_value(const point3& hit_point, const vec3& scattering_direction) const
+{
+    const vec3 local_direction = instance.inverse_transform_vector(scattering_direction);
+    const double local_pdf = primitive->pdf_value(instance.inverse_transform_point(hit_point), local_direction);
+
+    if (local_pdf <= 0)
+        return 0;
+
+    // Change of the solid angle measure under the linear part of the model
+    const double stretch = scattering_direction.length() / local_direction.length();
+
+    return local_pdf * stretch * stretch * stretch / instance.determinant();
+}
+
+vec3 InstancedLight::random_scattering_ray(const point3& hit_point, const pair<double, double>& u) const
+{
+    // Affine maps keep the ray parameter, the local direction to the sample becomes the world one
+    return instance.transform_vector(primitive->random_scattering_ray(instance.inverse_transform_point(hit_point), u));
+}
+
+double InstancedLight::get_area() const
+{
+    // Surface stretch along the main normal (Nanson's formula), the same everywhere on a flat primitive
+    const vec3 axis = unit_vector(primitive->get_normal_bounds().axis);
+
+    return primitive->get_area() * instance.determinant() * instance.transform_normal(axis).length();
+}
+
+normal_bounds InstancedLight::get_normal_bounds() const
+{
+    normal_bounds bounds = primitive->get_normal_bounds();
+    bounds.axis = unit_vector(instance.transform_normal(bounds.axis));
+
+    // A flat normal stays flat, a cone would have to be bounded again under non-uniform scale
+    if (bounds.cos_theta < 1)
+        bounds.cos_theta = -1;
+
+    return bounds;
+}
+
+const Hittable* InstancedLight::get_primitive() const
+{
+    return primitive.get();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Headers
+#include "hittable.hpp"
+
+// Emissive primitive below a transformed aggregate, placed in world space so the light sampler can use it. Rays keep
+// hitting the primitive through its aggregates, this copy of the model is only used to draw light samples and to
+// evaluate their density. Samples are drawn by the primitive in its own space and moved by the model; the solid
+// angle densities differ by |M w|^3 / |det M| for a unit local direction w, so any primitive light can be wrapped.
+class InstancedLight : public Hittable
+{
+public:
+    InstancedLight(const shared_ptr<Hittable>& primitive, const Raytracing::Matrix44& model);
+
+    bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+    optional<Raytracing::material_index> get_material_index() const override;
+    double pdf_value(const point3& hit_point, const vec3& scattering_direction) const override;
+    vec3 random_scattering_ray(const point3& hit_point, const pair<double, double>& u) const override;
+    double get_area() const override;                   // Exact for flat primitives and uniform scales
+    normal_bounds get_normal_bounds() const override;
+    const Hittable* get_primitive() const;
+
+private:
+    shared_ptr<Hittable> primitive;
+};
@@ -0,0 +1,494 @@
+// Headers
+#include "core/core.hpp"
+#include "light_sampler.hpp"
+#include "instanced_light.hpp"
+#include "materials/material.hpp"
+#include "graphics/color.hpp"
+#include "utils/utilities.hpp"
+
+// Usings
+using Raytracing::MaterialTable;
+using Raytracing::pi;
+
+LightSampler::LightSampler() {}
+
+void LightSampler::build(const vector<shared_ptr<Hittable>>& lights, const MaterialTable& materials, LIGHT_SAMPLING strategy)
+{
+    clear();
+
+    this->strategy = strategy;
+
+    vector<build_item> items;
+
+    for (const auto& light : lights)
+    {
+        if (light_entries.contains(light.get()))
+            continue;
+
+        auto material_id = light->get_material_index();
+
+        if (!material_id)
+            continue;
+
+        // Flux of a diffuse emitter, lights that cannot emit are left out
+        double power = luminance(materials[material_id.value()]->average_emission()) * light->get_area() * pi;
+
+        if (power <= 0)
+            continue;
+
+        auto bbox = light->get_bbox();
+        light_bounds bounds = { bbox.min_corner, bbox.max_corner, power, light->get_normal_bounds() };
+
+        items.push_back({ uint32_t(this->lights.size()), bounds, bbox.center });
+        light_entries[light.get()] = { uint32_t(this->lights.size()) };
+
+        // Rays hit the wrapped primitive, not its world space placement
+        if (auto instanced_light = dynamic_cast<const InstancedLight*>(light.get()))
+            primitive_lights[instanced_light->get_primitive()] = light.get();
+
+        this->lights.push_back(light);
+    }
+
+    if (items.empty())
+        return;
+
+    if (strategy == LIGHT_SAMPLING::POWER)
+    {
+        build_alias_table(items);
+        return;
+    }
+
+    nodes.reserve(2 * items.size() - 1);
+    build_node(items, 0, items.size(), 0, 0);
+}
+
+void LightSampler::clear()
+{
+    nodes.clear();
+    alias_table.clear();
+    power_probabilities.clear();
+    lights.clear();
+    light_entries.clear();
+    primitive_lights.clear();
+}
+
+bool LightSampler::empty() const
+{
+    return lights.empty();
+}
+
+size_t LightSampler::size() const
+{
+    return lights.size();
+}
+
+size_t LightSampler::get_node_count() const
+{
+    return nodes.size();
+}
+
+LIGHT_SAMPLING LightSampler::get_strategy() const
+{
+    return strategy;
+}
+
+bool LightSampler::contains(const Hittable* light) const
+{
+    return light_entries.contains(light);
+}
+
+const Hittable* LightSampler::find(const Hittable* primitive) const
+{
+    if (light_entries.contains(primitive))
+        return primitive;
+
+    auto it = primitive_lights.find(primitive);
+
+    return it != primitive_lights.end() ? it->second : nullptr;
+}
+
+const Hittable* LightSampler::sample(const point3& origin, double u, double& probability) const
+{
+    probability = 0;
+
+    if (lights.empty())
+        return nullptr;
+
+    if (strategy == LIGHT_SAMPLING::POWER)
+        return sample_power(u, probability);
+
+    return sample_bvh(origin, u, probability);
+}
+
+double LightSampler::probability(const point3& origin, const Hittable* light) const
+{
+    auto it = light_entries.find(light);
+
+    if (it == light_entries.end())
+        return 0;
+
+    if (strategy == LIGHT_SAMPLING::POWER)
+        return power_probabilities[it->second.index];
+
+    return bvh_probability(origin, it->second.trail);
+}
+
+const Hittable* LightSampler::sample_power(double u, double& probability) const
+{
+    // The integer part of the scaled value picks the bin, the fractional part decides between the bin and its alias
+    const double scaled = u * double(alias_table.size());
+    const size_t bin = std::min(size_t(scaled), alias_table.size() - 1);
+    const uint32_t light = (scaled - double(bin)) < alias_table[bin].threshold ? uint32_t(bin) : alias_table[bin].alias;
+
+    probability = power_probabilities[light];
+
+    return lights[light].get();
+}
+
+const Hittable* LightSampler::sample_bvh(const point3& origin, double u, double& probability) const
+{
+    double path_probability = 1;
+    uint32_t index = 0;
+
+    while (!nodes[index].leaf)
+    {
+        const uint32_t left = index + 1;
+        const uint32_t right = nodes[index].index;
+
+        const double left_importance = nodes[left].bounds.importance(origin);
+        const double right_importance = nodes[right].bounds.importance(origin);
+
+        // No light below this node can reach the point
+        if (left_importance + right_importance <= 0)
+            return nullptr;
+
+        const double left_probability = left_importance / (left_importance + right_importance);
+
+        // The sample value is rescaled to [0, 1) within the chosen branch, so a single value drives the whole descent
+        if (u < left_probability)
+        {
+            u = std::min(u / left_probability, Raytracing::one_minus_epsilon);
+            path_probability *= left_probability;
+            index = left;
+        }
+        else
+        {
+            u = std::min((u - left_probability) / (1 - left_probability), Raytracing::one_minus_epsilon);
+            path_probability *= 1 - left_probability;
+            index = right;
+        }
+    }
+
+    // A single light is only skipped when it cannot reach the point at all
+    if (index == 0 && nodes[0].bounds.importance(origin) <= 0)
+        return nullptr;
+
+    probability = path_probability;
+
+    return lights[nodes[index].index].get();
+}
+
+double LightSampler::bvh_probability(const point3& origin, uint64_t trail) const
+{
+    // Same choices as sample_bvh(), following the branches that lead to the light
+    double path_probability = 1;
+    uint32_t index = 0;
+
+    while (!nodes[index].leaf)
+    {
+        const uint32_t left = index + 1;
+        const uint32_t right = nodes[index].index;
+
+        const double left_importance = nodes[left].bounds.importance(origin);
+        const double right_importance = nodes[right].bounds.importance(origin);
+
+        if (left_importance + right_importance <= 0)
+            return 0;
+
+        const double left_probability = left_importance / (left_importance + right_importance);
+
+        if (trail & 1)
+        {
+            path_probability *= 1 - left_probability;
+            index = right;
+        }
+        else
+        {
+            path_probability *= left_probability;
+            index = left;
+        }
+
+        trail >>= 1;
+    }
+
+    if (index == 0 && nodes[0].bounds.importance(origin) <= 0)
+        return 0;
+
+    return path_probability;
+}
+
+double LightSampler::light_bounds::importance(const point3& p) const
+{
+    const point3 center = 0.5 * (min + max);
+    const vec3 diagonal = max - min;
+    const vec3 to_point = p - center;
+    const double distance_squared = to_point.length_squared();
+
+    // Clamped so points inside or next to the bounds do not get an unbounded importance
+    const double clamped_distance_squared = std::max(distance_squared, diagonal.length() / 2);
+
+    // Angle between the normal cone axis and the direction to the point
+    const double cos_w = distance_squared > 0 ? dot(normals.axis, to_point) / std::sqrt(distance_squared) : 1;
+    const double sin_w = std::sqrt(std::max(0.0, 1 - cos_w * cos_w));
+
+    // Angle subtended by the bounds seen from the point, every direction when the point is inside
+    const double radius_squared = (0.5 * diagonal).length_squared();
+    double cos_b = -1, sin_b = 0;
+
+    if (distance_squared > radius_squared)
+    {
+        const double sin_b_squared = radius_squared / distance_squared;
+        cos_b = std::sqrt(1 - sin_b_squared);
+        sin_b = std::sqrt(sin_b_squared);
+    }
+
+    // Smallest angle between the direction to the point and a normal of the cone, then of any point of the bounds
+    const double cos_o = normals.cos_theta;
+    const double sin_o = std::sqrt(std::max(0.0, 1 - cos_o * cos_o));
+
+    const double cos_x = cos_w > cos_o ? 1 : cos_w * cos_o + sin_w * sin_o;
+    const double sin_x = cos_w > cos_o ? 0 : sin_w * cos_o - cos_w * sin_o;
+    const double cos_p = cos_x > cos_b ? 1 : cos_x * cos_b + sin_x * sin_b;
+
+    // Points behind every emitting side receive no light
+    if (cos_p <= 0)
+        return 0;
+
+    return power * cos_p / clamped_distance_squared;
+}
+
+uint32_t LightSampler::build_node(vector<build_item>& items, size_t start, size_t end, uint64_t trail, int depth)
+{
+    const uint32_t index = uint32_t(nodes.size());
+    nodes.emplace_back();
+
+    if (end - start == 1)
+    {
+        nodes[index] = { items[start].bounds, items[start].light, true };
+        light_entries[lights[items[start].light].get()].trail = trail;
+        return index;
+    }
+
+    light_bounds node_bounds = items[start].bounds;
+    for (size_t i = start + 1; i < end; i++)
+        node_bounds = merge(node_bounds, items[i].bounds);
+
+    const size_t mid = split(items, start, end, node_bounds, depth);
+
+    build_node(items, start, mid, trail, depth + 1);
+    const uint32_t right = build_node(items, mid, end, trail | (uint64_t(1) << depth), depth + 1);
+
+    nodes[index] = { node_bounds, right, false };
+
+    return index;
+}
+
+void LightSampler::build_alias_table(const vector<build_item>& items)
+{
+    const size_t count = items.size();
+
+    double total_power = 0;
+    for (const auto& item : items)
+        total_power += item.bounds.power;
+
+    power_probabilities.resize(count);
+    alias_table.resize(count);
+
+    // Probabilities scaled by the light count, a bin holds exactly one unit of probability
+    vector<double> scaled(count);
+    vector<uint32_t> under, over;
+
+    for (const auto& item : items)
+    {
+        power_probabilities[item.light] = item.bounds.power / total_power;
+        scaled[item.light] = power_probabilities[item.light] * double(count);
+
+        if (scaled[item.light] < 1)
+            under.push_back(item.light);
+        else
+            over.push_back(item.light);
+    }
+
+    // Every underfull bin is topped up by an overfull light, which becomes its alias
+    while (!under.empty() && !over.empty())
+    {
+        const uint32_t underfull = under.back();
+        const uint32_t overfull = over.back();
+        under.pop_back();
+
+        alias_table[underfull] = { scaled[underfull], overfull };
+        scaled[overfull] -= 1 - scaled[underfull];
+
+        if (scaled[overfull] < 1)
+        {
+            over.pop_back();
+            under.push_back(overfull);
+        }
+    }
+
+    // What remains is full up to rounding errors
+    for (uint32_t light : under)
+        alias_table[light] = { 1, light };
+
+    for (uint32_t light : over)
+        alias_table[light] = { 1, light };
+}
+
+size_t LightSampler::split(vector<build_item>& items, size_t start, size_t end, const light_bounds& node_bounds, int depth) const
+{
+    // Centroid bounds
+    point3 centroid_min = items[start].centroid, centroid_max = items[start].centroid;
+    for (size_t i = start + 1; i < end; i++)
+    {
+        centroid_min = min_vector(centroid_min, items[i].centroid);
+        centroid_max = max_vector(centroid_max, items[i].centroid);
+    }
+
+    const vec3 extent = centroid_max - centroid_min;
+
+    // Deep trees switch to median splits, which keeps every branch trail within 64 bits
+    if (depth >= max_depth / 2)
+    {
+        int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z ? 1 : 2);
+        size_t mid = start + (end - start) / 2;
+
+        std::nth_element(items.begin() + start, items.begin() + mid, items.begin() + end,
+            [axis](const build_item& a, const build_item& b) { return a.centroid[axis] < b.centroid[axis]; });
+
+        return mid;
+    }
+
+    // Surface area orientation heuristic evaluated on buckets of centroids along each axis
+    double best_cost = Raytracing::infinity;
+    int best_axis = -1, best_bucket = -1;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        if (extent[axis] <= 0)
+            continue;
+
+        light_bounds bucket_bounds[buckets];
+        int bucket_counts[buckets] = {};
+
+        for (size_t i = start; i < end; i++)
+        {
+            int b = std::min(buckets - 1, int(buckets * (items[i].centroid[axis] - centroid_min[axis]) / extent[axis]));
+            bucket_bounds[b] = merge(bucket_bounds[b], items[i].bounds);
+            bucket_counts[b]++;
+        }
+
+        for (int split_bucket = 0; split_bucket < buckets - 1; split_bucket++)
+        {
+            light_bounds below, above;
+            int count_below = 0, count_above = 0;
+
+            for (int b = 0; b <= split_bucket; b++)
+            {
+                below = merge(below, bucket_bounds[b]);
+                count_below += bucket_counts[b];
+            }
+
+            for (int b = split_bucket + 1; b < buckets; b++)
+            {
+                above = merge(above, bucket_bounds[b]);
+                count_above += bucket_counts[b];
+            }
+
+            if (count_below == 0 || count_above == 0)
+                continue;
+
+            double split_cost = cost(below, node_bounds, axis) + cost(above, node_bounds, axis);
+
+            if (split_cost < best_cost)
+            {
+                best_cost = split_cost;
+                best_axis = axis;
+                best_bucket = split_bucket;
+            }
+        }
+    }
+
+    // Every centroid in the same place, any split is as good as another
+    if (best_axis < 0)
+        return start + (end - start) / 2;
+
+    auto middle = std::partition(items.begin() + start, items.begin() + end, [&](const build_item& item)
+    {
+        int b = std::min(buckets - 1, int(buckets * (item.centroid[best_axis] - centroid_min[best_axis]) / extent[best_axis]));
+        return b <= best_bucket;
+    });
+
+    return size_t(middle - items.begin());
+}
+
+LightSampler::light_bounds LightSampler::merge(const light_bounds& a, const light_bounds& b)
+{
+    // Bounds without power are empty
+    if (a.power == 0)
+        return b;
+
+    if (b.power == 0)
+        return a;
+
+    return { min_vector(a.min, b.min), max_vector(a.max, b.max), a.power + b.power, merge(a.normals, b.normals) };
+}
+
+normal_bounds LightSampler::merge(const normal_bounds& a, const normal_bounds& b)
+{
+    const double theta_a = std::acos(std::clamp(a.cos_theta, -1.0, 1.0));
+    const double theta_b = std::acos(std::clamp(b.cos_theta, -1.0, 1.0));
+    const double theta_d = std::acos(std::clamp(dot(a.axis, b.axis), -1.0, 1.0));
+
+    // One cone already contains the other
+    if (std::min(theta_d + theta_b, pi) <= theta_a)
+        return a;
+
+    if (std::min(theta_d + theta_a, pi) <= theta_b)
+        return b;
+
+    // Cone spanning both, its axis is rotated from a towards b
+    const double theta_o = (theta_a + theta_d + theta_b) / 2;
+
+    if (theta_o >= pi)
+        return normal_bounds();
+
+    const vec3 rotation_axis = cross(a.axis, b.axis);
+
+    if (rotation_axis.length_squared() == 0)
+        return normal_bounds();
+
+    const vec3 k = unit_vector(rotation_axis);
+    const double theta_r = theta_o - theta_a;
+    const vec3 axis = a.axis * std::cos(theta_r) + cross(k, a.axis) * std::sin(theta_r) + k * dot(k, a.axis) * (1 - std::cos(theta_r));
+
+    return { unit_vector(axis), std::cos(theta_o) };
+}
+
+double LightSampler::cost(const light_bounds& b, const light_bounds& node_bounds, int axis)
+{
+    // Solid angle measure of the directions the lights emit to (normal cone widened by 90 degrees)
+    const double theta_o = std::acos(std::clamp(b.normals.cos_theta, -1.0, 1.0));
+    const double theta_w = std::min(theta_o + pi / 2, pi);
+    const double sin_o = std::sqrt(std::max(0.0, 1 - b.normals.cos_theta * b.normals.cos_theta));
+    const double solid_angle = 2 * pi * (1 - b.normals.cos_theta)
+                             + pi / 2 * (2 * theta_w * sin_o - std::cos(theta_o - 2 * theta_w) - 2 * theta_o * sin_o + b.normals.cos_theta);
+
+    // Thin slabs are favoured along the longest axis of the node
+    const vec3 node_diagonal = node_bounds.max - node_bounds.min;
+    const double regularization = node_diagonal.max_component() / node_diagonal[axis];
+
+    const vec3 diagonal = b.max - b.min;
+    const double surface_area = 2 * (diagonal.x * diagonal.y + diagonal.x * diagonal.z + diagonal.y * diagonal.z);
+
+    return b.power * solid_angle * regularization * surface_area;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+// Headers
+#include "core/core.hpp"
+#include "hittable.hpp"
+#include <unordered_map>
+
+// How next event estimation picks the light it samples
+enum class LIGHT_SAMPLING
+{
+    POWER,          // Proportionally to the emitted power of each light, O(1) through an alias table
+    LIGHT_BVH,      // Proportionally to the power each light can deliver to the shading point, O(log n) through a light BVH
+};
+
+// Chooses which light a shading point sends its shadow ray to during next event estimation. The same probabilities
+// are reported back when a BSDF sampled ray hits a light, so both strategies can be weighted by multiple importance
+// sampling. Lights are world space primitives that implement pdf_value and random_scattering_ray, or InstancedLights
+// that place an instanced primitive in world space. Hits on such a primitive are traced back to its light by find().
+//
+// Lights are organized in a light BVH: every node bounds the position, power and normal directions of its lights, which
+// gives a conservative estimate of how much they can illuminate a point. Sampling walks down the tree choosing each
+// child proportionally to that estimate, so a light is picked in O(log n) and far, dim or back facing lights are
+// rarely chosen. The probability of a light is recomputed by following its path from the root.
+// The power strategy ignores the shading point and picks lights by area times emitted radiance with Vose's alias
+// method: one sample value selects a bin, and the bin either keeps its light or hands over to its alias.
+class LightSampler
+{
+public:
+    LightSampler();
+
+    void build(const vector<shared_ptr<Hittable>>& lights, const Raytracing::MaterialTable& materials, LIGHT_SAMPLING strategy = LIGHT_SAMPLING::LIGHT_BVH);
+    void clear();
+
+    bool empty() const;
+    size_t size() const;
+    size_t get_node_count() const;
+    LIGHT_SAMPLING get_strategy() const;
+    bool contains(const Hittable* light) const;
+    const Hittable* find(const Hittable* primitive) const;     // Light that samples a hit primitive (itself or its InstancedLight), nullptr if none
+
+    const Hittable* sample(const point3& origin, double u, double& probability) const;    // Picks a light for the shading point with the sample value u and returns the probability of that choice
+    double probability(const point3& origin, const Hittable* light) const;     // Probability of sample() picking that light, 0 if it is not a light
+
+private:
+    // Emission bounds of a group of lights. Emitters are diffuse, light leaves within 90 degrees of every normal.
+    struct light_bounds
+    {
+        point3 min, max;
+        double power = 0;           // Emitted flux (luminance)
+        normal_bounds normals;
+
+        double importance(const point3& p) const;
+    };
+
+    // Interior nodes store their left child right after themselves and the right child at `index`
+    struct light_node
+    {
+        light_bounds bounds;
+        uint32_t index;             // Right child (interior) or light index (leaf)
+        bool leaf;
+    };
+
+    // Bin of the alias table, kept when the random fraction is below the threshold
+    struct alias_bin
+    {
+        double threshold;
+        uint32_t alias;
+    };
+
+    // Index of a light and branches from the root to its leaf, bit i set when going right at depth i
+    struct light_entry
+    {
+        uint32_t index;
+        uint64_t trail = 0;
+    };
+
+    struct build_item
+    {
+        uint32_t light;
+        light_bounds bounds;
+        point3 centroid;
+    };
+
+    static constexpr int buckets = 12;
+    static constexpr int max_depth = 64;    // Length of the branch trails
+
+    LIGHT_SAMPLING strategy = LIGHT_SAMPLING::LIGHT_BVH;
+
+    vector<light_node> nodes;
+    vector<alias_bin> alias_table;
+    vector<double> power_probabilities;
+    vector<shared_ptr<Hittable>> lights;
+    std::unordered_map<const Hittable*, light_entry> light_entries;
+    std::unordered_map<const Hittable*, const Hittable*> primitive_lights;     // Instanced primitives and their world space lights
+
+    const Hittable* sample_power(double u, double& probability) const;
+    const Hittable* sample_bvh(const point3& origin, double u, double& probability) const;
+    double bvh_probability(const point3& origin, uint64_t trail) const;
+
+    uint32_t build_node(vector<build_item>& items, size_t start, size_t end, uint64_t trail, int depth);
+    void build_alias_table(const vector<build_item>& items);
+    size_t split(vector<build_item>& items, size_t start, size_t end, const light_bounds& node_bounds, int depth) const;
+
+    static light_bounds merge(const light_bounds& a, const light_bounds& b);
+    static normal_bounds merge(const normal_bounds& a, const normal_bounds& b);
+    static double cost(const light_bounds& b, const light_bounds& node_bounds, int axis);
+};
@@ -4,6 +4,7 @@
 #include "surface.hpp"
 #include "math/interval.hpp"
 #include "utils/chrono.hpp"
+#include "core/arena.hpp"
 
 // Usings
 using Raytracing::Surface;
@@ -17,12 +18,12 @@ Raytracing::Mesh::Mesh(const string& name, const hittable_list& surfaces, const
     if (use_bvh)
     {
         auto surface_bvh = bvh_node(surfaces);
-        this->surfaces = make_shared<bvh_node>(surface_bvh);
+        this->surfaces = make_arena_shared<bvh_node>(surface_bvh);
         set_stats(surface_bvh, surfaces);
     }
     else
     {
-        this->surfaces = make_shared<hittable_list>(surfaces);
+        this->surfaces = make_arena_shared<hittable_list>(surfaces);
     }
 
     set_numbers(surfaces);
@@ -40,11 +41,21 @@ bool Raytracing::Mesh::hit(const Ray& r, const Interval& ray_t, hit_record& rec)
     const bool hit = surfaces->hit(local_ray, ray_t, rec);
 
     if(hit)
-        transform_hit_record(rec);
+        record_instance(rec);
 
     return hit;	
 }
 
+void Raytracing::Mesh::register_materials(Raytracing::MaterialTable& table)
+{
+    surfaces->register_materials(table);
+}
+
+vector<shared_ptr<Hittable>> Raytracing::Mesh::get_children() const
+{
+    return { surfaces };
+}
+
 void Raytracing::Mesh::set_bbox()
 {
     bbox = original_bbox = surfaces->get_bbox();
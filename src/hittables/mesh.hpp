@@ -16,6 +16,8 @@ namespace Raytracing
 	    Mesh(const string& name, const hittable_list& surfaces, const optional<Raytracing::Matrix44>& model = nullopt, bool use_bvh = true);
 
 	    bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+        void register_materials(Raytracing::MaterialTable& table) override;
+        vector<shared_ptr<Hittable>> get_children() const override;
         void set_bbox();
 	    const string name() const;
         void set_numbers(const hittable_list& surfaces);
@@ -16,13 +16,7 @@ Quad::Quad(point3 Q, vec3 u, vec3 v, const shared_ptr<Material>& material, const
     type = QUAD;
     this->pdf = pdf;
 
-    auto n = cross(u, v);
-    normal = unit_vector(n);
-    D = dot(normal, Q);
-    w = n / dot(n, n);
-    area = n.length();
-
-    set_bbox();
+    set_geometry();
 
     // If the Quad does not belong to a hittable structure (such as a Box), use the model (should not be null or identity) to transform ray, hit data and bbox
     if (transform)
@@ -58,19 +52,63 @@ bool Quad::hit(const Ray& r, const Interval& ray_t, hit_record& rec) const
         return false;
 
     // Hit record
-    rec.t = t;
-    rec.p = P;
-    rec.material = material;
-    rec.texture_coordinates = make_pair(alpha, beta);
-    rec.determine_normal_direction(local_ray.direction(), normal);
-    rec.type = type;
+    rec.set_primitive(this, t, alpha, beta);
 
     if (transformed)
-        transform_hit_record(rec);
+        record_instance(rec);
 
     return true;
 }
 
+void Quad::register_materials(Raytracing::MaterialTable& table)
+{
+    if (!material)
+        return;
+
+    material_id = table.add(material);
+    material.reset();
+}
+
+optional<Raytracing::material_index> Quad::get_material_index() const
+{
+    return material_id;
+}
+
+void Quad::surface_attributes(const Ray& local_ray, hit_record& rec) const
+{
+    rec.normal = normal;
+    rec.material_id = material_id;
+    rec.texture_coordinates = make_pair(rec.u, rec.v);
+    rec.texture_scale = 1.0 / std::sqrt(area);
+    rec.type = type;
+}
+
+bool Quad::can_bake_transform(const Matrix44& model) const
+{
+    return model.is_affine();
+}
+
+void Quad::bake_transform(const Matrix44& model)
+{
+    Q = model.transform_point(Q);
+    u = model.transform_vector(u);
+    v = model.transform_vector(v);
+
+    clear_model();
+    set_geometry();
+}
+
+void Quad::set_geometry()
+{
+    auto n = cross(u, v);
+    normal = unit_vector(n);
+    D = dot(normal, Q);
+    w = n / dot(n, n);
+    area = n.length();
+
+    set_bbox();
+}
+
 void Quad::set_bbox()
 {
     bbox = original_bbox = AABB(Q, Q + u, Q + v, Q + u + v);
@@ -84,18 +122,33 @@ double Quad::pdf_value(const point3& hit_point, const vec3& scattering_direction
     if (!this->hit(ray, Interval(0.001, infinity), rec))
         return 0;
 
+    Hittable::compute_surface_attributes(ray, rec);
+
     auto distance_squared = rec.t * rec.t * scattering_direction.length_squared(); // light_hit_point - origin = t * direction
     auto cosine = fabs(dot(scattering_direction, rec.normal) / scattering_direction.length()); // scattering direction is not normalized
 
     return distance_squared / (cosine * area);
 }
 
-vec3 Quad::random_scattering_ray(const point3& hit_point) const
+vec3 Quad::random_scattering_ray(const point3& hit_point, const pair<double, double>& sample) const
 {
-    auto p = Q + (random_number<double>() * u) + (random_number<double>() * v);
+    auto p = Q + (sample.first * u) + (sample.second * v);
     return p - hit_point;
 }
 
+double Quad::get_area() const
+{
+    if (!transformed)
+        return area;
+
+    return cross(instance.transform_vector(u), instance.transform_vector(v)).length();
+}
+
+normal_bounds Quad::get_normal_bounds() const
+{
+    return { transformed ? unit_vector(instance.transform_normal(normal)) : normal, 1 };
+}
+
 shared_ptr<Material> Quad::get_material()
 {
     return material;
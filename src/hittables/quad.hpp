@@ -9,16 +9,28 @@ public:
     Quad(point3 Q, vec3 u, vec3 v, const shared_ptr<Raytracing::Material>& material, const optional<Raytracing::Matrix44>& model = nullopt, bool transform = false, bool pdf = false);
 
     bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+    void register_materials(Raytracing::MaterialTable& table) override;
+    optional<Raytracing::material_index> get_material_index() const override;
+    bool can_bake_transform(const Raytracing::Matrix44& model) const override;
+    void bake_transform(const Raytracing::Matrix44& model) override;
     void set_bbox();
     double pdf_value(const point3& hit_point, const vec3& scattering_direction) const override;
-    vec3 random_scattering_ray(const point3& hit_point) const override;
+    vec3 random_scattering_ray(const point3& hit_point, const pair<double, double>& sample) const override;
+    double get_area() const override;
+    normal_bounds get_normal_bounds() const override;
     shared_ptr<Raytracing::Material> get_material();
 
+protected:
+    void surface_attributes(const Ray& local_ray, hit_record& rec) const override;
+
 private:
     point3 Q;
     double D;
     vec3 u, v, w, normal;
     double area;
-    shared_ptr<Raytracing::Material> material;
+    shared_ptr<Raytracing::Material> material;     // Released once registered in the scene material table
+    Raytracing::material_index material_id = 0;
+
+    void set_geometry();
 };
 
@@ -70,23 +70,62 @@ bool Sphere::hit(const Ray& r, const Interval& ray_t, hit_record& rec) const
             return false;
     }
 
-    vec3 phit = local_ray.at(root);
-    vec3 outward_normal = (phit - current_center) / radius;
-
     // Hit record
-    rec.t = root;
-    rec.p = phit;
-    rec.material = material;
-    rec.determine_normal_direction(local_ray.direction(), outward_normal);
-    rec.texture_coordinates = get_sphere_uv(outward_normal);
-    rec.type = type;
+    rec.set_primitive(this, root);
 
     if (transformed)
-        transform_hit_record(rec);
+        record_instance(rec);
 
     return true;
 }
 
+void Sphere::register_materials(Raytracing::MaterialTable& table)
+{
+    if (!material)
+        return;
+
+    material_id = table.add(material);
+    material.reset();
+}
+
+optional<Raytracing::material_index> Sphere::get_material_index() const
+{
+    return material_id;
+}
+
+void Sphere::surface_attributes(const Ray& local_ray, hit_record& rec) const
+{
+    point3 current_center = center.at(local_ray.time());
+    vec3 outward_normal = (local_ray.at(rec.t) - current_center) / radius;
+
+    rec.normal = outward_normal;
+    rec.material_id = material_id;
+    rec.texture_coordinates = get_sphere_uv(outward_normal);
+    rec.texture_scale = 1.0 / (std::abs(radius) * std::sqrt(4.0 * pi));    // Unit texture square over the whole sphere area
+    rec.type = type;
+}
+
+bool Sphere::can_bake_transform(const Matrix44& model) const
+{
+    return uniform_scale(model).has_value();
+}
+
+void Sphere::bake_transform(const Matrix44& model)
+{
+    const point3 start_center = model.transform_point(center.at(0));
+    const point3 end_center = model.transform_point(center.at(1));
+
+    center = motion_vector(start_center, end_center - start_center);
+    radius *= uniform_scale(model).value();
+
+    clear_model();
+
+    if (center.direction() == vec3(0))
+        set_static_bbox();
+    else
+        set_moving_bbox();
+}
+
 void Sphere::set_static_bbox()
 {
     auto c0 = center.at(0);
@@ -119,12 +158,20 @@ double Sphere::pdf_value(const point3& origin, const vec3& direction) const
     return  1 / solid_angle;
 }
 
-vec3 Sphere::random_scattering_ray(const point3& origin) const
+vec3 Sphere::random_scattering_ray(const point3& origin, const pair<double, double>& u) const
 {
     vec3 direction = center.at(0) - origin;
     auto distance_squared = direction.length_squared();
-    ONB uvw(direction);
-    return uvw.transform(sphere_front_face_random(radius, distance_squared));
+    ONB uvw(unit_vector(direction));   // The basis expects a unit axis
+    return uvw.transform(sphere_front_face_random(radius, distance_squared, u));
+}
+
+double Sphere::get_area() const
+{
+    // Flattened spheres only carry translations and uniform scales, instanced ones are treated the same way
+    const double world_radius = transformed ? instance.transform_vector(vec3(radius, 0, 0)).length() : radius;
+
+    return 4 * pi * world_radius * world_radius;
 }
 
 pair<double, double> Sphere::get_sphere_uv(const point3& p)
@@ -139,10 +186,34 @@ pair<double, double> Sphere::get_sphere_uv(const point3& p)
     return make_pair(phi / (2 * pi), theta / pi);
 }
 
-vec3 Sphere::sphere_front_face_random(double radius, double distance_squared)
+optional<double> Sphere::uniform_scale(const Matrix44& model)
+{
+    // Only translations and uniform scaling are baked. A rotation would keep the sphere a sphere but turn its
+    // texture mapping, which is evaluated in object space.
+    if (!model.is_affine())
+        return nullopt;
+
+    const double scale = model[0][0];
+
+    if (scale <= 0 || model[1][1] != scale || model[2][2] != scale)
+        return nullopt;
+
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            if (i != j && model[i][j] != 0)
+                return nullopt;
+        }
+    }
+
+    return scale;
+}
+
+vec3 Sphere::sphere_front_face_random(double radius, double distance_squared, const pair<double, double>& u)
 {
-    auto r1 = random_number<double>();
-    auto r2 = random_number<double>();
+    auto r1 = u.first;
+    auto r2 = u.second;
     auto phi = 2 * pi * r1;
 
     auto z = 1 + r2 * (std::sqrt(1 - radius * radius / distance_squared) - 1);
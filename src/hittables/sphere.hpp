@@ -12,18 +12,29 @@ public:
     Sphere(point3 start_center, point3 end_center, const double radius, const shared_ptr<Raytracing::Material>& material, const optional<Raytracing::Matrix44>& model = nullopt, bool transform = false); // Moving sphere
 
     bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+    void register_materials(Raytracing::MaterialTable& table) override;
+    optional<Raytracing::material_index> get_material_index() const override;
+    bool can_bake_transform(const Raytracing::Matrix44& model) const override;
+    void bake_transform(const Raytracing::Matrix44& model) override;
     void set_static_bbox();
     void set_moving_bbox();
     double pdf_value(const point3& origin, const vec3& direction) const override;
-    vec3 random_scattering_ray(const point3& origin) const override;
+    vec3 random_scattering_ray(const point3& origin, const pair<double, double>& u) const override;
+    double get_area() const override;
+
+    static pair<double, double> get_sphere_uv(const point3& p);
+
+protected:
+    void surface_attributes(const Ray& local_ray, hit_record& rec) const override;
 
 private:
     motion_vector center;
     double radius;
-    shared_ptr<Raytracing::Material> material;
+    shared_ptr<Raytracing::Material> material;     // Released once registered in the scene material table
+    Raytracing::material_index material_id = 0;
 
-    static pair<double, double> get_sphere_uv(const point3& p);
-    static vec3 sphere_front_face_random(double radius, double distance_squared);
+    static optional<double> uniform_scale(const Raytracing::Matrix44& model);
+    static vec3 sphere_front_face_random(double radius, double distance_squared, const pair<double, double>& u);
 };
 
 
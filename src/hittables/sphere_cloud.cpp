@@ -0,0 +1,566 @@
+// Headers
+#include "core/core.hpp"
+#include "core/simd.hpp"
+#include "sphere_cloud.hpp"
+#include "sphere.hpp"
+#include "utils/utilities.hpp"
+#include "ray.hpp"
+#include <bit>
+
+// Usings
+using Raytracing::AABB;
+using Raytracing::Material;
+using Raytracing::MaterialTable;
+using Raytracing::Matrix44;
+
+SphereCloud::SphereCloud()
+{
+    type = SPHERE_CLOUD;
+    bbox = original_bbox = AABB::empty();
+}
+
+void SphereCloud::add(const point3& center, double radius, const shared_ptr<Material>& material)
+{
+    add(center, center, radius, material);
+}
+
+void SphereCloud::add(const point3& start_center, const point3& end_center, double radius, const shared_ptr<Material>& material)
+{
+    if (!nodes.empty())
+    {
+        string error = Logger::error("SPHERE_CLOUD", "Spheres cannot be added once the cloud is built");
+        throw std::logic_error(error);
+    }
+
+    vec3 motion = end_center - start_center;
+
+    staged_sphere sphere;
+    sphere.center[0] = float(start_center.x);
+    sphere.center[1] = float(start_center.y);
+    sphere.center[2] = float(start_center.z);
+    sphere.motion[0] = float(motion.x);
+    sphere.motion[1] = float(motion.y);
+    sphere.motion[2] = float(motion.z);
+    sphere.radius = float(std::fmax(0, radius));
+    sphere.material = palette_index(material);
+
+    moving = moving || motion != vec3(0);
+
+    staged.push_back(sphere);
+}
+
+void SphereCloud::build(const optional<Matrix44>& model)
+{
+    stats = bvh_stats();
+    stats.bvh_chrono.start();
+
+    num_spheres = staged.size();
+
+    if (num_spheres > 0)
+    {
+        // Sphere order after partitioning, every leaf maps to a contiguous run of `lanes` entries
+        vector<uint32_t> order(num_spheres);
+        std::iota(order.begin(), order.end(), 0);
+
+        nodes.reserve(2 * (num_spheres / lanes + 1));
+        build_node(order, 0, num_spheres, 1);
+        write_packets(order);
+
+        const flat_node& root = nodes.front();
+        bbox = original_bbox = AABB(point3(root.min[0], root.min[1], root.min[2]), point3(root.max[0], root.max[1], root.max[2]));
+    }
+
+    // Staging data is no longer needed
+    vector<staged_sphere>().swap(staged);
+
+    stats.bvh_chrono.end();
+    stats.bvh_nodes = int(nodes.size());
+    stats.spheres = int(num_spheres);
+    stats.primitives = int(num_spheres);
+
+    set_model(model);
+}
+
+bool SphereCloud::hit(const Ray& r, const Interval& ray_t, hit_record& rec) const
+{
+    if (nodes.empty())
+        return false;
+
+    const Ray local_ray = transformed ? transform_ray(r) : r;
+
+    // Traversal runs in single precision, the closest root is refined in surface_attributes
+    const vec3& o = local_ray.origin();
+    const vec3& d = local_ray.direction();
+    const float origin[3] = { float(o.x), float(o.y), float(o.z) };
+    const float direction[3] = { float(d.x), float(d.y), float(d.z) };
+    const float inv_direction[3] = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+    const float inv_length_squared = 1.0f / (direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+    const float time = float(local_ray.time());
+    const float t_min = float(ray_t.min);
+
+    float closest = float(ray_t.max);
+    uint32_t closest_sphere = 0;
+    bool hit_anything = false;
+
+    // Depth-first traversal with an explicit stack, the tree is balanced so 64 entries cover any cloud size
+    uint32_t stack[64];
+    int stack_size = 0;
+    uint32_t node_index = 0;
+
+    while (true)
+    {
+        const flat_node& node = nodes[node_index];
+
+        if (node_hit(node, origin, inv_direction, t_min, closest))
+        {
+            if (node.count > 0)
+            {
+                const int lane = packet_hit(node.offset, origin, direction, inv_length_squared, time, t_min, closest);
+
+                if (lane >= 0)
+                {
+                    closest_sphere = node.offset * lanes + uint32_t(lane);
+                    hit_anything = true;
+                }
+            }
+            else
+            {
+                // Visit the child on the near side of the split first so the far one is culled more often
+                uint32_t near_child = node_index + 1;
+                uint32_t far_child = node.offset;
+
+                if (direction[node.axis] < 0)
+                    std::swap(near_child, far_child);
+
+                stack[stack_size++] = far_child;
+                node_index = near_child;
+                continue;
+            }
+        }
+
+        if (stack_size == 0)
+            break;
+
+        node_index = stack[--stack_size];
+    }
+
+    if (!hit_anything)
+        return false;
+
+    // Hit record
+    rec.set_primitive(this, closest);
+    rec.primitive_index = closest_sphere;
+
+    if (transformed)
+        record_instance(rec);
+
+    return true;
+}
+
+void SphereCloud::register_materials(MaterialTable& table)
+{
+    if (palette.empty())
+        return;
+
+    // Palette indices => scene table indices
+    vector<Raytracing::material_index> table_indices(palette.size());
+    for (size_t i = 0; i < palette.size(); i++)
+        table_indices[i] = table.add(palette[i]);
+
+    for (auto& material_id : material_ids)
+        material_id = table_indices[material_id];
+
+    palette.clear();
+    palette_indices.clear();
+}
+
+size_t SphereCloud::size() const
+{
+    return num_spheres;
+}
+
+bool SphereCloud::is_moving() const
+{
+    return moving;
+}
+
+const bvh_stats SphereCloud::get_stats() const
+{
+    return stats;
+}
+
+void SphereCloud::surface_attributes(const Ray& local_ray, hit_record& rec) const
+{
+    const uint32_t packet_index = rec.primitive_index / lanes;
+    const uint32_t lane = rec.primitive_index % lanes;
+    const sphere_packet& packet = packets[packet_index];
+
+    point3 center = point3(packet.center_x[lane], packet.center_y[lane], packet.center_z[lane]);
+    const double radius = packet.radius[lane];
+
+    if (moving)
+    {
+        const motion_packet& motion = motions[packet_index];
+        center += local_ray.time() * vec3(motion.x[lane], motion.y[lane], motion.z[lane]);
+    }
+
+    // Refine the single precision root in double so scattered rays start on the surface
+    const vec3& direction = local_ray.direction();
+    const vec3 oc = center - local_ray.origin();
+    const double projection = dot(direction, oc) / direction.length_squared();
+    const vec3 l = oc - projection * direction;
+    const double half_chord_squared = (radius * radius - l.length_squared()) / direction.length_squared();
+
+    if (half_chord_squared >= 0)
+    {
+        const double half_chord = std::sqrt(half_chord_squared);
+        const double t_near = projection - half_chord;
+        const double t_far = projection + half_chord;
+        rec.t = std::fabs(t_near - rec.t) <= std::fabs(t_far - rec.t) ? t_near : t_far;
+    }
+
+    vec3 outward_normal = unit_vector(local_ray.at(rec.t) - center);
+
+    rec.normal = outward_normal;
+    rec.material_id = material_ids[rec.primitive_index];
+    rec.texture_coordinates = Sphere::get_sphere_uv(outward_normal);
+    rec.texture_scale = 1.0 / (std::abs(radius) * std::sqrt(4.0 * Raytracing::pi));
+    rec.type = SPHERE;
+}
+
+uint32_t SphereCloud::palette_index(const shared_ptr<Material>& material)
+{
+    auto it = palette_indices.find(material.get());
+    if (it != palette_indices.end())
+        return it->second;
+
+    uint32_t index = uint32_t(palette.size());
+    palette.push_back(material);
+    palette_indices.emplace(material.get(), index);
+
+    return index;
+}
+
+uint32_t SphereCloud::build_node(vector<uint32_t>& order, size_t start, size_t end, int depth)
+{
+    const uint32_t node_index = uint32_t(nodes.size());
+    nodes.emplace_back();
+
+    // Bounds of the spheres over the whole shutter interval and bounds of their centroids
+    const float inf = std::numeric_limits<float>::infinity();
+    float bounds_min[3] = { inf, inf, inf };
+    float bounds_max[3] = { -inf, -inf, -inf };
+    float centroid_min[3] = { inf, inf, inf };
+    float centroid_max[3] = { -inf, -inf, -inf };
+
+    for (size_t i = start; i < end; i++)
+    {
+        const staged_sphere& sphere = staged[order[i]];
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            const float c0 = sphere.center[axis];
+            const float c1 = sphere.center[axis] + sphere.motion[axis];
+            const float centroid = c0 + 0.5f * sphere.motion[axis];
+
+            bounds_min[axis] = std::min(bounds_min[axis], std::min(c0, c1) - sphere.radius);
+            bounds_max[axis] = std::max(bounds_max[axis], std::max(c0, c1) + sphere.radius);
+            centroid_min[axis] = std::min(centroid_min[axis], centroid);
+            centroid_max[axis] = std::max(centroid_max[axis], centroid);
+        }
+    }
+
+    flat_node node = {};
+    std::copy(bounds_min, bounds_min + 3, node.min);
+    std::copy(bounds_max, bounds_max + 3, node.max);
+
+    stats.bvh_depth = std::max(stats.bvh_depth, depth);
+
+    const size_t span = end - start;
+
+    // Leaf, its spheres start on a packet boundary because every split below is a multiple of `lanes`
+    if (span <= lanes)
+    {
+        node.offset = uint32_t(start / lanes);
+        node.count = uint16_t(span);
+        nodes[node_index] = node;
+        return node_index;
+    }
+
+    // Median split on the longest centroid axis, rounded up to a whole number of packets
+    int axis = 0;
+    for (int i = 1; i < 3; i++)
+    {
+        if (centroid_max[i] - centroid_min[i] > centroid_max[axis] - centroid_min[axis])
+            axis = i;
+    }
+
+    const size_t mid = start + ((span / 2 + lanes - 1) / lanes) * lanes;
+
+    std::nth_element(order.begin() + start, order.begin() + mid, order.begin() + end, [&](uint32_t a, uint32_t b)
+    {
+        const staged_sphere& sa = staged[a];
+        const staged_sphere& sb = staged[b];
+        return 2.0f * sa.center[axis] + sa.motion[axis] < 2.0f * sb.center[axis] + sb.motion[axis];
+    });
+
+    // Left child is stored right after its parent
+    build_node(order, start, mid, depth + 1);
+    node.offset = build_node(order, mid, end, depth + 1);
+    node.axis = uint16_t(axis);
+
+    nodes[node_index] = node;
+    return node_index;
+}
+
+void SphereCloud::write_packets(const vector<uint32_t>& order)
+{
+    const size_t num_packets = (num_spheres + lanes - 1) / lanes;
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+
+    packets.resize(num_packets);
+    material_ids.assign(num_packets * lanes, 0);
+
+    if (moving)
+        motions.resize(num_packets);
+
+    for (size_t packet_index = 0; packet_index < num_packets; packet_index++)
+    {
+        sphere_packet& packet = packets[packet_index];
+
+        for (uint32_t lane = 0; lane < lanes; lane++)
+        {
+            const size_t slot = packet_index * lanes + lane;
+
+            // Padding lanes
+            if (slot >= num_spheres)
+            {
+                packet.center_x[lane] = packet.center_y[lane] = packet.center_z[lane] = nan;
+                packet.radius[lane] = 0;
+
+                if (moving)
+                    motions[packet_index].x[lane] = motions[packet_index].y[lane] = motions[packet_index].z[lane] = 0;
+
+                continue;
+            }
+
+            const staged_sphere& sphere = staged[order[slot]];
+
+            packet.center_x[lane] = sphere.center[0];
+            packet.center_y[lane] = sphere.center[1];
+            packet.center_z[lane] = sphere.center[2];
+            packet.radius[lane] = sphere.radius;
+            material_ids[slot] = sphere.material;
+
+            if (moving)
+            {
+                motions[packet_index].x[lane] = sphere.motion[0];
+                motions[packet_index].y[lane] = sphere.motion[1];
+                motions[packet_index].z[lane] = sphere.motion[2];
+            }
+        }
+    }
+}
+
+bool SphereCloud::node_hit(const flat_node& node, const float origin[3], const float inv_direction[3], float t_min, float t_max) const
+{
+    // Slab test. The argument order of min/max discards the NaN produced by 0 * inf on a slab plane.
+    for (int axis = 0; axis < 3; axis++)
+    {
+        const float t0 = (node.min[axis] - origin[axis]) * inv_direction[axis];
+        const float t1 = (node.max[axis] - origin[axis]) * inv_direction[axis];
+
+        t_min = std::max(t_min, std::min(t0, t1));
+        t_max = std::min(t_max, std::max(t0, t1));
+    }
+
+    return t_min <= t_max;
+}
+
+int SphereCloud::packet_hit(uint32_t packet_index, const float origin[3], const float direction[3], float inv_length_squared, float time, float t_min, float& closest) const
+{
+    // Per lane, with oc the vector from the ray origin to the center:
+    //  projection = dot(d, oc) / |d|^2 is the ray parameter of the point closest to the center
+    //  l = oc - projection * d is its offset from the center
+    //  t = projection -/+ sqrt((r^2 - |l|^2) / |d|^2)
+    // This avoids the cancellation of h^2 - a*c for small spheres far from the origin. Misses and padding lanes
+    // produce NaN, which fails every comparison, so the kernel has no branches.
+
+    const sphere_packet& packet = packets[packet_index];
+    const motion_packet* motion = moving ? &motions[packet_index] : nullptr;
+    int closest_lane = -1;
+
+#if RAYTRACING_SIMD_AVX
+
+    __m256 cx = _mm256_load_ps(packet.center_x);
+    __m256 cy = _mm256_load_ps(packet.center_y);
+    __m256 cz = _mm256_load_ps(packet.center_z);
+
+    if (motion)
+    {
+        const __m256 tm = _mm256_set1_ps(time);
+        cx = raytracing_fmadd_ps(tm, _mm256_load_ps(motion->x), cx);
+        cy = raytracing_fmadd_ps(tm, _mm256_load_ps(motion->y), cy);
+        cz = raytracing_fmadd_ps(tm, _mm256_load_ps(motion->z), cz);
+    }
+
+    const __m256 dx = _mm256_set1_ps(direction[0]);
+    const __m256 dy = _mm256_set1_ps(direction[1]);
+    const __m256 dz = _mm256_set1_ps(direction[2]);
+
+    const __m256 ocx = _mm256_sub_ps(cx, _mm256_set1_ps(origin[0]));
+    const __m256 ocy = _mm256_sub_ps(cy, _mm256_set1_ps(origin[1]));
+    const __m256 ocz = _mm256_sub_ps(cz, _mm256_set1_ps(origin[2]));
+
+    __m256 h = _mm256_mul_ps(dx, ocx);
+    h = raytracing_fmadd_ps(dy, ocy, h);
+    h = raytracing_fmadd_ps(dz, ocz, h);
+
+    const __m256 inv_a = _mm256_set1_ps(inv_length_squared);
+    const __m256 projection = _mm256_mul_ps(h, inv_a);
+
+    const __m256 lx = _mm256_sub_ps(ocx, _mm256_mul_ps(projection, dx));
+    const __m256 ly = _mm256_sub_ps(ocy, _mm256_mul_ps(projection, dy));
+    const __m256 lz = _mm256_sub_ps(ocz, _mm256_mul_ps(projection, dz));
+
+    __m256 l2 = _mm256_mul_ps(lx, lx);
+    l2 = raytracing_fmadd_ps(ly, ly, l2);
+    l2 = raytracing_fmadd_ps(lz, lz, l2);
+
+    const __m256 radius = _mm256_load_ps(packet.radius);
+    const __m256 half_chord = _mm256_sqrt_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(radius, radius), l2), inv_a));
+
+    const __m256 t_near = _mm256_sub_ps(projection, half_chord);
+    const __m256 t_far = _mm256_add_ps(projection, half_chord);
+
+    // Near root when it lies in the interval, far root otherwise (origin inside the sphere)
+    const __m256 lo = _mm256_set1_ps(t_min);
+    const __m256 hi = _mm256_set1_ps(closest);
+    const __m256 near_valid = _mm256_and_ps(_mm256_cmp_ps(t_near, lo, _CMP_GT_OQ), _mm256_cmp_ps(t_near, hi, _CMP_LT_OQ));
+    const __m256 t = _mm256_blendv_ps(t_far, t_near, near_valid);
+    const __m256 valid = _mm256_and_ps(_mm256_cmp_ps(t, lo, _CMP_GT_OQ), _mm256_cmp_ps(t, hi, _CMP_LT_OQ));
+
+    unsigned mask = unsigned(_mm256_movemask_ps(valid));
+    if (mask == 0)
+        return -1;
+
+    alignas(32) float roots[lanes];
+    _mm256_store_ps(roots, t);
+
+    for (; mask != 0; mask &= mask - 1)
+    {
+        const int lane = std::countr_zero(mask);
+        if (roots[lane] < closest)
+        {
+            closest = roots[lane];
+            closest_lane = lane;
+        }
+    }
+
+#elif RAYTRACING_SIMD_SSE
+
+    const __m128 dx = _mm_set1_ps(direction[0]);
+    const __m128 dy = _mm_set1_ps(direction[1]);
+    const __m128 dz = _mm_set1_ps(direction[2]);
+    const __m128 inv_a = _mm_set1_ps(inv_length_squared);
+    const __m128 lo = _mm_set1_ps(t_min);
+
+    // Two 4-wide halves, the second one culls against the closest root of the first
+    for (uint32_t half = 0; half < lanes; half += 4)
+    {
+        __m128 cx = _mm_load_ps(packet.center_x + half);
+        __m128 cy = _mm_load_ps(packet.center_y + half);
+        __m128 cz = _mm_load_ps(packet.center_z + half);
+
+        if (motion)
+        {
+            const __m128 tm = _mm_set1_ps(time);
+            cx = _mm_add_ps(cx, _mm_mul_ps(tm, _mm_load_ps(motion->x + half)));
+            cy = _mm_add_ps(cy, _mm_mul_ps(tm, _mm_load_ps(motion->y + half)));
+            cz = _mm_add_ps(cz, _mm_mul_ps(tm, _mm_load_ps(motion->z + half)));
+        }
+
+        const __m128 ocx = _mm_sub_ps(cx, _mm_set1_ps(origin[0]));
+        const __m128 ocy = _mm_sub_ps(cy, _mm_set1_ps(origin[1]));
+        const __m128 ocz = _mm_sub_ps(cz, _mm_set1_ps(origin[2]));
+
+        const __m128 h = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, ocx), _mm_mul_ps(dy, ocy)), _mm_mul_ps(dz, ocz));
+        const __m128 projection = _mm_mul_ps(h, inv_a);
+
+        const __m128 lx = _mm_sub_ps(ocx, _mm_mul_ps(projection, dx));
+        const __m128 ly = _mm_sub_ps(ocy, _mm_mul_ps(projection, dy));
+        const __m128 lz = _mm_sub_ps(ocz, _mm_mul_ps(projection, dz));
+        const __m128 l2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, lx), _mm_mul_ps(ly, ly)), _mm_mul_ps(lz, lz));
+
+        const __m128 radius = _mm_load_ps(packet.radius + half);
+        const __m128 half_chord = _mm_sqrt_ps(_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(radius, radius), l2), inv_a));
+
+        const __m128 t_near = _mm_sub_ps(projection, half_chord);
+        const __m128 t_far = _mm_add_ps(projection, half_chord);
+
+        const __m128 hi = _mm_set1_ps(closest);
+        const __m128 near_valid = _mm_and_ps(_mm_cmpgt_ps(t_near, lo), _mm_cmplt_ps(t_near, hi));
+        const __m128 t = _mm_or_ps(_mm_and_ps(near_valid, t_near), _mm_andnot_ps(near_valid, t_far));
+        const __m128 valid = _mm_and_ps(_mm_cmpgt_ps(t, lo), _mm_cmplt_ps(t, hi));
+
+        unsigned mask = unsigned(_mm_movemask_ps(valid));
+        if (mask == 0)
+            continue;
+
+        alignas(16) float roots[4];
+        _mm_store_ps(roots, t);
+
+        for (; mask != 0; mask &= mask - 1)
+        {
+            const int lane = std::countr_zero(mask);
+            if (roots[lane] < closest)
+            {
+                closest = roots[lane];
+                closest_lane = int(half) + lane;
+            }
+        }
+    }
+
+#else
+
+    for (uint32_t lane = 0; lane < lanes; lane++)
+    {
+        float cx = packet.center_x[lane];
+        float cy = packet.center_y[lane];
+        float cz = packet.center_z[lane];
+
+        if (motion)
+        {
+            cx += time * motion->x[lane];
+            cy += time * motion->y[lane];
+            cz += time * motion->z[lane];
+        }
+
+        const float ocx = cx - origin[0];
+        const float ocy = cy - origin[1];
+        const float ocz = cz - origin[2];
+
+        const float projection = (direction[0] * ocx + direction[1] * ocy + direction[2] * ocz) * inv_length_squared;
+
+        const float lx = ocx - projection * direction[0];
+        const float ly = ocy - projection * direction[1];
+        const float lz = ocz - projection * direction[2];
+
+        const float radius = packet.radius[lane];
+        const float half_chord = std::sqrt((radius * radius - (lx * lx + ly * ly + lz * lz)) * inv_length_squared);
+
+        const float t_near = projection - half_chord;
+        const float t_far = projection + half_chord;
+        const float t = (t_near > t_min && t_near < closest) ? t_near : t_far;
+
+        if (t > t_min && t < closest)
+        {
+            closest = t;
+            closest_lane = int(lane);
+        }
+    }
+
+#endif
+
+    return closest_lane;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+// Headers
+#include "core/core.hpp"
+#include "hittable.hpp"
+#include "utils/scene_stats.hpp"
+#include <unordered_map>
+
+// Large collections of small spheres stored as packed single precision arrays with their own flat BVH.
+// Each BVH leaf owns one packet of up to `lanes` spheres, which is intersected at once by a SIMD kernel (AVX 8-wide,
+// SSE 4-wide or scalar). A sphere costs about 30 bytes including its share of the tree, so millions of them fit easily.
+class SphereCloud : public Hittable
+{
+public:
+    static constexpr uint32_t lanes = 8;    // Spheres per packet and maximum spheres per leaf
+
+    SphereCloud();
+
+    // Spheres are staged with add() and packed by build(), after which the cloud is immutable
+    void add(const point3& center, double radius, const shared_ptr<Raytracing::Material>& material); // Stationary sphere
+    void add(const point3& start_center, const point3& end_center, double radius, const shared_ptr<Raytracing::Material>& material); // Moving sphere
+    void build(const optional<Raytracing::Matrix44>& model = nullopt);
+
+    bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+    void register_materials(Raytracing::MaterialTable& table) override;
+
+    size_t size() const;
+    bool is_moving() const;
+    const bvh_stats get_stats() const;
+
+protected:
+    void surface_attributes(const Ray& local_ray, hit_record& rec) const override;
+
+private:
+    // Structure of arrays for one leaf, unused lanes have NaN centers so they never report a hit
+    struct alignas(32) sphere_packet
+    {
+        float center_x[lanes];
+        float center_y[lanes];
+        float center_z[lanes];
+        float radius[lanes];
+    };
+
+    // Linear motion of a packet, center(time) = center + time * motion
+    struct alignas(32) motion_packet
+    {
+        float x[lanes];
+        float y[lanes];
+        float z[lanes];
+    };
+
+    // 32 byte node. Interior nodes store their left child right after themselves and the right child at `offset`
+    struct flat_node
+    {
+        float min[3];
+        uint32_t offset;    // Right child index (interior) or packet index (leaf)
+        float max[3];
+        uint16_t count;     // Spheres in the leaf, 0 for interior nodes
+        uint16_t axis;      // Split axis, used to visit the nearest child first
+    };
+
+    // Build input, released once the packets are written
+    struct staged_sphere
+    {
+        float center[3];
+        float motion[3];
+        float radius;
+        uint32_t material;  // Index into the palette
+    };
+
+    vector<flat_node> nodes;
+    vector<sphere_packet> packets;
+    vector<motion_packet> motions;                          // Empty when every sphere is stationary
+    vector<Raytracing::material_index> material_ids;        // One per lane, palette indices until registered
+
+    vector<staged_sphere> staged;
+    vector<shared_ptr<Raytracing::Material>> palette;       // Released once registered in the scene material table
+    std::unordered_map<const Raytracing::Material*, uint32_t> palette_indices;
+
+    size_t num_spheres = 0;
+    bool moving = false;
+    bvh_stats stats;
+
+    uint32_t palette_index(const shared_ptr<Raytracing::Material>& material);
+    uint32_t build_node(vector<uint32_t>& order, size_t start, size_t end, int depth);
+    void write_packets(const vector<uint32_t>& order);
+
+    bool node_hit(const flat_node& node, const float origin[3], const float inv_direction[3], float t_min, float t_max) const;
+    int packet_hit(uint32_t packet_index, const float origin[3], const float direction[3], float inv_length_squared, float time, float t_min, float& closest) const;
+};
@@ -3,6 +3,7 @@
 #include "surface.hpp"
 #include "hittable_list.hpp"
 #include "ray.hpp"
+#include "core/arena.hpp"
 
 // Usings
 using Raytracing::AABB;
@@ -15,12 +16,12 @@ Raytracing::Surface::Surface(const hittable_list& triangles, const shared_ptr<Ma
     if (use_bvh)
     {
         auto triangle_bvh = bvh_node(triangles);
-        this->triangles = make_shared<bvh_node>(triangles);
+        this->triangles = make_arena_shared<bvh_node>(triangles);
         set_stats(triangle_bvh);
     }
     else
     {
-        this->triangles = make_shared<hittable_list>(triangles);
+        this->triangles = make_arena_shared<hittable_list>(triangles);
     }
 
 	_num_triangles = int(triangles.size());
@@ -36,14 +37,25 @@ bool Raytracing::Surface::hit(const Ray& r, const Interval& ray_t, hit_record& r
 
     const Ray local_ray = transform_ray(r);
 
-    const bool hit = triangles->hit(r, ray_t, rec);
+    const bool hit = triangles->hit(local_ray, ray_t, rec);
 
     if (hit)
-        transform_hit_record(rec);
+        record_instance(rec);
 
     return hit;
 }
 
+void Raytracing::Surface::register_materials(Raytracing::MaterialTable& table)
+{
+    triangles->register_materials(table);
+    material.reset();
+}
+
+vector<shared_ptr<Hittable>> Raytracing::Surface::get_children() const
+{
+    return { triangles };
+}
+
 void Raytracing::Surface::set_bbox()
 {
     bbox = original_bbox = triangles->get_bbox();
@@ -18,6 +18,8 @@ namespace Raytracing
 	    Surface(const hittable_list& triangles, const shared_ptr<Material>& material, const optional<Matrix44>& model = nullopt, bool use_bvh = true);
 
 	    bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+        void register_materials(Raytracing::MaterialTable& table) override;
+        vector<shared_ptr<Hittable>> get_children() const override;
         void set_bbox();
         void set_stats(const bvh_node& triangle_bvh);
 	    const bvh_stats get_stats() const;
@@ -17,21 +17,7 @@ Triangle::Triangle(vertex A, vertex B, vertex C, const shared_ptr<Material>& mat
 {
     type = TRIANGLE;
 
-    AB = B.position - A.position;
-    AC = C.position - A.position;
-
-    auto normal = cross(AB, AC);
-    auto normal_length = normal.length();
-    area = 0.5 * normal_length; // Same reasoning as in the Quad class
-    N = normal / normal_length; // Normalized normal
-
-    if (normal.length() < kEpsilon)
-    {
-        string error = Logger::error("TRIANGLE", "Triangle vertices are colinear");
-        // throw std::runtime_error(error);
-    }
-
-    set_bbox();
+    set_geometry();
 
     // If the triangle does not belong to a hittable structure (such as a Mesh), use the model (should not be null or identity) to transform ray, hit data and bbox
     if (transform)
@@ -71,9 +57,6 @@ bool Triangle::hit(const Ray& r, const Interval& ray_t, hit_record& rec) const
     double v = dot(local_ray.direction(), Q) * invDet;
     if (v < 0 || u + v > 1) return false;
 
-    // Get barycentric cordinate w
-    double w = 1 - u - v;
-
     // Get value t of the ray
     double t = dot(AC, Q) * invDet;
 
@@ -81,20 +64,82 @@ bool Triangle::hit(const Ray& r, const Interval& ray_t, hit_record& rec) const
     if (!ray_t.surrounds(t)) return false;
 
     // Hit record
-    rec.t = t;
-    rec.p = local_ray.at(t);
-    rec.material = material;
-    rec.texture_coordinates = interpolate_texture_coordinates(u, v, w);
-    rec.type = type;
-    rec.bc = { u, v, w };
-    rec.determine_normal_direction(local_ray.direction(), interpolate_normal(u, v, w));
+    rec.set_primitive(this, t, u, v);
 
     if (transformed)
-        transform_hit_record(rec);
+        record_instance(rec);
 
     return true;
 }
 
+void Triangle::register_materials(Raytracing::MaterialTable& table)
+{
+    if (!material)
+        return;
+
+    material_id = table.add(material);
+    material.reset();
+}
+
+optional<Raytracing::material_index> Triangle::get_material_index() const
+{
+    return material_id;
+}
+
+void Triangle::surface_attributes(const Ray& local_ray, hit_record& rec) const
+{
+    // Get barycentric cordinate w
+    double u = rec.u, v = rec.v;
+    double w = 1 - u - v;
+
+    rec.normal = interpolate_normal(u, v, w);
+    rec.material_id = material_id;
+    rec.texture_coordinates = interpolate_texture_coordinates(u, v, w);
+    rec.texture_scale = texture_scale();
+    rec.vertex_color = interpolate_color(u, v, w);
+    rec.type = type;
+}
+
+bool Triangle::can_bake_transform(const Matrix44& model) const
+{
+    return model.is_affine();
+}
+
+void Triangle::bake_transform(const Matrix44& model)
+{
+    const Matrix44 normal_matrix = model.inverse().transpose();
+
+    for (vertex* v : { &A, &B, &C })
+    {
+        v->position = model.transform_point(v->position);
+
+        if (v->normal.has_value())
+            v->normal = unit_vector(normal_matrix.transform_vector(v->normal.value()));
+    }
+
+    clear_model();
+    set_geometry();
+}
+
+void Triangle::set_geometry()
+{
+    AB = B.position - A.position;
+    AC = C.position - A.position;
+
+    auto normal = cross(AB, AC);
+    auto normal_length = normal.length();
+    area = 0.5 * normal_length; // Same reasoning as in the Quad class
+    N = normal / normal_length; // Normalized normal
+
+    if (normal.length() < kEpsilon)
+    {
+        string error = Logger::error("TRIANGLE", "Triangle vertices are colinear");
+        // throw std::runtime_error(error);
+    }
+
+    set_bbox();
+}
+
 void Triangle::set_bbox()
 {
     bbox = original_bbox = AABB(A.position, B.position, C.position);
@@ -118,17 +163,21 @@ double Triangle::pdf_value(const point3& hit_point, const vec3& scattering_direc
     if (!this->hit(ray, Interval(0.001, infinity), rec))
         return 0;
 
+    // Points are drawn uniformly over the world space triangle, so its flat normal and area give the density (the
+    // interpolated shading normal would not)
+    vec3 world_normal = transformed ? instance.transform_normal(N) : N;
+
     auto distance_squared = rec.t * rec.t * scattering_direction.length_squared(); // light_hit_point - origin = t * direction
-    auto cosine = fabs(dot(scattering_direction, rec.normal) / scattering_direction.length()); // scattering direction is not normalized
+    auto cosine = fabs(dot(scattering_direction, world_normal) / (scattering_direction.length() * world_normal.length())); // neither vector is normalized
 
-    return distance_squared / (cosine * area);
+    return distance_squared / (cosine * get_area());
 }
 
-vec3 Triangle::random_scattering_ray(const point3& hit_point) const
+vec3 Triangle::random_scattering_ray(const point3& hit_point, const pair<double, double>& u) const
 {
-    // Generate random barycentric coordinates
-    auto r1 = random_number<double>();
-    auto r2 = random_number<double>();
+    // Sample point of the unit square
+    auto r1 = u.first;
+    auto r2 = u.second;
 
     // Convert to barycentric coordinates
     auto sqrt_r1 = sqrt(r1);
@@ -136,12 +185,54 @@ vec3 Triangle::random_scattering_ray(const point3& hit_point) const
     double beta = r2 * sqrt_r1;
     double gamma = 1 - alpha - beta;
 
-    // Compute the random point on the triangle
+    // Compute the random point on the triangle, in world space when it carries its own model
     auto p = alpha * A.position + beta * B.position + gamma * C.position;
 
+    if (transformed)
+        p = instance.transform_point(p);
+
     return p - hit_point;
 }
 
+double Triangle::get_area() const
+{
+    if (!transformed)
+        return area;
+
+    return 0.5 * cross(instance.transform_vector(AB), instance.transform_vector(AC)).length();
+}
+
+normal_bounds Triangle::get_normal_bounds() const
+{
+    auto world_normal = [this](const vec3& n) { return transformed ? unit_vector(instance.transform_normal(n)) : n; };
+
+    normal_bounds bounds = { world_normal(N), 1 };
+
+    // Shading normals decide which side emits, the cone has to contain all of them
+    if (has_vertex_normals())
+    {
+        for (const vertex* v : { &A, &B, &C })
+            bounds.cos_theta = std::min(bounds.cos_theta, dot(bounds.axis, world_normal(v->normal.value())));
+    }
+
+    return bounds;
+}
+
+double Triangle::texture_scale() const
+{
+    if (!A.uv.has_value() || !B.uv.has_value() || !C.uv.has_value())
+        return 0;
+
+    auto [uA, vA] = A.uv.value();
+    auto [uB, vB] = B.uv.value();
+    auto [uC, vC] = C.uv.value();
+
+    // Square root of the ratio between the areas of the triangle in texture space and on the surface
+    double texture_area = 0.5 * std::abs((uB - uA) * (vC - vA) - (uC - uA) * (vB - vA));
+
+    return area > 0 ? std::sqrt(texture_area / area) : 0;
+}
+
 pair<double, double> Triangle::interpolate_texture_coordinates(double u, double v, double w) const
 {
     // If any vertex is missing UVs, return a default (0,0) coordinate
@@ -160,6 +251,15 @@ pair<double, double> Triangle::interpolate_texture_coordinates(double u, double
     return { u_interp, v_interp };
 }
 
+optional<vec3> Triangle::interpolate_color(double u, double v, double w) const
+{
+    if (!has_vertex_colors())
+        return nullopt;
+
+    // Interpolate vertex colors using barycentric coordinates
+    return w * A.color.value() + u * B.color.value() + v * C.color.value();
+}
+
 vec3 Triangle::interpolate_normal(double u, double v, double w) const
 {
     if (has_vertex_normals())
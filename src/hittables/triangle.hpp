@@ -22,19 +22,32 @@ public:
     Triangle(vertex A, vertex B, vertex C, const shared_ptr<Raytracing::Material>& material, const optional<Raytracing::Matrix44>& model = nullopt, bool transform = false, bool culling = false);
 
     bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+    void register_materials(Raytracing::MaterialTable& table) override;
+    optional<Raytracing::material_index> get_material_index() const override;
+    bool can_bake_transform(const Raytracing::Matrix44& model) const override;
+    void bake_transform(const Raytracing::Matrix44& model) override;
     void set_bbox();
     bool has_vertex_colors() const;
     bool has_vertex_normals() const;
     double pdf_value(const point3& hit_point, const vec3& scattering_direction) const override;
-    vec3 random_scattering_ray(const point3& hit_point) const override; // https://stackoverflow.com/questions/19654251/random-point-inside-triangle-inside-java
+    vec3 random_scattering_ray(const point3& hit_point, const pair<double, double>& u) const override; // https://stackoverflow.com/questions/19654251/random-point-inside-triangle-inside-java
+    double get_area() const override;
+    normal_bounds get_normal_bounds() const override;
+
+protected:
+    void surface_attributes(const Ray& local_ray, hit_record& rec) const override;
 
 private:
     vec3 AB, AC, N;
     double area;
-    shared_ptr<Raytracing::Material> material;
+    shared_ptr<Raytracing::Material> material;     // Released once registered in the scene material table
+    Raytracing::material_index material_id = 0;
     bool culling;
 
+    void set_geometry();
     pair<double, double> interpolate_texture_coordinates(double u, double v, double w) const;
+    double texture_scale() const;   // Texture coordinate change per unit of length, 0 without UVs
     vec3 interpolate_normal(double u, double v, double w) const;
+    optional<vec3> interpolate_color(double u, double v, double w) const;
 };
 
@@ -7,6 +7,7 @@
 #include "hittables/hittable.hpp"
 #include "utils/utilities.hpp"
 #include "utils/project_parsers.hpp"
+#include "core/arena.hpp"
 
 // Usings
 using Raytracing::color;
@@ -28,6 +29,16 @@ double Raytracing::Material::scattering_pdf_value(const Ray& incoming_ray, const
     return 0;
 }
 
+shared_ptr<Raytracing::Texture> Raytracing::Material::get_texture() const
+{
+    return nullptr;
+}
+
+color Raytracing::Material::average_emission() const
+{
+    return color(0, 0, 0);
+}
+
 const MATERIAL_TYPE Raytracing::Material::get_type() const
 {
     return type;
@@ -35,7 +46,7 @@ const MATERIAL_TYPE Raytracing::Material::get_type() const
 
 // ****** Lambertian Class ****** //
 
-Raytracing::Lambertian::Lambertian(const color& albedo) : texture(make_shared<SolidColor>(albedo))
+Raytracing::Lambertian::Lambertian(const color& albedo) : texture(make_arena_shared<SolidColor>(albedo))
 { 
     type = LAMBERTIAN; 
 }
@@ -50,7 +61,7 @@ bool Raytracing::Lambertian::scatter(const Ray& incoming_ray, const hit_record&
     // auto scatter_direction = rec.normal + random_unit_vector();
     srec.is_specular = false;
     srec.specular_ray = nullopt;
-    srec.pdf = make_shared<cosine_hemisphere_pdf>(rec.normal);
+    srec.pdf = cosine_hemisphere_pdf(rec.normal);
     srec.scatter_type = REFLECT;
 
     // Texture coordinates
@@ -59,11 +70,11 @@ bool Raytracing::Lambertian::scatter(const Ray& incoming_ray, const hit_record&
     if (image_texture)
     {
         optional<pair<double, double>> parsed_texture_uvs = parse_texture_uvs(rec.texture_coordinates, image_texture->get_uv_wrap_modes());
-        srec.attenuation = texture->value(parsed_texture_uvs, rec.p);
+        srec.attenuation = texture->value(parsed_texture_uvs, rec.p, rec.texture_footprint);
     }
     else
     {
-        srec.attenuation = texture->value(rec.texture_coordinates, rec.p);
+        srec.attenuation = texture->value(rec.texture_coordinates, rec.p, rec.texture_footprint);
     }
 
     return true;
@@ -75,9 +86,14 @@ double Raytracing::Lambertian::scattering_pdf_value(const Ray& incoming_ray, con
     return std::fmax(0, cosine_theta / pi);
 }
 
+shared_ptr<Raytracing::Texture> Raytracing::Lambertian::get_texture() const
+{
+    return texture;
+}
+
 // ****** Isotropic Class ****** //
 
-Raytracing::Isotropic::Isotropic(const color& albedo) : texture(make_shared<SolidColor>(albedo))
+Raytracing::Isotropic::Isotropic(const color& albedo) : texture(make_arena_shared<SolidColor>(albedo))
 {
     type = ISOTROPIC;
 }
@@ -91,8 +107,8 @@ bool Raytracing::Isotropic::scatter(const Ray& incoming_ray, const hit_record& r
 {
     srec.is_specular = false;
     srec.specular_ray = nullopt;
-    srec.pdf = make_shared<uniform_sphere_pdf>();
-    srec.attenuation = texture->value(rec.texture_coordinates, rec.p);
+    srec.pdf = uniform_sphere_pdf();
+    srec.attenuation = texture->value(rec.texture_coordinates, rec.p, rec.texture_footprint);
     srec.scatter_type = REFLECT;
     return true;
 }
@@ -102,6 +118,11 @@ double Raytracing::Isotropic::scattering_pdf_value(const Ray& incoming_ray, cons
     return 1 / (4 * pi);
 }
 
+shared_ptr<Raytracing::Texture> Raytracing::Isotropic::get_texture() const
+{
+    return texture;
+}
+
 // ****** Metal Class ****** //
 
 Raytracing::Metal::Metal(const color& albedo, double fuzz) : albedo(albedo), fuzz(fuzz < 1 ? fuzz : 1) { type = METAL; }
@@ -118,7 +139,6 @@ bool Raytracing::Metal::scatter(const Ray& incoming_ray, const hit_record& rec,
     // Save data into scatter record
     srec.is_specular = true;
     srec.specular_ray = Ray(reflected_ray);
-    srec.pdf = nullptr;
     srec.attenuation = albedo;
     srec.scatter_type = REFLECT;
 
@@ -173,7 +193,6 @@ bool Raytracing::Dielectric::scatter(const Ray& incoming_ray, const hit_record&
     // Save data into scatter record
     srec.is_specular = true;
     srec.specular_ray = Ray(scattered_ray);
-    srec.pdf = nullptr;
     srec.attenuation = attenuation;
 
     return true;
@@ -194,15 +213,72 @@ Raytracing::DiffuseLight::DiffuseLight(shared_ptr<Raytracing::Texture>& texture)
     type = DIFFUSE_LIGHT; 
 }
 
-Raytracing::DiffuseLight::DiffuseLight(const color& emit) : texture(make_shared<SolidColor>(emit))
+Raytracing::DiffuseLight::DiffuseLight(const color& emit) : texture(make_arena_shared<SolidColor>(emit))
 { 
     type = DIFFUSE_LIGHT; 
 }
 
+Raytracing::DiffuseLight::DiffuseLight(shared_ptr<Raytracing::Texture>& texture, const color& scale) : texture(texture), scale(scale)
+{
+    type = DIFFUSE_LIGHT;
+}
+
+Raytracing::DiffuseLight::DiffuseLight(const color& emit, shared_ptr<Lambertian> base) : texture(make_arena_shared<SolidColor>(emit)), base(base)
+{
+    type = DIFFUSE_LIGHT;
+}
+
+Raytracing::DiffuseLight::DiffuseLight(shared_ptr<Raytracing::Texture>& texture, const color& scale, shared_ptr<Lambertian> base) : texture(texture), scale(scale), base(base)
+{
+    type = DIFFUSE_LIGHT;
+}
+
+bool Raytracing::DiffuseLight::scatter(const Ray& incoming_ray, const hit_record& rec, scatter_record& srec) const
+{
+    // Pure lights end the path, emitters over a surface keep bouncing off it
+    if (!base)
+        return false;
+
+    return base->scatter(incoming_ray, rec, srec);
+}
+
+double Raytracing::DiffuseLight::scattering_pdf_value(const Ray& incoming_ray, const hit_record& rec, const Ray& scattered_ray) const
+{
+    if (!base)
+        return 0;
+
+    return base->scattering_pdf_value(incoming_ray, rec, scattered_ray);
+}
+
 color Raytracing::DiffuseLight::emitted(const Ray& incoming_ray, const hit_record& rec) const
 {
     if (!rec.front_face)
         return color(0, 0, 0);
 
-    return texture->value(rec.texture_coordinates, rec.p);
+    // Texture coordinates, wrapped like the diffuse ones
+    ImageTexture* image_texture = dynamic_cast<ImageTexture*>(texture.get());
+
+    if (image_texture)
+    {
+        optional<pair<double, double>> parsed_texture_uvs = parse_texture_uvs(rec.texture_coordinates, image_texture->get_uv_wrap_modes());
+        return scale * texture->value(parsed_texture_uvs, rec.p, rec.texture_footprint);
+    }
+
+    return scale * texture->value(rec.texture_coordinates, rec.p, rec.texture_footprint);
+}
+
+shared_ptr<Raytracing::Texture> Raytracing::DiffuseLight::get_texture() const
+{
+    return texture;
+}
+
+color Raytracing::DiffuseLight::average_emission() const
+{
+    // Image emitters give their mean, procedural ones are approximated by their center value
+    ImageTexture* image_texture = dynamic_cast<ImageTexture*>(texture.get());
+
+    if (image_texture)
+        return scale * image_texture->average();
+
+    return scale * texture->value(make_pair(0.5, 0.5), point3(0, 0, 0));
 }
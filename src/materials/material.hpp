@@ -5,9 +5,7 @@
 #include "math/vec3.hpp"
 #include "hittables/hittable.hpp"
 #include "ray.hpp"
-
-// Forward declarations
-class PDF;
+#include "math/pdf.hpp"
 
 // Namespace forward declarations
 namespace Raytracing
@@ -36,7 +34,7 @@ struct scatter_record
 public:
     bool is_specular;
     optional<Ray> specular_ray;
-    shared_ptr<PDF> pdf;
+    PDF pdf;                            // Diffuse sampling distribution held by value, ignored by specular scatters
     Raytracing::color attenuation;
     SCATTER_TYPE scatter_type;
 };
@@ -51,6 +49,8 @@ namespace Raytracing
         virtual bool scatter(const Ray& incoming_ray, const hit_record& rec, scatter_record& srec) const;
         virtual color emitted(const Ray& incoming_ray, const hit_record& rec) const;
         virtual double scattering_pdf_value(const Ray& incoming_ray, const hit_record& rec, const Ray& scattered_ray) const;
+        virtual shared_ptr<Texture> get_texture() const;
+        virtual color average_emission() const;                 // Representative emitted radiance, weights how often lights using the material are sampled
         const MATERIAL_TYPE get_type() const;
 
     protected:
@@ -67,6 +67,7 @@ namespace Raytracing
 
         bool scatter(const Ray& incoming_ray, const hit_record& rec, scatter_record& srec) const override;
         double scattering_pdf_value(const Ray& incoming_ray, const hit_record& rec, const Ray& scattered_ray) const override;
+        shared_ptr<Texture> get_texture() const override;
 
     private:
         shared_ptr<Texture> texture;
@@ -80,6 +81,7 @@ namespace Raytracing
 
         bool scatter(const Ray& incoming_ray, const hit_record& rec, scatter_record& srec) const override;
         double scattering_pdf_value(const Ray& incoming_ray, const hit_record& rec, const Ray& scattered_ray) const override;
+        shared_ptr<Texture> get_texture() const override;
 
     private:
         shared_ptr<Texture> texture;
@@ -119,11 +121,20 @@ namespace Raytracing
     public:
         DiffuseLight(shared_ptr<Texture>& texture);
         DiffuseLight(const color& emit);
+        DiffuseLight(shared_ptr<Texture>& texture, const color& scale);     // Emission texture modulated by a factor (glTF emissiveTexture * emissiveFactor)
+        DiffuseLight(const color& emit, shared_ptr<Lambertian> base);                                   // Emission added on top of a diffuse surface
+        DiffuseLight(shared_ptr<Texture>& texture, const color& scale, shared_ptr<Lambertian> base);
 
+        bool scatter(const Ray& incoming_ray, const hit_record& rec, scatter_record& srec) const override;
+        double scattering_pdf_value(const Ray& incoming_ray, const hit_record& rec, const Ray& scattered_ray) const override;
         color emitted(const Ray& incoming_ray, const hit_record& rec) const override;
+        shared_ptr<Texture> get_texture() const override;
+        color average_emission() const override;
 
     private:
         shared_ptr<Texture> texture;
+        color scale = color(1, 1, 1);
+        shared_ptr<Lambertian> base;        // Reflects the light reaching the emitter, none for pure lights
     };
 }
 
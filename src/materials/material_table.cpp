@@ -0,0 +1,64 @@
+// Headers
+#include "core/core.hpp"
+#include "material_table.hpp"
+#include "material.hpp"
+#include "texture.hpp"
+
+Raytracing::material_index Raytracing::MaterialTable::add(const shared_ptr<Material>& material)
+{
+    if (!material)
+    {
+        string error = Logger::error("MATERIAL TABLE", "Trying to register a null material.");
+        throw std::invalid_argument(error);
+    }
+
+    // Materials shared between primitives are stored once
+    auto it = material_indices.find(material.get());
+    if (it != material_indices.end())
+        return it->second;
+
+    if (materials.size() >= std::numeric_limits<material_index>::max())
+    {
+        string error = Logger::error("MATERIAL TABLE", "Maximum number of materials exceeded.");
+        throw std::length_error(error);
+    }
+
+    auto index = material_index(materials.size());
+    materials.push_back(material);
+    lookup.push_back(material.get());
+    material_indices.emplace(material.get(), index);
+
+    // Register the texture the material samples from
+    if (auto texture = material->get_texture())
+        add_texture(texture);
+
+    return index;
+}
+
+void Raytracing::MaterialTable::clear()
+{
+    materials.clear();
+    textures.clear();
+    lookup.clear();
+    material_indices.clear();
+    texture_indices.clear();
+}
+
+size_t Raytracing::MaterialTable::size() const
+{
+    return materials.size();
+}
+
+size_t Raytracing::MaterialTable::num_textures() const
+{
+    return textures.size();
+}
+
+void Raytracing::MaterialTable::add_texture(const shared_ptr<Texture>& texture)
+{
+    if (texture_indices.contains(texture.get()))
+        return;
+
+    texture_indices.emplace(texture.get(), uint32_t(textures.size()));
+    textures.push_back(texture);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Headers
+#include "core/core.hpp"
+#include <unordered_map>
+
+// Namespace forward declarations
+namespace Raytracing
+{
+    class Material;
+    class Texture;
+}
+
+namespace Raytracing
+{
+    using material_index = uint32_t;
+
+    // Scene-level material and texture storage built once in Scene::build.
+    // Primitives refer to their material by index, so hit evaluation is plain array indexing without touching reference counts.
+    class MaterialTable
+    {
+    public:
+        material_index add(const shared_ptr<Material>& material);   // Returns the existing index if the material is already registered
+        void clear();
+
+        size_t size() const;
+        size_t num_textures() const;
+
+        const Material* operator[](material_index index) const { return lookup[index]; }
+
+    private:
+        vector<shared_ptr<Material>> materials;
+        vector<shared_ptr<Texture>> textures;
+        vector<const Material*> lookup;
+        std::unordered_map<const Material*, material_index> material_indices;
+        std::unordered_map<const Texture*, uint32_t> texture_indices;
+
+        void add_texture(const shared_ptr<Texture>& texture);
+    };
+}
@@ -5,6 +5,7 @@
 #include "utils/image_reader.hpp"
 #include "graphics/color.hpp"
 #include "math/interval.hpp"
+#include "core/arena.hpp"
 
 // Usings
 using Raytracing::color;
@@ -14,7 +15,7 @@ Raytracing::SolidColor::SolidColor(const color& albedo) : albedo(albedo) {}
 
 Raytracing::SolidColor::SolidColor(double red, double green, double blue) : SolidColor(color(red, green, blue)) {}
 
-color Raytracing::SolidColor::value(optional<pair<double, double>> texture_coordinates, const point3& p) const
+color Raytracing::SolidColor::value(optional<pair<double, double>> texture_coordinates, const point3& p, double footprint) const
 {
     return albedo;
 }
@@ -23,9 +24,9 @@ Raytracing::CheckerTexture::CheckerTexture(double scale, shared_ptr<Texture> eve
     : inv_scale(1.0 / scale), even(even), odd(odd) {}
 
 Raytracing::CheckerTexture::CheckerTexture(double scale, const color& c1, const color& c2)
-    : CheckerTexture(scale, make_shared<SolidColor>(c1), make_shared<SolidColor>(c2)) {}
+    : CheckerTexture(scale, make_arena_shared<SolidColor>(c1), make_arena_shared<SolidColor>(c2)) {}
 
-color Raytracing::CheckerTexture::value(optional<pair<double, double>> texture_coordinates, const point3& p) const
+color Raytracing::CheckerTexture::value(optional<pair<double, double>> texture_coordinates, const point3& p, double footprint) const
 {
     auto x = int(floor(inv_scale * p.x));
     auto y = int(floor(inv_scale * p.y));
@@ -33,35 +34,37 @@ color Raytracing::CheckerTexture::value(optional<pair<double, double>> texture_c
 
     bool isEven = (x + y + z) % 2 == 0;
 
-    return isEven ? even->value(texture_coordinates, p) : odd->value(texture_coordinates, p);
+    return isEven ? even->value(texture_coordinates, p, footprint) : odd->value(texture_coordinates, p, footprint);
 }
 
 Raytracing::NoiseTexture::NoiseTexture(double scale, int depth) : scale(scale), depth(depth)
 {
-    noise = make_shared<Perlin>();
+    noise = make_arena_shared<Perlin>();
 }
 
-color Raytracing::NoiseTexture::value(optional<pair<double, double>> texture_coordinates, const point3& p) const
+color Raytracing::NoiseTexture::value(optional<pair<double, double>> texture_coordinates, const point3& p, double footprint) const
 {
     return color(.5, .5, .5) * (1 + std::sin(scale * p.z + 10 * noise->turbulance(p, depth)));
 }
 
 Raytracing::ImageTexture::ImageTexture(const char* filename)
 {
-    image = make_shared<ImageReader>(filename);
+    set_image(make_arena_shared<ImageReader>(filename));
 }
 
 Raytracing::ImageTexture::ImageTexture(string filename)
 {
-    image = make_shared<ImageReader>(filename.c_str());
+    set_image(make_arena_shared<ImageReader>(filename.c_str()));
 }
 
 Raytracing::ImageTexture::ImageTexture(const sTextureData& data, const pair<WGPUAddressMode, WGPUAddressMode>& uv_wrap_modes) : uv_wrap_modes(uv_wrap_modes)
 {
-    image = make_shared<ImageReader>(data);
+    set_image(make_arena_shared<ImageReader>(data));
 }
 
-color Raytracing::ImageTexture::value(optional<pair<double, double>> texture_coordinates, const point3& p) const
+Raytracing::ImageTexture::ImageTexture(const pair<WGPUAddressMode, WGPUAddressMode>& uv_wrap_modes) : uv_wrap_modes(uv_wrap_modes) {}
+
+color Raytracing::ImageTexture::value(optional<pair<double, double>> texture_coordinates, const point3& p, double footprint) const
 {
     if (!texture_coordinates.has_value())
     {
@@ -73,19 +76,25 @@ color Raytracing::ImageTexture::value(optional<pair<double, double>> texture_coo
     auto [u, v] = texture_coordinates.value();
 
     // If we have no texture data, then return solid cyan as a debugging aid.
-    if (image->height() <= 0)
+    if (!image || image->height() <= 0)
         return CYAN;
 
     // Clamp input texture coordinates to [0,1] x [1,0]
     u = std::clamp(u, 0.0, 1.0);
     v = std::clamp(v, 0.0, 1.0);  // Flip V to image coordinates
 
-    // Get pixel location
-    auto i = int(u * image->width());
-    auto j = int(v * image->height());
+    // Mip level whose texels are about as wide as the footprint
+    double footprint_texels = footprint * std::sqrt(double(image->width()) * image->height());
+    int level = footprint_texels > 1 ? std::min(int(std::log2(footprint_texels) + 0.5), int(mip_levels.size())) : 0;
+
+    const ImageReader& level_image = level > 0 ? *mip_levels[level - 1] : *image;
+
+    // Get pixel location (u = 1 lands one past the last texel and is wrapped or clamped by the reader)
+    auto i = int(u * level_image.width());
+    auto j = int(v * level_image.height());
 
     // Read pixel data
-    color pixel_color = image->pixel_data(i, j);
+    color pixel_color = level_image.pixel_data(i, j);
 
     return pixel_color;
 }
@@ -95,32 +104,327 @@ pair<WGPUAddressMode, WGPUAddressMode> Raytracing::ImageTexture::get_uv_wrap_mod
     return uv_wrap_modes;
 }
 
-Raytracing::SkyboxTexture::SkyboxTexture(const char* filename)
+color Raytracing::ImageTexture::average() const
+{
+    // Same debugging aid as value() while there is no texture data
+    if (!image || image->height() <= 0)
+        return CYAN;
+
+    const ImageReader& last_level = mip_levels.empty() ? *image : *mip_levels.back();
+
+    return last_level.pixel_data(0, 0);
+}
+
+void Raytracing::ImageTexture::set_image(shared_ptr<ImageReader> level_zero)
 {
-    skybox = make_shared<ImageReader>(filename);
+    image = level_zero;
+    image->set_address_modes(uv_wrap_modes.first, uv_wrap_modes.second);
+    build_mip_levels();
 }
 
-Raytracing::SkyboxTexture::SkyboxTexture(string filename)
+void Raytracing::ImageTexture::build_mip_levels()
 {
-    skybox = make_shared<ImageReader>(filename.c_str());
+    mip_levels.clear();
+
+    // Each level halves the previous one until a single texel is left
+    const ImageReader* previous = image.get();
+
+    while (previous->width() > 1 || previous->height() > 1)
+    {
+        mip_levels.push_back(make_arena_shared<ImageReader>(previous->downsample()));
+        previous = mip_levels.back().get();
+    }
 }
 
+Raytracing::SkyboxTexture::SkyboxTexture(const char* filename)
+{
+    ImageReader image(filename);
+
+    if (build_cube_map(image))
+        build_distribution();
+}
+
+Raytracing::SkyboxTexture::SkyboxTexture(string filename) : SkyboxTexture(filename.c_str()) {}
+
 Raytracing::SkyboxTexture::SkyboxTexture(const sTextureData& data)
 {
-    skybox = make_shared<ImageReader>(data);
+    ImageReader image(data);
+
+    if (build_cube_map(image))
+        build_distribution();
 }
 
 color Raytracing::SkyboxTexture::value(const vec3& ray_direction) const
 {
-    // Get hemispherical coordinates from ray direction
-    double theta = atan2(ray_direction.x, ray_direction.z);
-    double phi = acos(std::clamp(ray_direction.y, -1.0, 1.0));
+    double s, t;
+    int face = project(ray_direction, s, t);
 
-    // Convert hemispherical coordinates to UV coordinates
-    double u = (theta + Raytracing::pi) / (2.0f * Raytracing::pi);
-    double v = phi / Raytracing::pi;
+    // Position among the texel centers of the bordered face, the clamps only guard against rounding
+    double x = std::clamp((s + 1.0) * 0.5 * face_size + 0.5, 0.5, face_size + 0.5);
+    double y = std::clamp((t + 1.0) * 0.5 * face_size + 0.5, 0.5, face_size + 0.5);
 
-    color pixel_color = skybox->pixel_data(int(u * (skybox->width() - 1)), int(v * (skybox->height() - 1)));
+    int x0 = int(x);
+    int y0 = int(y);
+    float fx = float(x - x0);
+    float fy = float(y - y0);
 
-    return pixel_color;
+    const float* top = &texels[((size_t(face) * face_stride + y0) * face_stride + x0) * channels];
+    const float* bottom = top + size_t(face_stride) * channels;
+
+    float top_left = (1.0f - fx) * (1.0f - fy);
+    float top_right = fx * (1.0f - fy);
+    float bottom_left = (1.0f - fx) * fy;
+    float bottom_right = fx * fy;
+
+    return color(
+        top_left * top[0] + top_right * top[3] + bottom_left * bottom[0] + bottom_right * bottom[3],
+        top_left * top[1] + top_right * top[4] + bottom_left * bottom[1] + bottom_right * bottom[4],
+        top_left * top[2] + top_right * top[5] + bottom_left * bottom[2] + bottom_right * bottom[5]);
+}
+
+vec3 Raytracing::SkyboxTexture::sample(const pair<double, double>& u, double& pdf) const
+{
+    pdf = 0;
+
+    if (total_weight <= 0)
+        return vec3(0, 1, 0);
+
+    // Row from the marginal CDF, then column from the conditional CDF of that row
+    double row_offset, column_offset;
+    int row = sample_cdf(marginal_cdf.data(), 6 * distribution_size, u.second, row_offset);
+    int column = sample_cdf(&conditional_cdf[size_t(row) * (distribution_size + 1)], distribution_size, u.first, column_offset);
+
+    // Uniform point inside the cell
+    int face = row / distribution_size;
+    double cell_size = 2.0 / distribution_size;
+    double s = -1.0 + (column + column_offset) * cell_size;
+    double t = -1.0 + (row % distribution_size + row_offset) * cell_size;
+
+    // Density over the face divided by the solid angle that a unit of face area subtends at (s, t)
+    double distance_squared = 1.0 + s * s + t * t;
+    double cell_probability = cell_weights[size_t(row) * distribution_size + column] / total_weight;
+    pdf = cell_probability * distance_squared * std::sqrt(distance_squared) / (cell_size * cell_size);
+
+    return unit_vector(face_direction(face, s, t));
+}
+
+double Raytracing::SkyboxTexture::pdf_value(const vec3& direction) const
+{
+    if (total_weight <= 0)
+        return 0;
+
+    double s, t;
+    int face = project(direction, s, t);
+
+    int column = std::clamp(int((s + 1.0) * 0.5 * distribution_size), 0, distribution_size - 1);
+    int row = face * distribution_size + std::clamp(int((t + 1.0) * 0.5 * distribution_size), 0, distribution_size - 1);
+
+    double cell_size = 2.0 / distribution_size;
+    double distance_squared = 1.0 + s * s + t * t;
+    double cell_probability = cell_weights[size_t(row) * distribution_size + column] / total_weight;
+
+    return cell_probability * distance_squared * std::sqrt(distance_squared) / (cell_size * cell_size);
+}
+
+bool Raytracing::SkyboxTexture::can_be_sampled() const
+{
+    return total_weight > 0;
+}
+
+bool Raytracing::SkyboxTexture::build_cube_map(const ImageReader& image)
+{
+    // A missing image leaves a magenta sky, like the missing texels of the other textures
+    if (image.width() == 0 || image.height() == 0)
+    {
+        face_size = 1;
+        face_stride = 3;
+        texels.resize(size_t(6) * face_stride * face_stride * channels);
+
+        for (size_t i = 0; i < texels.size(); i += channels)
+        {
+            texels[i] = float(MAGENTA.x);
+            texels[i + 1] = float(MAGENTA.y);
+            texels[i + 2] = float(MAGENTA.z);
+        }
+
+        return false;
+    }
+
+    // Faces keep about the texel density of the source image at the horizon
+    face_size = std::max(1, image.width() / 4);
+    face_stride = face_size + 2;
+    texels.resize(size_t(6) * face_stride * face_stride * channels);
+
+    // Border texels fall just outside the face, so their directions see the edge of the neighbouring face
+    const int rows = 6 * face_stride;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int row = 0; row < rows; row++)
+    {
+        int face = row / face_stride;
+        double t = (row % face_stride - 0.5) * 2.0 / face_size - 1.0;
+
+        for (int x = 0; x < face_stride; x++)
+        {
+            double s = (x - 0.5) * 2.0 / face_size - 1.0;
+            color texel = equirectangular_value(image, unit_vector(face_direction(face, s, t)));
+
+            float* destination = &texels[(size_t(row) * face_stride + x) * channels];
+            destination[0] = float(texel.x);
+            destination[1] = float(texel.y);
+            destination[2] = float(texel.z);
+        }
+    }
+
+    return true;
+}
+
+void Raytracing::SkyboxTexture::build_distribution()
+{
+    distribution_size = std::min(face_size, max_distribution_face_size);
+
+    const int rows = 6 * distribution_size;
+    const double cell_size = 2.0 / distribution_size;
+
+    cell_weights.assign(size_t(rows) * distribution_size, 0.0);
+    conditional_cdf.assign(size_t(rows) * (distribution_size + 1), 0.0);
+    marginal_cdf.assign(rows + 1, 0.0);
+
+    // Cells of large faces average the luminance of the texels they cover. Each one is weighted by its solid angle,
+    // cells near the corners of a face are further away and subtend less of the sphere.
+    for (int row = 0; row < rows; row++)
+    {
+        int face = row / distribution_size;
+        int face_row = row % distribution_size;
+        int y_begin = face_row * face_size / distribution_size;
+        int y_end = std::max((face_row + 1) * face_size / distribution_size, y_begin + 1);
+        double t = -1.0 + (face_row + 0.5) * cell_size;
+
+        for (int column = 0; column < distribution_size; column++)
+        {
+            int x_begin = column * face_size / distribution_size;
+            int x_end = std::max((column + 1) * face_size / distribution_size, x_begin + 1);
+            double s = -1.0 + (column + 0.5) * cell_size;
+
+            double cell_luminance = 0;
+            for (int y = y_begin; y < y_end; y++)
+            {
+                for (int x = x_begin; x < x_end; x++)
+                {
+                    const float* texel = &texels[((size_t(face) * face_stride + y + 1) * face_stride + x + 1) * channels];
+                    cell_luminance += luminance(color(texel[0], texel[1], texel[2]));
+                }
+            }
+
+            cell_luminance /= double(y_end - y_begin) * (x_end - x_begin);
+
+            double distance_squared = 1.0 + s * s + t * t;
+            double solid_angle = cell_size * cell_size / (distance_squared * std::sqrt(distance_squared));
+
+            cell_weights[size_t(row) * distribution_size + column] = std::max(cell_luminance, 0.0) * solid_angle;
+        }
+    }
+
+    // Running sums of every row, normalized to end at 1, and of the row totals for the marginal
+    for (int row = 0; row < rows; row++)
+    {
+        const double* weights = &cell_weights[size_t(row) * distribution_size];
+        double* cdf = &conditional_cdf[size_t(row) * (distribution_size + 1)];
+
+        for (int column = 0; column < distribution_size; column++)
+            cdf[column + 1] = cdf[column] + weights[column];
+
+        double row_weight = cdf[distribution_size];
+        marginal_cdf[row + 1] = marginal_cdf[row] + row_weight;
+
+        // Black rows are never chosen by the marginal, a uniform CDF only keeps the search well defined
+        for (int column = 1; column <= distribution_size; column++)
+            cdf[column] = row_weight > 0 ? cdf[column] / row_weight : double(column) / distribution_size;
+    }
+
+    total_weight = marginal_cdf[rows];
+
+    if (total_weight <= 0)
+    {
+        Logger::warn("SKYBOX_TEXTURE", "Skybox is black, it will not be sampled as a light");
+        return;
+    }
+
+    for (int row = 1; row <= rows; row++)
+        marginal_cdf[row] /= total_weight;
+}
+
+color Raytracing::SkyboxTexture::equirectangular_value(const ImageReader& image, const vec3& direction)
+{
+    const int width = image.width();
+    const int height = image.height();
+
+    // Spherical coordinates of the direction as UV coordinates of the image
+    double theta = atan2(direction.x, direction.z);
+    double phi = acos(std::clamp(direction.y, -1.0, 1.0));
+
+    double x = (theta + Raytracing::pi) / (2.0 * Raytracing::pi) * width - 0.5;
+    double y = phi / Raytracing::pi * height - 0.5;
+
+    int x0 = int(std::floor(x));
+    int y0 = int(std::floor(y));
+    double fx = x - x0;
+    double fy = y - y0;
+
+    // Wrap around the vertical axis, clamp at the poles
+    int left = (x0 % width + width) % width;
+    int right = (left + 1) % width;
+    int top = std::clamp(y0, 0, height - 1);
+    int bottom = std::clamp(y0 + 1, 0, height - 1);
+
+    return (1.0 - fy) * ((1.0 - fx) * image.pixel_data(left, top) + fx * image.pixel_data(right, top)) +
+        fy * ((1.0 - fx) * image.pixel_data(left, bottom) + fx * image.pixel_data(right, bottom));
+}
+
+vec3 Raytracing::SkyboxTexture::face_direction(int face, double s, double t)
+{
+    const auto& axes = face_axes[face];
+
+    return vec3(
+        axes[0][0] + s * axes[1][0] + t * axes[2][0],
+        axes[0][1] + s * axes[1][1] + t * axes[2][1],
+        axes[0][2] + s * axes[1][2] + t * axes[2][2]);
+}
+
+int Raytracing::SkyboxTexture::project(const vec3& direction, double& s, double& t)
+{
+    const double components[3] = { direction.x, direction.y, direction.z };
+    const double ax = std::abs(direction.x);
+    const double ay = std::abs(direction.y);
+    const double az = std::abs(direction.z);
+
+    // Axis of the largest component, the comparisons are combined with integer arithmetic so they compile to selects
+    const int x_major = (ax >= ay) & (ax >= az);
+    const int y_major = (1 - x_major) & (ay >= az);
+    const int axis = y_major + 2 * (1 - x_major - y_major);
+    const int face = 2 * axis + (components[axis] < 0);
+
+    // Central projection onto the face, one unit away along its major axis
+    const auto& axes = face_axes[face];
+    const double inverse_major = 1.0 / std::abs(components[axis]);
+
+    s = (direction.x * axes[1][0] + direction.y * axes[1][1] + direction.z * axes[1][2]) * inverse_major;
+    t = (direction.x * axes[2][0] + direction.y * axes[2][1] + direction.z * axes[2][2]) * inverse_major;
+
+    return face;
+}
+
+int Raytracing::SkyboxTexture::sample_cdf(const double* cdf, int count, double u, double& offset)
+{
+    // Last entry not greater than u, skipping cells of zero weight
+    int index = int(std::upper_bound(cdf, cdf + count + 1, u) - cdf) - 1;
+    index = std::clamp(index, 0, count - 1);
+
+    while (index > 0 && cdf[index + 1] <= cdf[index])
+        index--;
+
+    double width = cdf[index + 1] - cdf[index];
+    offset = width > 0 ? std::clamp((u - cdf[index]) / width, 0.0, 1.0) : 0.0;
+
+    return index;
 }
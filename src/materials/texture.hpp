@@ -22,7 +22,8 @@ namespace Raytracing
     {
     public:
         virtual ~Texture() = default;
-        virtual color value(optional<pair<double, double>> texture_coordinates, const point3& p) const = 0;
+        // The footprint is the width of the ray cone at the hit in texture coordinates, 0 asks for the finest detail
+        virtual color value(optional<pair<double, double>> texture_coordinates, const point3& p, double footprint = 0) const = 0;
     };
 
     class SolidColor : public Texture
@@ -31,7 +32,7 @@ namespace Raytracing
         SolidColor(const color& albedo);
         SolidColor(double red, double green, double blue);
 
-        color value(optional<pair<double, double>> texture_coordinates, const point3& p) const override;
+        color value(optional<pair<double, double>> texture_coordinates, const point3& p, double footprint = 0) const override;
 
     private:
         color albedo;
@@ -43,12 +44,12 @@ namespace Raytracing
         CheckerTexture(double scale, shared_ptr<Texture> even, shared_ptr<Texture> odd);
         CheckerTexture(double scale, const color& c1, const color& c2);
 
-        color value(optional<pair<double, double>> texture_coordinates, const point3& p) const override;
+        color value(optional<pair<double, double>> texture_coordinates, const point3& p, double footprint = 0) const override;
 
     private:
         double inv_scale;
-        const shared_ptr<Texture>& even;
-        const shared_ptr<Texture>& odd;
+        shared_ptr<Texture> even;
+        shared_ptr<Texture> odd;
     };
 
     class NoiseTexture : public Texture
@@ -56,7 +57,7 @@ namespace Raytracing
     public:
         NoiseTexture(double scale, int depth = 7);
 
-        color value(optional<pair<double, double>> texture_coordinates, const point3& p) const override;
+        color value(optional<pair<double, double>> texture_coordinates, const point3& p, double footprint = 0) const override;
 
     private:
         shared_ptr<Perlin> noise;
@@ -70,15 +71,25 @@ namespace Raytracing
         ImageTexture(const char* filename);
         ImageTexture(string filename);
         ImageTexture(const sTextureData& data, const pair<WGPUAddressMode, WGPUAddressMode>& uv_wrap_modes);
+        ImageTexture(const pair<WGPUAddressMode, WGPUAddressMode>& uv_wrap_modes);     // No image until set_image, for images decoded later
 
-        color value(optional<pair<double, double>> texture_coordinates, const point3& p) const override;
+        color value(optional<pair<double, double>> texture_coordinates, const point3& p, double footprint = 0) const override;
         pair<WGPUAddressMode, WGPUAddressMode> get_uv_wrap_modes() const;
+        color average() const;                          // Mean of the image, the single texel of the last mip level
+
+        void set_image(shared_ptr<ImageReader> level_zero);    // Applies the wrap modes and builds the mip levels of the image
 
     private:
         shared_ptr<ImageReader> image;
+        vector<shared_ptr<ImageReader>> mip_levels;     // Levels 1 onwards, each a 2x2 box filter of the previous one (level 0 is the image)
         const pair<WGPUAddressMode, WGPUAddressMode> uv_wrap_modes = make_pair(WGPUAddressMode_Undefined, WGPUAddressMode_Undefined);
+
+        void build_mip_levels();
     };
 
+    // Environment map of the background. The equirectangular image is resampled at load into a cube map of linear
+    // float texels whose faces carry a one texel border taken from the neighbouring faces, so a lookup projects the
+    // direction onto the face of its largest component and blends four texels, without trigonometry or bounds checks.
     class SkyboxTexture
     {
     public:
@@ -88,8 +99,46 @@ namespace Raytracing
 
         color value(const vec3& ray_direction) const;
 
+        // Importance sampling of the sky as an infinite light. Directions are drawn in proportion to the light of the
+        // cube map cells they see (a marginal CDF over the rows of the six faces and a conditional CDF inside each
+        // row), and the densities are given per unit solid angle so they can be combined with the BSDF ones.
+        vec3 sample(const pair<double, double>& u, double& pdf) const;
+        double pdf_value(const vec3& direction) const;
+        bool can_be_sampled() const;        // False for black skies, which give no light to sample
+
     private:
-        shared_ptr<ImageReader> skybox;
+        static constexpr int channels = 3;
+        static constexpr int max_distribution_face_size = 256;
+
+        // Major, s and t axes of the faces in the order +X, -X, +Y, -Y, +Z, -Z
+        static constexpr double face_axes[6][3][3] = {
+            { {  1,  0,  0 }, {  0,  0, -1 }, {  0, -1,  0 } },
+            { { -1,  0,  0 }, {  0,  0,  1 }, {  0, -1,  0 } },
+            { {  0,  1,  0 }, {  1,  0,  0 }, {  0,  0,  1 } },
+            { {  0, -1,  0 }, {  1,  0,  0 }, {  0,  0, -1 } },
+            { {  0,  0,  1 }, {  1,  0,  0 }, {  0, -1,  0 } },
+            { {  0,  0, -1 }, { -1,  0,  0 }, {  0, -1,  0 } },
+        };
+
+        // Cube map
+        int face_size = 0;                  // Texels along a side of a face, without the border
+        int face_stride = 0;                // Texels along a side of a bordered face
+        vector<float> texels;               // RGB of the six bordered faces, row-major
+
+        // Sampling distribution, cells of up to max_distribution_face_size texels along a side of a face
+        int distribution_size = 0;          // Cells along a side of a face
+        vector<double> cell_weights;        // Luminance times solid angle of every cell, the rows of the faces one after another
+        vector<double> conditional_cdf;     // distribution_size + 1 entries per row
+        vector<double> marginal_cdf;        // 6 * distribution_size + 1 entries
+        double total_weight = 0;
+
+        bool build_cube_map(const ImageReader& image);
+        void build_distribution();
+
+        static color equirectangular_value(const ImageReader& image, const vec3& direction);  // Bilinear lookup of the source image, only used while converting it
+        static vec3 face_direction(int face, double s, double t);                               // Direction through the face coordinates (s, t), not normalized
+        static int project(const vec3& direction, double& s, double& t);                        // Face seen by the direction and its coordinates on it, in [-1, 1]
+        static int sample_cdf(const double* cdf, int count, double u, double& offset);          // Cell containing u and the position of u inside it
     };
 }
 
@@ -0,0 +1,113 @@
+// Headers
+#include "core/core.hpp"
+#include "texture_cache.hpp"
+#include "texture.hpp"
+#include "core/arena.hpp"
+#include "utils/image_reader.hpp"
+
+// Framework headers
+#include "graphics/texture.h"
+
+// Usings
+using Raytracing::ImageTexture;
+using Raytracing::ImageReader;
+using Raytracing::make_arena_shared;
+
+shared_ptr<ImageTexture> Raytracing::TextureCache::get(::Texture* texture)
+{
+    if (!texture)
+    {
+        string error = Logger::error("TEXTURE CACHE", "Trying to load a null texture.");
+        throw std::invalid_argument(error);
+    }
+
+    // The same image sampled with other wrap modes is a different texture
+    pair<WGPUAddressMode, WGPUAddressMode> uv_wrap_modes = make_pair(texture->get_wrap_u(), texture->get_wrap_v());
+    framework_key key = { texture, uv_wrap_modes.first, uv_wrap_modes.second };
+
+    auto it = framework_textures.find(key);
+    if (it != framework_textures.end())
+    {
+        reuse_count++;
+        return it->second;
+    }
+
+    auto parsed_texture = make_arena_shared<ImageTexture>(uv_wrap_modes);
+    framework_textures.emplace(key, parsed_texture);
+    pending.push_back({ parsed_texture, &texture->get_texture_data(), "" });
+
+    return parsed_texture;
+}
+
+shared_ptr<ImageTexture> Raytracing::TextureCache::get(const string& filename)
+{
+    // Different spellings of one path ("a/../b.png", "./b.png") name the same file, even before it is found
+    std::error_code error_code;
+    fs::path absolute_path = fs::absolute(fs::path(filename), error_code);
+    string key = error_code ? filename : fs::weakly_canonical(absolute_path, error_code).string();
+
+    if (error_code)
+        key = filename;
+
+    auto it = file_textures.find(key);
+    if (it != file_textures.end())
+    {
+        reuse_count++;
+        return it->second;
+    }
+
+    auto loaded_texture = make_arena_shared<ImageTexture>(make_pair(WGPUAddressMode_Undefined, WGPUAddressMode_Undefined));
+    file_textures.emplace(key, loaded_texture);
+    pending.push_back({ loaded_texture, nullptr, filename });
+
+    return loaded_texture;
+}
+
+void Raytracing::TextureCache::load()
+{
+    // Decoding and filtering one image does not touch any other, so whole textures are spread over the threads. The
+    // arena is only open on this thread, the others keep their images on the heap.
+    std::exception_ptr failure = nullptr;
+
+    #pragma omp parallel for schedule(dynamic, 1) if(parallelize)
+    for (int i = 0; i < int(pending.size()); i++)
+    {
+        const pending_texture& request = pending[i];
+
+        try
+        {
+            shared_ptr<ImageReader> image = request.data ? make_shared<ImageReader>(*request.data) : make_shared<ImageReader>(request.filename.c_str());
+            request.texture->set_image(image);
+        }
+        catch (...)
+        {
+            // Exceptions cannot leave the parallel loop, the first one is thrown again once every thread is done
+            #pragma omp critical(texture_cache_failure)
+            if (!failure)
+                failure = std::current_exception();
+        }
+    }
+
+    pending.clear();
+
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+void Raytracing::TextureCache::clear()
+{
+    framework_textures.clear();
+    file_textures.clear();
+    pending.clear();
+    reuse_count = 0;
+}
+
+size_t Raytracing::TextureCache::size() const
+{
+    return framework_textures.size() + file_textures.size();
+}
+
+size_t Raytracing::TextureCache::reused() const
+{
+    return reuse_count;
+}
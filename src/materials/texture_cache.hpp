@@ -0,0 +1,55 @@
+#pragma once
+
+// Headers
+#include "core/core.hpp"
+
+// Framework headers
+#include <webgpu/webgpu.h>
+
+// Framework forward declarations
+class Texture;
+struct sTextureData;
+
+// Namespace forward declarations
+namespace Raytracing
+{
+    class ImageTexture;
+}
+
+namespace Raytracing
+{
+    // Image textures created while loading a scene, one per source image. Surfaces and OBJ shapes that sample the
+    // same image share a single ImageTexture, so its file is decoded, its texels converted and its mip pyramid built
+    // only once.
+    // The textures handed out are empty until load() is called, which decodes all of the new ones at the same time,
+    // one per thread, so a scene with many images loads in about the time of its biggest one.
+    class TextureCache
+    {
+    public:
+        bool parallelize = true;
+
+        shared_ptr<ImageTexture> get(::Texture* texture);           // Framework texture, keyed by its address and wrap modes
+        shared_ptr<ImageTexture> get(const string& filename);       // Image file, keyed by its normalized path
+        void load();                                                // Fills the textures requested since the last load
+        void clear();
+
+        size_t size() const;        // Distinct textures created
+        size_t reused() const;      // Requests served by a texture created before
+
+    private:
+        using framework_key = std::tuple<const ::Texture*, WGPUAddressMode, WGPUAddressMode>;
+
+        // Texture waiting for its image, which comes either from the framework data or from the file
+        struct pending_texture
+        {
+            shared_ptr<ImageTexture> texture;
+            const sTextureData* data = nullptr;
+            string filename;
+        };
+
+        std::map<framework_key, shared_ptr<ImageTexture>> framework_textures;
+        std::map<string, shared_ptr<ImageTexture>> file_textures;
+        vector<pending_texture> pending;
+        size_t reuse_count = 0;
+    };
+}
@@ -0,0 +1,37 @@
+// Headers
+#include "core/core.hpp"
+#include "affine_transform.hpp"
+
+// Constructors
+Raytracing::AffineTransform::AffineTransform(const Matrix44& m)
+{
+    identity = m == Matrix44::identity();
+    if (identity)
+        return;
+
+    // Instance models are affine so the cheaper inverse path is taken
+    const Matrix44 inv = m.is_affine() ? m.affine_inverse() : m.inverse();
+
+    for (unsigned i = 0; i < 3; i++)
+    {
+        for (unsigned j = 0; j < 4; j++)
+        {
+            model[i][j] = float(m[i][j]);
+            inverse_model[i][j] = float(inv[i][j]);
+        }
+    }
+
+    // Normal matrix is the transpose of the inverse linear part
+    for (unsigned i = 0; i < 3; i++)
+    {
+        for (unsigned j = 0; j < 3; j++)
+        {
+            normal_matrix[i][j] = float(inv[j][i]);
+        }
+    }
+
+    // Volume scale of the linear part, expanded along its first row
+    linear_determinant = std::abs(m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+                                - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+                                + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]));
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+// Headers
+#include "core/core.hpp"
+#include "math/vec3.hpp"
+#include "matrix.hpp"
+
+// Fused multiply-add only where the hardware has one, elsewhere (WebAssembly) std::fma is a slow software fmaf.
+// MSVC defines neither FP_FAST_FMAF nor __FMA__ but /arch:AVX2 guarantees FMA3 support.
+#if defined(FP_FAST_FMAF) || defined(__FMA__) || defined(__AVX2__)
+    #define raytracing_fmadd_f(a, b, c) std::fma(a, b, c)
+#else
+    #define raytracing_fmadd_f(a, b, c) ((a) * (b) + (c))
+#endif
+
+namespace Raytracing
+{
+    // Compact instance transform used on the intersection path. The model matrix, its inverse and the normal matrix
+    // (inverse-transpose of the linear part) are stored as 3x4 float affine matrices and computed once when set.
+    class AffineTransform
+    {
+    public:
+        AffineTransform() = default;    // Identity
+        AffineTransform(const Matrix44& model);
+
+        bool is_identity() const;
+
+        // World space => object space
+        point3 inverse_transform_point(const point3& p) const;
+        vec3 inverse_transform_vector(const vec3& v) const;
+
+        // Object space => world space
+        point3 transform_point(const point3& p) const;
+        vec3 transform_vector(const vec3& v) const;
+        vec3 transform_normal(const vec3& n) const;   // Correct under non-uniform scale, not normalized
+
+        // Surface area in world space of a unit area in object space is determinant * |transform_normal(n)| for its unit normal n
+        double determinant() const;                   // Absolute determinant of the linear part
+
+    private:
+        // Row-major 3x4 matrices, the implicit fourth row is (0, 0, 0, 1)
+        float model[3][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } };
+        float inverse_model[3][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } };
+        float normal_matrix[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+        double linear_determinant = 1;
+        bool identity = true;
+    };
+
+    // Affine products, each output component is three chained multiply-adds
+    inline vec3 affine_point(const float (&m)[3][4], const vec3& p)
+    {
+        const float x = float(p.x), y = float(p.y), z = float(p.z);
+
+        return vec3
+        (
+            raytracing_fmadd_f(m[0][0], x, raytracing_fmadd_f(m[0][1], y, raytracing_fmadd_f(m[0][2], z, m[0][3]))),
+            raytracing_fmadd_f(m[1][0], x, raytracing_fmadd_f(m[1][1], y, raytracing_fmadd_f(m[1][2], z, m[1][3]))),
+            raytracing_fmadd_f(m[2][0], x, raytracing_fmadd_f(m[2][1], y, raytracing_fmadd_f(m[2][2], z, m[2][3])))
+        );
+    }
+
+    inline vec3 affine_vector(const float (&m)[3][4], const vec3& v)
+    {
+        const float x = float(v.x), y = float(v.y), z = float(v.z);
+
+        return vec3
+        (
+            raytracing_fmadd_f(m[0][0], x, raytracing_fmadd_f(m[0][1], y, m[0][2] * z)),
+            raytracing_fmadd_f(m[1][0], x, raytracing_fmadd_f(m[1][1], y, m[1][2] * z)),
+            raytracing_fmadd_f(m[2][0], x, raytracing_fmadd_f(m[2][1], y, m[2][2] * z))
+        );
+    }
+
+    inline bool AffineTransform::is_identity() const
+    {
+        return identity;
+    }
+
+    inline double AffineTransform::determinant() const
+    {
+        return linear_determinant;
+    }
+
+    inline point3 AffineTransform::inverse_transform_point(const point3& p) const
+    {
+        return identity ? p : affine_point(inverse_model, p);
+    }
+
+    inline vec3 AffineTransform::inverse_transform_vector(const vec3& v) const
+    {
+        return identity ? v : affine_vector(inverse_model, v);
+    }
+
+    inline point3 AffineTransform::transform_point(const point3& p) const
+    {
+        return identity ? p : affine_point(model, p);
+    }
+
+    inline vec3 AffineTransform::transform_vector(const vec3& v) const
+    {
+        return identity ? v : affine_vector(model, v);
+    }
+
+    inline vec3 AffineTransform::transform_normal(const vec3& n) const
+    {
+        if (identity)
+            return n;
+
+        const float x = float(n.x), y = float(n.y), z = float(n.z);
+        const float (&m)[3][3] = normal_matrix;
+
+        return vec3
+        (
+            raytracing_fmadd_f(m[0][0], x, raytracing_fmadd_f(m[0][1], y, m[0][2] * z)),
+            raytracing_fmadd_f(m[1][0], x, raytracing_fmadd_f(m[1][1], y, m[1][2] * z)),
+            raytracing_fmadd_f(m[2][0], x, raytracing_fmadd_f(m[2][1], y, m[2][2] * z))
+        );
+    }
+}
@@ -25,9 +25,7 @@ Raytracing::Matrix::Matrix(unsigned num_rows, unsigned num_columns, double initi
     values = vector<vector<double>>(num_rows, vector<double>(num_columns, initial));
 }
 
-Raytracing::Matrix44::Matrix44(double initial) : Matrix(4, 4, initial) {}
-
-Raytracing::Matrix44::Matrix44(const Matrix& matrix) : Matrix(matrix)
+Raytracing::Matrix44::Matrix44(const Matrix& matrix)
 {
     int num_rows = matrix.get_num_rows();
     int num_columns = matrix.get_num_columns();
@@ -37,35 +35,21 @@ Raytracing::Matrix44::Matrix44(const Matrix& matrix) : Matrix(matrix)
         string error = Logger::error("Matrix", std::format("Invalid cast exception! You are trying to convert a Matrix into a Matrix44 but Matrix is {}x{} and not 4x4", num_rows, num_columns));
         throw std::invalid_argument(error);
     }
+
+    for (unsigned i = 0; i < 4; i++)
+        for (unsigned j = 0; j < 4; j++)
+            values[i][j] = matrix(i, j);
 }
 
 Raytracing::Matrix44::Matrix44(const glm::mat4x4& m)
-: Matrix(4, 4) 
 {
-    (*this)[0][0] = m[0][0]; (*this)[0][1] = m[1][0]; (*this)[0][2] = m[2][0]; (*this)[0][3] = m[3][0];
-    (*this)[1][0] = m[0][1]; (*this)[1][1] = m[1][1]; (*this)[1][2] = m[2][1]; (*this)[1][3] = m[3][1];
-    (*this)[2][0] = m[0][2]; (*this)[2][1] = m[1][2]; (*this)[2][2] = m[2][2]; (*this)[2][3] = m[3][2];
-    (*this)[3][0] = m[0][3]; (*this)[3][1] = m[1][3]; (*this)[3][2] = m[2][3]; (*this)[3][3] = m[3][3];
+    values[0][0] = m[0][0]; values[0][1] = m[1][0]; values[0][2] = m[2][0]; values[0][3] = m[3][0];
+    values[1][0] = m[0][1]; values[1][1] = m[1][1]; values[1][2] = m[2][1]; values[1][3] = m[3][1];
+    values[2][0] = m[0][2]; values[2][1] = m[1][2]; values[2][2] = m[2][2]; values[2][3] = m[3][2];
+    values[3][0] = m[0][3]; values[3][1] = m[1][3]; values[3][2] = m[2][3]; values[3][3] = m[3][3];
 }
 
-Raytracing::Matrix44::Matrix44
-(
-    double m00, double m01, double m02, double m03,
-    double m10, double m11, double m12, double m13,
-    double m20, double m21, double m22, double m23,
-    double m30, double m31, double m32, double m33
-) 
-    : Matrix(4, 4)
-{
-    (*this)[0][0] = m00; (*this)[0][1] = m01; (*this)[0][2] = m02; (*this)[0][3] = m03;
-    (*this)[1][0] = m10; (*this)[1][1] = m11; (*this)[1][2] = m12; (*this)[1][3] = m13;
-    (*this)[2][0] = m20; (*this)[2][1] = m21; (*this)[2][2] = m22; (*this)[2][3] = m23;
-    (*this)[3][0] = m30; (*this)[3][1] = m31; (*this)[3][2] = m32; (*this)[3][3] = m33;
-}
-
-Raytracing::Matrix33::Matrix33(double initial) : Matrix(3, 3, initial) {}
-
-Raytracing::Matrix33::Matrix33(const Matrix& matrix) : Matrix(matrix)
+Raytracing::Matrix33::Matrix33(const Matrix& matrix)
 {
     int num_rows = matrix.get_num_rows();
     int num_columns = matrix.get_num_columns();
@@ -75,24 +59,13 @@ Raytracing::Matrix33::Matrix33(const Matrix& matrix) : Matrix(matrix)
         string error = Logger::error("Matrix", std::format("Invalid cast exception! You are trying to convert a Matrix into a Matrix33 but Matrix is {}x{} and not 3x3", num_rows, num_columns));
         throw std::invalid_argument(error);
     }
-}
 
-Raytracing::Matrix33::Matrix33
-(
-    double m00, double m01, double m02, 
-    double m10, double m11, double m12, 
-    double m20, double m21, double m22
-)
-    : Matrix(3, 3)
-{
-    (*this)[0][0] = m00; (*this)[0][1] = m01; (*this)[0][2] = m02;
-    (*this)[1][0] = m10; (*this)[1][1] = m11; (*this)[1][2] = m12;
-    (*this)[2][0] = m20; (*this)[2][1] = m21; (*this)[2][2] = m22;
+    for (unsigned i = 0; i < 3; i++)
+        for (unsigned j = 0; j < 3; j++)
+            values[i][j] = matrix(i, j);
 }
 
-Raytracing::Matrix22::Matrix22(double initial) : Matrix(2, 2, initial) {}
-
-Raytracing::Matrix22::Matrix22(const Matrix& matrix) : Matrix(matrix)
+Raytracing::Matrix22::Matrix22(const Matrix& matrix)
 {
     int num_rows = matrix.get_num_rows();
     int num_columns = matrix.get_num_columns();
@@ -102,17 +75,10 @@ Raytracing::Matrix22::Matrix22(const Matrix& matrix) : Matrix(matrix)
         string error = Logger::error("Matrix", std::format("Invalid cast exception! You are trying to convert a Matrix into a Matrix22 but Matrix is {}x{} and not 2x2", num_rows, num_columns));
         throw std::invalid_argument(error);
     }
-}
 
-Raytracing::Matrix22::Matrix22
-(
-    double m00, double m01, 
-    double m10, double m11
-)
-    : Matrix(2, 2)
-{
-    (*this)[0][0] = m00; (*this)[0][1] = m01;
-    (*this)[1][0] = m10; (*this)[1][1] = m11;
+    for (unsigned i = 0; i < 2; i++)
+        for (unsigned j = 0; j < 2; j++)
+            values[i][j] = matrix(i, j);
 }
 
 // Matrix operations
@@ -498,3 +464,160 @@ unsigned Raytracing::Matrix::get_num_columns() const
 {
     return num_columns;
 }
+
+// Fixed-size matrix operations
+double Raytracing::Matrix44::determinant() const
+{
+    const double (&m)[4][4] = values;
+
+    // 2x2 sub-determinants of the two upper and the two lower rows
+    const double s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    const double s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    const double s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    const double s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    const double s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    const double s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+    const double c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+    const double c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    const double c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    const double c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    const double c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    const double c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+    return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+Raytracing::Matrix44 Raytracing::Matrix44::inverse() const
+{
+    if (is_affine())
+        return affine_inverse();
+
+    const double (&m)[4][4] = values;
+
+    // 2x2 sub-determinants of the two upper and the two lower rows
+    const double s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+    const double s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+    const double s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+    const double s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+    const double s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+    const double s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+    const double c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+    const double c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+    const double c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+    const double c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+    const double c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+    const double c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+
+    const double det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (det == 0)
+    {
+        string error = Logger::error("MATRIX", "Matrix is singular and cannot be inverted.");
+        throw std::invalid_argument(error);
+    }
+
+    const double inv_det = 1.0 / det;
+
+    return Matrix44
+    (
+        ( m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * inv_det,
+        (-m[0][1] * c5 + m[0][2] * c4 - m[0][3] * c3) * inv_det,
+        ( m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * inv_det,
+        (-m[2][1] * s5 + m[2][2] * s4 - m[2][3] * s3) * inv_det,
+
+        (-m[1][0] * c5 + m[1][2] * c2 - m[1][3] * c1) * inv_det,
+        ( m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * inv_det,
+        (-m[3][0] * s5 + m[3][2] * s2 - m[3][3] * s1) * inv_det,
+        ( m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * inv_det,
+
+        ( m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * inv_det,
+        (-m[0][0] * c4 + m[0][1] * c2 - m[0][3] * c0) * inv_det,
+        ( m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * inv_det,
+        (-m[2][0] * s4 + m[2][1] * s2 - m[2][3] * s0) * inv_det,
+
+        (-m[1][0] * c3 + m[1][1] * c1 - m[1][2] * c0) * inv_det,
+        ( m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * inv_det,
+        (-m[3][0] * s3 + m[3][1] * s1 - m[3][2] * s0) * inv_det,
+        ( m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * inv_det
+    );
+}
+
+Raytracing::Matrix44 Raytracing::Matrix44::affine_inverse() const
+{
+    const double (&m)[4][4] = values;
+
+    // Invert the upper-left 3x3 block through its adjugate
+    const Matrix33 linear
+    (
+        m[0][0], m[0][1], m[0][2],
+        m[1][0], m[1][1], m[1][2],
+        m[2][0], m[2][1], m[2][2]
+    );
+
+    const Matrix33 inv = linear.inverse();
+
+    // The inverse translation is -A^-1 * t
+    const double tx = m[0][3], ty = m[1][3], tz = m[2][3];
+
+    return Matrix44
+    (
+        inv[0][0], inv[0][1], inv[0][2], -(inv[0][0] * tx + inv[0][1] * ty + inv[0][2] * tz),
+        inv[1][0], inv[1][1], inv[1][2], -(inv[1][0] * tx + inv[1][1] * ty + inv[1][2] * tz),
+        inv[2][0], inv[2][1], inv[2][2], -(inv[2][0] * tx + inv[2][1] * ty + inv[2][2] * tz),
+        0.0, 0.0, 0.0, 1.0
+    );
+}
+
+Raytracing::Matrix44& Raytracing::Matrix44::operator+=(const Matrix44& M)
+{
+    for (unsigned i = 0; i < 4; i++)
+        for (unsigned j = 0; j < 4; j++)
+            values[i][j] += M[i][j];
+
+    return *this;
+}
+
+Raytracing::Matrix44& Raytracing::Matrix44::operator-=(const Matrix44& M)
+{
+    for (unsigned i = 0; i < 4; i++)
+        for (unsigned j = 0; j < 4; j++)
+            values[i][j] -= M[i][j];
+
+    return *this;
+}
+
+Raytracing::Matrix44& Raytracing::Matrix44::operator*=(const double scalar)
+{
+    for (unsigned i = 0; i < 4; i++)
+        for (unsigned j = 0; j < 4; j++)
+            values[i][j] *= scalar;
+
+    return *this;
+}
+
+Raytracing::Matrix33 Raytracing::Matrix33::inverse() const
+{
+    const double (&m)[3][3] = values;
+
+    // Cofactors of the first column, reused by the determinant
+    const double c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    const double c10 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    const double c20 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+
+    const double det = m[0][0] * c00 + m[0][1] * c10 + m[0][2] * c20;
+    if (det == 0)
+    {
+        string error = Logger::error("MATRIX", "Matrix is singular and cannot be inverted.");
+        throw std::invalid_argument(error);
+    }
+
+    const double inv_det = 1.0 / det;
+
+    return Matrix33
+    (
+        c00 * inv_det, (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv_det, (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv_det,
+        c10 * inv_det, (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv_det, (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv_det,
+        c20 * inv_det, (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv_det, (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv_det
+    );
+}
@@ -2,6 +2,7 @@
 
 // Headers
 #include "core/core.hpp"
+#include "core/simd.hpp"
 #include "vec3.hpp"
 #include "vec4.hpp"
 #include "glm/mat4x4.hpp"
@@ -59,44 +60,204 @@ namespace Raytracing
         Matrix();
     };
 
-    class Matrix44 : public Matrix
+    // Fixed-size matrices are stack allocated and constexpr friendly, so they can be used on the render hot path
+    // without touching the allocator. Values are stored in row-major order.
+
+    class Matrix44
     {
     public:
-        Matrix44(double initial = 0.0);
-        Matrix44(const Matrix& m); // Conversion constructor
-        Matrix44(const glm::mat4x4& m);
-        Matrix44
+        // Constructors
+        constexpr Matrix44(double initial = 0.0) : values{}
+        {
+            for (unsigned i = 0; i < 4; i++)
+                for (unsigned j = 0; j < 4; j++)
+                    values[i][j] = initial;
+        }
+
+        constexpr Matrix44
         (
             double m00, double m01, double m02, double m03,
             double m10, double m11, double m12, double m13,
             double m20, double m21, double m22, double m23,
             double m30, double m31, double m32, double m33
-        );
+        )
+            : values{ { m00, m01, m02, m03 }, { m10, m11, m12, m13 }, { m20, m21, m22, m23 }, { m30, m31, m32, m33 } }
+        {}
+
+        Matrix44(const Matrix& m); // Conversion constructor
+        Matrix44(const glm::mat4x4& m);
+
+        // Matrix Operations
+        static constexpr Matrix44 identity()
+        {
+            return Matrix44
+            (
+                1.0, 0.0, 0.0, 0.0,
+                0.0, 1.0, 0.0, 0.0,
+                0.0, 0.0, 1.0, 0.0,
+                0.0, 0.0, 0.0, 1.0
+            );
+        }
+
+        constexpr Matrix44 transpose() const
+        {
+            return Matrix44
+            (
+                values[0][0], values[1][0], values[2][0], values[3][0],
+                values[0][1], values[1][1], values[2][1], values[3][1],
+                values[0][2], values[1][2], values[2][2], values[3][2],
+                values[0][3], values[1][3], values[2][3], values[3][3]
+            );
+        }
+
+        constexpr double trace() const
+        {
+            return values[0][0] + values[1][1] + values[2][2] + values[3][3];
+        }
+
+        constexpr bool is_affine() const // Last row is (0, 0, 0, 1)
+        {
+            return values[3][0] == 0.0 && values[3][1] == 0.0 && values[3][2] == 0.0 && values[3][3] == 1.0;
+        }
+
+        double determinant() const;
+        Matrix44 inverse() const;           // Closed-form inverse. Uses the affine path when the last row is (0, 0, 0, 1).
+        Matrix44 affine_inverse() const;    // Closed-form inverse of [A | t] as [A^-1 | -A^-1 * t]
+
+        // Affine transformations (the implicit w component is 1 for points and 0 for vectors)
+        vec3 transform_point(const vec3& p) const;
+        vec3 transform_vector(const vec3& v) const;
+
+        // Operator Overloads
+        constexpr double* operator[](unsigned row) { return values[row]; }
+        constexpr const double* operator[](unsigned row) const { return values[row]; }
+        constexpr double operator()(unsigned row, unsigned col) const { return values[row][col]; }
+
+        Matrix44& operator+=(const Matrix44& M);
+        Matrix44& operator-=(const Matrix44& M);
+        Matrix44& operator*=(const double scalar);
+
+        // Getters
+        constexpr unsigned get_num_rows() const { return 4; }
+        constexpr unsigned get_num_columns() const { return 4; }
+
+    private:
+        alignas(32) double values[4][4];
     };
 
-    class Matrix33 : public Matrix
+    class Matrix33
     {
     public:
-        Matrix33(double initial = 0.0);
-        Matrix33(const Matrix& m); // Conversion constructor
-        Matrix33
+        // Constructors
+        constexpr Matrix33(double initial = 0.0) : values{}
+        {
+            for (unsigned i = 0; i < 3; i++)
+                for (unsigned j = 0; j < 3; j++)
+                    values[i][j] = initial;
+        }
+
+        constexpr Matrix33
         (
             double m00, double m01, double m02,
             double m10, double m11, double m12,
             double m20, double m21, double m22
-        );
+        )
+            : values{ { m00, m01, m02 }, { m10, m11, m12 }, { m20, m21, m22 } }
+        {}
+
+        Matrix33(const Matrix& m); // Conversion constructor
+
+        // Matrix Operations
+        static constexpr Matrix33 identity()
+        {
+            return Matrix33
+            (
+                1.0, 0.0, 0.0,
+                0.0, 1.0, 0.0,
+                0.0, 0.0, 1.0
+            );
+        }
+
+        constexpr Matrix33 transpose() const
+        {
+            return Matrix33
+            (
+                values[0][0], values[1][0], values[2][0],
+                values[0][1], values[1][1], values[2][1],
+                values[0][2], values[1][2], values[2][2]
+            );
+        }
+
+        constexpr double trace() const
+        {
+            return values[0][0] + values[1][1] + values[2][2];
+        }
+
+        constexpr double determinant() const
+        {
+            return values[0][0] * (values[1][1] * values[2][2] - values[1][2] * values[2][1])
+                 - values[0][1] * (values[1][0] * values[2][2] - values[1][2] * values[2][0])
+                 + values[0][2] * (values[1][0] * values[2][1] - values[1][1] * values[2][0]);
+        }
+
+        Matrix33 inverse() const; // Closed-form inverse (adjugate over determinant)
+
+        // Operator Overloads
+        constexpr double* operator[](unsigned row) { return values[row]; }
+        constexpr const double* operator[](unsigned row) const { return values[row]; }
+        constexpr double operator()(unsigned row, unsigned col) const { return values[row][col]; }
+
+        // Getters
+        constexpr unsigned get_num_rows() const { return 3; }
+        constexpr unsigned get_num_columns() const { return 3; }
+
+    private:
+        double values[3][3];
     };
 
-    class Matrix22 : public Matrix
+    class Matrix22
     {
     public:
-        Matrix22(double initial = 0.0);
-        Matrix22(const Matrix& m);  // Conversion constructor
-        Matrix22
+        // Constructors
+        constexpr Matrix22(double initial = 0.0) : values{ { initial, initial }, { initial, initial } } {}
+
+        constexpr Matrix22
         (
             double m00, double m01,
             double m10, double m11
-        );
+        )
+            : values{ { m00, m01 }, { m10, m11 } }
+        {}
+
+        Matrix22(const Matrix& m);  // Conversion constructor
+
+        // Matrix Operations
+        static constexpr Matrix22 identity()
+        {
+            return Matrix22(1.0, 0.0, 0.0, 1.0);
+        }
+
+        constexpr Matrix22 transpose() const
+        {
+            return Matrix22(values[0][0], values[1][0], values[0][1], values[1][1]);
+        }
+
+        constexpr double determinant() const
+        {
+            return values[0][0] * values[1][1] - values[0][1] * values[1][0];
+        }
+
+        // Operator Overloads
+        constexpr double* operator[](unsigned row) { return values[row]; }
+        constexpr const double* operator[](unsigned row) const { return values[row]; }
+        constexpr double operator()(unsigned row, unsigned col) const { return values[row][col]; }
+
+        // Getters
+        constexpr unsigned get_num_rows() const { return 2; }
+        constexpr unsigned get_num_columns() const { return 2; }
+
+    private:
+        double values[2][2];
     };
 
     // ************ Non-member operator overloads ************ //
@@ -303,30 +464,155 @@ namespace Raytracing
         return !(A == B);
     }
 
-    // Matrix & vec operations
-    inline vec4 operator*(const Matrix44& mat, const vec4& v)
+    // ************ Fixed-size operator overloads ************ //
+
+    // Matrix44 operators
+    constexpr Matrix44 operator*(const Matrix44& A, const Matrix44& B)
     {
-        vec4 result;
+        Matrix44 result;
 
-        for (int i = 0; i < 4; ++i)
+#if RAYTRACING_SIMD_AVX
+        if (!std::is_constant_evaluated())
         {
-            result[i] = mat[i][0] * v.x + mat[i][1] * v.y + mat[i][2] * v.z + mat[i][3] * v.w;
+            // Row i of the product is the linear combination of the rows of B weighted by row i of A
+            for (unsigned i = 0; i < 4; i++)
+            {
+                __m256d row = _mm256_mul_pd(_mm256_set1_pd(A[i][0]), _mm256_load_pd(B[0]));
+                row = raytracing_fmadd_pd(_mm256_set1_pd(A[i][1]), _mm256_load_pd(B[1]), row);
+                row = raytracing_fmadd_pd(_mm256_set1_pd(A[i][2]), _mm256_load_pd(B[2]), row);
+                row = raytracing_fmadd_pd(_mm256_set1_pd(A[i][3]), _mm256_load_pd(B[3]), row);
+                _mm256_store_pd(result[i], row);
+            }
+
+            return result;
+        }
+#endif
+
+        for (unsigned i = 0; i < 4; i++)
+        {
+            for (unsigned j = 0; j < 4; j++)
+            {
+                result[i][j] = A[i][0] * B[0][j] + A[i][1] * B[1][j] + A[i][2] * B[2][j] + A[i][3] * B[3][j];
+            }
         }
 
         return result;
     }
 
-    inline vec3 operator*(const Matrix33& mat, const vec3& v)
+    inline Matrix44 operator*(const Matrix44& M, const double scalar)
     {
-        vec3 result;
+        Matrix44 result = M;
+        result *= scalar;
+        return result;
+    }
+
+    inline Matrix44 operator*(const double scalar, const Matrix44& M) { return M * scalar; }
 
-        for (int i = 0; i < 3; ++i)
+    inline bool operator==(const Matrix44& A, const Matrix44& B)
+    {
+        for (unsigned i = 0; i < 4; ++i)
         {
-            result[i] = mat[i][0] * v.x + mat[i][1] * v.y + mat[i][2] * v.z;
+            for (unsigned j = 0; j < 4; ++j)
+            {
+                if (std::fabs(A[i][j] - B[i][j]) > DBL_EPSILON)
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    inline bool operator!=(const Matrix44& A, const Matrix44& B) { return !(A == B); }
+
+    // Matrix33 operators
+    constexpr Matrix33 operator*(const Matrix33& A, const Matrix33& B)
+    {
+        Matrix33 result;
+
+        for (unsigned i = 0; i < 3; i++)
+        {
+            for (unsigned j = 0; j < 3; j++)
+            {
+                result[i][j] = A[i][0] * B[0][j] + A[i][1] * B[1][j] + A[i][2] * B[2][j];
+            }
         }
 
         return result;
     }
-}
 
+    inline bool operator==(const Matrix33& A, const Matrix33& B)
+    {
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            for (unsigned j = 0; j < 3; ++j)
+            {
+                if (std::fabs(A[i][j] - B[i][j]) > DBL_EPSILON)
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    inline bool operator!=(const Matrix33& A, const Matrix33& B) { return !(A == B); }
+
+    // Matrix & vec operations
+    inline vec4 operator*(const Matrix44& mat, const vec4& v)
+    {
+#if RAYTRACING_SIMD_AVX
+        // Four row dot products reduced with two horizontal adds
+        const __m256d vv = _mm256_set_pd(v.w, v.z, v.y, v.x);
+        const __m256d r0 = _mm256_mul_pd(_mm256_load_pd(mat[0]), vv);
+        const __m256d r1 = _mm256_mul_pd(_mm256_load_pd(mat[1]), vv);
+        const __m256d r2 = _mm256_mul_pd(_mm256_load_pd(mat[2]), vv);
+        const __m256d r3 = _mm256_mul_pd(_mm256_load_pd(mat[3]), vv);
+
+        const __m256d h01 = _mm256_hadd_pd(r0, r1);
+        const __m256d h23 = _mm256_hadd_pd(r2, r3);
+        const __m256d sum = _mm256_add_pd(_mm256_permute2f128_pd(h01, h23, 0x20), _mm256_permute2f128_pd(h01, h23, 0x31));
+
+        alignas(32) double out[4];
+        _mm256_store_pd(out, sum);
+
+        return vec4(out[0], out[1], out[2], out[3]);
+#else
+        return vec4
+        (
+            mat[0][0] * v.x + mat[0][1] * v.y + mat[0][2] * v.z + mat[0][3] * v.w,
+            mat[1][0] * v.x + mat[1][1] * v.y + mat[1][2] * v.z + mat[1][3] * v.w,
+            mat[2][0] * v.x + mat[2][1] * v.y + mat[2][2] * v.z + mat[2][3] * v.w,
+            mat[3][0] * v.x + mat[3][1] * v.y + mat[3][2] * v.z + mat[3][3] * v.w
+        );
+#endif
+    }
+
+    inline vec3 operator*(const Matrix33& mat, const vec3& v)
+    {
+        return vec3
+        (
+            mat[0][0] * v.x + mat[0][1] * v.y + mat[0][2] * v.z,
+            mat[1][0] * v.x + mat[1][1] * v.y + mat[1][2] * v.z,
+            mat[2][0] * v.x + mat[2][1] * v.y + mat[2][2] * v.z
+        );
+    }
+
+    inline vec3 Matrix44::transform_point(const vec3& p) const
+    {
+        return vec3
+        (
+            values[0][0] * p.x + values[0][1] * p.y + values[0][2] * p.z + values[0][3],
+            values[1][0] * p.x + values[1][1] * p.y + values[1][2] * p.z + values[1][3],
+            values[2][0] * p.x + values[2][1] * p.y + values[2][2] * p.z + values[2][3]
+        );
+    }
 
+    inline vec3 Matrix44::transform_vector(const vec3& v) const
+    {
+        return vec3
+        (
+            values[0][0] * v.x + values[0][1] * v.y + values[0][2] * v.z,
+            values[1][0] * v.x + values[1][1] * v.y + values[1][2] * v.z,
+            values[2][0] * v.x + values[2][1] * v.y + values[2][2] * v.z
+        );
+    }
+}
@@ -15,9 +15,9 @@ double uniform_sphere_pdf::value(const vec3& direction) const
     return 1 / (4 * pi);
 }
 
-vec3 uniform_sphere_pdf::generate() const 
+vec3 uniform_sphere_pdf::generate(const pair<double, double>& u) const 
 {
-    return random_unit_vector();
+    return sample_uniform_sphere(u);
 }
 
 cosine_hemisphere_pdf::cosine_hemisphere_pdf(const vec3& normal)
@@ -31,10 +31,10 @@ double cosine_hemisphere_pdf::value(const vec3& direction) const
     return std::fmax(0, cosine_theta / pi);
 }
 
-vec3 cosine_hemisphere_pdf::generate() const
+vec3 cosine_hemisphere_pdf::generate(const pair<double, double>& u) const
 {
-    // Generate a random cosine-weighted hemisphere direction
-    vec3 scatter_direction = random_cosine_hemisphere_direction();
+    // Generate a cosine-weighted hemisphere direction
+    vec3 scatter_direction = sample_cosine_hemisphere(u);
 
     // Intercept degenerate scatter direction (if the direction is near zero, scatter along the normal)
     // if (scatter_direction.near_zero())
@@ -46,64 +46,29 @@ vec3 cosine_hemisphere_pdf::generate() const
     return scatter_direction;
 }
 
-hittable_pdf::hittable_pdf(shared_ptr<Hittable> object, const point3& hit_point)
-    : object(object), hit_point(hit_point)
-{}
-
-double hittable_pdf::value(const vec3& direction) const 
-{
-    return object->pdf_value(hit_point, direction);
-}
-vec3 hittable_pdf::generate() const 
-{
-    return object->random_scattering_ray(hit_point);
-}
+PDF::PDF(const uniform_sphere_pdf& pdf) : pdf(pdf) {}
 
-hittables_pdf::hittables_pdf(const vector<shared_ptr<Hittable>>& hittables, const point3& hit_point)
-    : hittables(hittables), hit_point(hit_point)
-{}
+PDF::PDF(const cosine_hemisphere_pdf& pdf) : pdf(pdf) {}
 
-double hittables_pdf::value(const vec3& scattering_direction) const 
+double PDF::value(const vec3& direction) const
 {
-    if (hittables.size() == 0)
-        return 0.0;
-
-    auto size = hittables.size();
-    auto weight = 1.0 / size;
-    auto sum = 0.0;
-
-    for (int i = 0; i < size; i++)
-    {
-        const auto& object = hittables[i];
-        sum += weight * object->pdf_value(hit_point, scattering_direction);
-    }
-
-    return sum;
+    return std::visit([&direction](const auto& p) { return p.value(direction); }, pdf);
 }
 
-vec3 hittables_pdf::generate() const 
+vec3 PDF::generate(const pair<double, double>& u) const
 {
-    auto size = int(hittables.size());
-    auto random_object_index = random_number<int>(0, size - 1);
-    return hittables[random_object_index]->random_scattering_ray(hit_point);
+    return std::visit([&u](const auto& p) { return p.generate(u); }, pdf);
 }
 
-mixture_pdf::mixture_pdf(shared_ptr<PDF> p0, shared_ptr<PDF> p1)
-{
-    p[0] = p0;
-    p[1] = p1;
-}
+hittable_pdf::hittable_pdf(const Hittable& object, const point3& hit_point)
+    : object(object), hit_point(hit_point)
+{}
 
-double mixture_pdf::value(const vec3& direction) const 
+double hittable_pdf::value(const vec3& direction) const 
 {
-    return 0.5 * p[0]->value(direction) + 0.5 * p[1]->value(direction);
+    return object.pdf_value(hit_point, direction);
 }
-
-vec3 mixture_pdf::generate() const 
+vec3 hittable_pdf::generate(const pair<double, double>& u) const 
 {
-    if (random_number<double>() < 0.5)
-        return p[0]->generate();
-    else
-        return p[1]->generate();
+    return object.random_scattering_ray(hit_point, u);
 }
-
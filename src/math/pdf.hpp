@@ -4,76 +4,96 @@
 #include "core/core.hpp"
 #include "vec3.hpp"
 #include "onb.hpp"
+#include "utils/utilities.hpp"
+#include <variant>
 
 // Forward declarations
 class Hittable;
 
-class PDF // Probability Distribution Function (PDF)
-{ 
-public:
-    virtual ~PDF() {};
-
-    virtual double value(const vec3& direction) const = 0;
-    virtual vec3 generate() const = 0;
-};
+// Probability Distribution Functions (PDF) used to sample scattering directions. They are small value types built on
+// the stack at every bounce, so sampling a direction never touches the heap. Directions are generated from a sample
+// point of the unit square given by the caller, usually the camera Sampler.
 
-class uniform_sphere_pdf : public PDF 
+class uniform_sphere_pdf
 {
 public:
     uniform_sphere_pdf();
 
-    double value(const vec3& direction) const override;
-    vec3 generate() const override;
+    double value(const vec3& direction) const;
+    vec3 generate(const pair<double, double>& u) const;   // Direction for the sample point u of the unit square
 };
 
-class cosine_hemisphere_pdf : public PDF 
+class cosine_hemisphere_pdf
 {
 public:
     cosine_hemisphere_pdf(const vec3& normal); // Generate a orthonormal basis of the hit point surface normal
 
-    double value(const vec3& direction) const override;
-    vec3 generate() const override;
+    double value(const vec3& direction) const;
+    vec3 generate(const pair<double, double>& u) const;
 
 private:
     ONB uvw;
 };
 
-class hittable_pdf : public PDF
+// Distribution chosen by a scattering material, one of the above
+class PDF
 {
 public:
-    hittable_pdf(shared_ptr<Hittable> object, const point3& hit_point);
+    PDF() = default;
+    PDF(const uniform_sphere_pdf& pdf);
+    PDF(const cosine_hemisphere_pdf& pdf);
 
-    double value(const vec3& direction) const override;
-    vec3 generate() const override;
+    double value(const vec3& direction) const;
+    vec3 generate(const pair<double, double>& u) const;
 
 private:
-    shared_ptr<Hittable> object;
-    point3 hit_point;
+    std::variant<uniform_sphere_pdf, cosine_hemisphere_pdf> pdf;
 };
 
-class hittables_pdf : public PDF 
+class hittable_pdf
 {
 public:
-    hittables_pdf(const vector<shared_ptr<Hittable>>& hittables, const point3& hit_point);
+    hittable_pdf(const Hittable& object, const point3& hit_point);
 
-    double value(const vec3& scattering_direction) const override;
-    vec3 generate() const override;
+    double value(const vec3& direction) const;
+    vec3 generate(const pair<double, double>& u) const;
 
 private:
-    const vector<shared_ptr<Hittable>>& hittables;
+    const Hittable& object;
     point3 hit_point;
 };
 
-class mixture_pdf : public PDF 
+// Even mixture of two distributions, referenced and not copied
+template <typename PDF0, typename PDF1>
+class mixture_pdf
 {
 public:
-    mixture_pdf(shared_ptr<PDF> p0, shared_ptr<PDF> p1);
-
-    double value(const vec3& direction) const override;
-    vec3 generate() const override;
+    mixture_pdf(const PDF0& p0, const PDF1& p1) : p0(p0), p1(p1) {}
+
+    double value(const vec3& direction) const
+    {
+        return 0.5 * p0.value(direction) + 0.5 * p1.value(direction);
+    }
+
+    vec3 generate(const pair<double, double>& u) const
+    {
+        // The first coordinate picks the distribution and is stretched back to [0, 1) for it
+        if (u.first < 0.5)
+            return p0.generate(make_pair(2 * u.first, u.second));
+        else
+            return p1.generate(make_pair(std::min(2 * u.first - 1, Raytracing::one_minus_epsilon), u.second));
+    }
 
 private:
-    shared_ptr<PDF> p[2];
+    const PDF0& p0;
+    const PDF1& p1;
 };
 
+// Multiple importance sampling weight of a sample drawn with pdf_a against another strategy with pdf_b (power heuristic, beta = 2)
+inline double power_heuristic(double pdf_a, double pdf_b)
+{
+    const double a2 = pdf_a * pdf_a;
+    const double b2 = pdf_b * pdf_b;
 
+    return (a2 + b2) > 0 ? a2 / (a2 + b2) : 0;
+}
@@ -7,8 +7,12 @@
 #include "utils/image_writer.hpp"
 #include "scenes.hpp"
 #include "hittables/bvh.hpp"
+#include "hittables/instanced_light.hpp"
 #include "graphics/raytracing_renderer.hpp"
 #include "materials/texture.hpp"
+#include "materials/material.hpp"
+#include "core/arena.hpp"
+#include <unordered_set>
 
 // Usings
 using Raytracing::RendererSettings;
@@ -25,7 +29,21 @@ void Raytracing::Scene::initialize(const RendererSettings& settings)
     this->bounce_max_depth = settings.bounce_max_depth;
     this->min_hit_distance = settings.min_hit_distance;
     this->bvh_optimization = settings.bvh_optimization;
+    this->russian_roulette = settings.russian_roulette;
+    this->parallelize = settings.parallelize;
+    this->huge_pages = settings.huge_pages;
+    this->light_sampling = settings.light_sampling;
+    this->skybox_sampling = settings.skybox_sampling;
     this->samples_per_pixel = settings.samples_per_pixel;
+    this->adaptive_sampling = settings.adaptive_sampling;
+    this->min_samples_per_pixel = settings.min_samples_per_pixel;
+    this->adaptive_threshold = settings.adaptive_threshold;
+    this->progressive = settings.progressive;
+    this->samples_per_pass = settings.samples_per_pass;
+    this->time_budget = settings.time_budget ? settings.time_budget_seconds : 0.0;
+    this->denoise = settings.denoise;
+    this->denoise_iterations = settings.denoise_iterations;
+    this->primitive_ids = settings.save_aovs;
 
     auto bc = settings.background_color;
     auto cp = settings.primary_blend_color;
@@ -65,6 +83,9 @@ void Raytracing::Scene::clear()
 {
     scene_hittables.clear();
     hittables_with_pdf.clear();
+    lights.clear();
+    materials.clear();
+    arena.reset();
     bbox = original_bbox = Raytracing::AABB::empty();
     stats = scene_stats(); // reset stats
 }
@@ -82,6 +103,10 @@ void Raytracing::Scene::build(Raytracing::Camera& camera, Raytracing::ImageWrite
     // Start scene build time chrono
     this->build_chrono.start();
 
+    // Everything created during the build lives in the scene arena
+    arena = make_shared<MemoryArena>(MemoryArena::default_block_size, huge_pages);
+    MemoryArena::Scope arena_scope(arena);
+
     // Choose rendering scene
     switch (7)
     {
@@ -121,21 +146,13 @@ void Raytracing::Scene::build(Raytracing::Camera& camera, Raytracing::ImageWrite
     }
 
     // Create scene hittable from hittables inside scene
-    if (bvh_optimization)
-        scene_hittable = make_shared<bvh_node>(scene_hittables);
-    else
-        scene_hittable = make_shared<hittable_list>(scene_hittables);
-
-    // Set bbox
-    set_bbox();
-
-    // Clear scene hittables (not necessary but frees memory)
-    scene_hittables.clear();
+    build_hierarchy();
 
     // End scene build time chrono
     build_chrono.end();
 
     // Info log
+    Logger::info("SCENE", "Scene arena: " + arena->to_string());
     Logger::info("Main", "Scene build completed.");
 }
 
@@ -147,6 +164,10 @@ void Raytracing::Scene::build(vector<shared_ptr<Raytracing::Mesh>> meshes)
     // Start scene build time chrono
     this->build_chrono.start();
 
+    // Everything created during the build lives in the scene arena
+    arena = make_shared<MemoryArena>(MemoryArena::default_block_size, huge_pages);
+    MemoryArena::Scope arena_scope(arena);
+
     // Add meshes to scene
     for (auto mesh : meshes)
     {
@@ -159,24 +180,223 @@ void Raytracing::Scene::build(vector<shared_ptr<Raytracing::Mesh>> meshes)
     }
 
     // Create scene hittable from hittables inside scene
-    auto scene_hittables_list = hittable_list(scene_hittables);
+    build_hierarchy();
+
+    // End scene build time chrono
+    build_chrono.end();
+
+    // Info log
+    Logger::info("SCENE", "Scene arena: " + arena->to_string());
+    Logger::info("Main", "Scene build completed.");
+}
+
+void Raytracing::Scene::build_hierarchy()
+{
+    // Top level objects of the hierarchy, searched for emissive primitives once it is built
+    vector<shared_ptr<Hittable>> world_objects = scene_hittables;
 
     if (bvh_optimization)
-        scene_hittable = make_shared<bvh_node>(scene_hittables_list);
+    {
+        // Non-instanced hierarchies (meshes, surfaces, untransformed BVHs) are dissolved and their primitives moved
+        // into world space, so a single BVH is built over every leaf primitive of the scene
+        std::unordered_map<const Hittable*, int> references;
+        for (const auto& object : scene_hittables)
+            count_references(object, references);
+
+        vector<shared_ptr<Hittable>> primitives;
+        for (const auto& object : scene_hittables)
+            flatten(object, Matrix44::identity(), references, primitives);
+
+        auto scene_bvh = make_arena_shared<bvh_node>(hittable_list(primitives));
+        world_objects = primitives;
+
+        // The nested BVHs are not traversed anymore, so the hierarchy stats are the ones of the flat BVH.
+        // Per mesh stats are kept in the meshes themselves for the log.
+        auto scene_bvh_stats = scene_bvh->get_stats();
+        stats.bvh_depth = scene_bvh_stats.bvh_depth;
+        stats.bvh_nodes = scene_bvh_stats.bvh_nodes;
+        stats.bvh_chrono += scene_bvh_stats.bvh_chrono;
+
+        scene_hittable = scene_bvh;
+
+        Logger::info("SCENE", "Flattened " + std::to_string(scene_hittables.size()) + " scene objects into a BVH of " + std::to_string(primitives.size()) + " primitives.");
+    }
+    else
+    {
+        scene_hittable = make_arena_shared<hittable_list>(scene_hittables);
+    }
+
+    // Move primitive materials into the scene tables
+    scene_hittable->register_materials(materials);
+
+    // Emissive primitives are sampled as lights, in world space when their aggregates are transformed
+    vector<light_placement> placements;
+    for (const auto& object : world_objects)
+        collect_lights(object, Matrix44::identity(), placements);
+
+    place_lights(placements);
+
+    lights.build(hittables_with_pdf, materials, light_sampling);
+
+    // A lit skybox is one more light. It gets half of the light samples when the scene has lights of its own, as its
+    // power cannot be compared with theirs without knowing how much of the sky reaches the scene.
+    skybox_selection_probability = 0;
+
+    if (skybox_sampling && background_type == BACKGROUND_TYPE::SKYBOX && skybox && skybox->can_be_sampled())
+        skybox_selection_probability = lights.size() > 0 ? 0.5 : 1.0;
+
+    // Primitive numbers of the ID output
+    primitive_numbers.clear();
+
+    if (primitive_ids)
+    {
+        for (const auto& object : world_objects)
+            number_primitives(object);
+    }
+
+    if (light_sampling == LIGHT_SAMPLING::LIGHT_BVH)
+        Logger::info("SCENE", std::to_string(lights.size()) + " lights sampled with next event estimation (light BVH of " + std::to_string(lights.get_node_count()) + " nodes).");
     else
-        scene_hittable = make_shared<hittable_list>(scene_hittables_list);
+        Logger::info("SCENE", std::to_string(lights.size()) + " lights sampled with next event estimation (power alias table).");
+
+    if (skybox_selection_probability > 0)
+        Logger::info("SCENE", "Skybox sampled as an infinite light with next event estimation.");
 
     // Set bbox
     set_bbox();
 
     // Clear scene hittables (not necessary but frees memory)
     scene_hittables.clear();
+}
 
-    // End scene build time chrono
-    build_chrono.end();
+void Raytracing::Scene::count_references(const shared_ptr<Hittable>& object, std::unordered_map<const Hittable*, int>& references) const
+{
+    // The subtree of a shared node is only walked once, the node itself already marks it as instanced
+    if (references[object.get()]++ > 0)
+        return;
 
-    // Info log
-    Logger::info("Main", "Scene build completed.");
+    for (const auto& child : object->get_children())
+        count_references(child, references);
+}
+
+bool Raytracing::Scene::can_flatten(const Hittable& object, const Matrix44& parent_model, const std::unordered_map<const Hittable*, int>& references) const
+{
+    // Instanced geometry keeps its own transform
+    if (references.at(&object) > 1)
+        return false;
+
+    const Matrix44 model = object.compose_model(parent_model);
+    const auto children = object.get_children();
+
+    if (children.empty())
+        return model == Matrix44::identity() || object.can_bake_transform(model);
+
+    // Children of an untransformed aggregate are decided one by one, otherwise the whole subtree has to absorb the model
+    if (model == Matrix44::identity())
+        return true;
+
+    for (const auto& child : children)
+    {
+        if (!can_flatten(*child, model, references))
+            return false;
+    }
+
+    return true;
+}
+
+void Raytracing::Scene::flatten(const shared_ptr<Hittable>& object, const Matrix44& parent_model, const std::unordered_map<const Hittable*, int>& references, vector<shared_ptr<Hittable>>& primitives)
+{
+    // Subtrees that cannot be flattened become a single leaf of the scene BVH. Below a transformed aggregate the
+    // check already covered the whole subtree.
+    if (parent_model == Matrix44::identity() && !can_flatten(*object, parent_model, references))
+    {
+        primitives.push_back(object);
+        return;
+    }
+
+    const Matrix44 model = object->compose_model(parent_model);
+    const auto children = object->get_children();
+
+    if (children.empty())
+    {
+        if (model != Matrix44::identity())
+            object->bake_transform(model);
+
+        primitives.push_back(object);
+        return;
+    }
+
+    for (const auto& child : children)
+        flatten(child, model, references, primitives);
+}
+
+void Raytracing::Scene::collect_lights(const shared_ptr<Hittable>& object, const Matrix44& parent_model, vector<light_placement>& placements) const
+{
+    const auto children = object->get_children();
+
+    // Primitives handle their own transform, only a transformed parent makes them instances
+    if (children.empty())
+    {
+        auto material_id = object->get_material_index();
+
+        if (material_id && materials[material_id.value()]->get_type() == DIFFUSE_LIGHT)
+            placements.push_back({ object, parent_model });
+
+        return;
+    }
+
+    const Matrix44 model = object->compose_model(parent_model);
+
+    for (const auto& child : children)
+        collect_lights(child, model, placements);
+}
+
+void Raytracing::Scene::place_lights(const vector<light_placement>& placements)
+{
+    // A primitive reached through aggregates with different models appears several times in the scene. A hit on it
+    // does not tell which copy was hit, so it cannot be matched with one light and is left to the rays that hit it.
+    std::unordered_map<const Hittable*, const Matrix44*> models;
+    std::unordered_set<const Hittable*> repeated;
+
+    for (const auto& placement : placements)
+    {
+        auto [it, inserted] = models.try_emplace(placement.primitive.get(), &placement.model);
+
+        if (!inserted && *it->second != placement.model)
+            repeated.insert(placement.primitive.get());
+    }
+
+    std::unordered_set<const Hittable*> placed;
+
+    for (const auto& placement : placements)
+    {
+        const Hittable* primitive = placement.primitive.get();
+
+        if (repeated.contains(primitive) || !placed.insert(primitive).second)
+            continue;
+
+        if (placement.model == Matrix44::identity())
+            hittables_with_pdf.push_back(placement.primitive);
+        else
+            hittables_with_pdf.push_back(make_arena_shared<InstancedLight>(placement.primitive, placement.model));
+    }
+
+    if (!repeated.empty())
+        Logger::warn("SCENE", std::to_string(repeated.size()) + " emissive primitives are instanced with different transforms and will not be sampled as lights.");
+}
+
+void Raytracing::Scene::number_primitives(const shared_ptr<Hittable>& object)
+{
+    const auto children = object->get_children();
+
+    if (children.empty())
+    {
+        primitive_numbers.try_emplace(object.get(), int(primitive_numbers.size()));
+        return;
+    }
+
+    for (const auto& child : children)
+        number_primitives(child);
 }
 
 bool Raytracing::Scene::hit(const Ray& r, const Interval& ray_t, hit_record& rec) const
@@ -189,11 +409,24 @@ bool Raytracing::Scene::hit(const Ray& r, const Interval& ray_t, hit_record& rec
     const bool hit = scene_hittable->hit(local_ray, ray_t, rec);
 
     if (hit)
-        transform_hit_record(rec);
+        record_instance(rec);
 
     return hit;
 }
 
+void Raytracing::Scene::resolve_hit(const Ray& r, hit_record& rec) const
+{
+    Hittable::compute_surface_attributes(r, rec);
+    rec.material = materials[rec.material_id];
+}
+
+int Raytracing::Scene::primitive_id(const hit_record& rec) const
+{
+    auto number = primitive_numbers.find(rec.primitive);
+
+    return number != primitive_numbers.end() ? number->second : -1;
+}
+
 void Raytracing::Scene::set_bbox()
 {
     original_bbox = scene_hittable->get_bbox();
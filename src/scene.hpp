@@ -6,6 +6,8 @@
 #include "graphics/color.hpp"
 #include "utils/chrono.hpp"
 #include "utils/scene_stats.hpp"
+#include "hittables/light_sampler.hpp"
+#include <unordered_map>
 
 // Namespace forward declarations
 namespace Raytracing
@@ -15,6 +17,7 @@ namespace Raytracing
     struct RendererSettings;
     class Mesh;
     class SkyboxTexture;
+    class MemoryArena;
 }
 
 enum class BACKGROUND_TYPE
@@ -41,9 +44,22 @@ namespace Raytracing
         bool bvh_optimization = true;                                       // Enables BVH acceleration structure for raytracing
         bool russian_roulette = true;                                       // Enables Russian Roulette for raytracing
         bool parallelize = true;                                     // Enables parallel computation throguh OpenMP for raytracing
+        bool huge_pages = false;                                            // Backs the scene arena with huge pages when the OS allows it
+        LIGHT_SAMPLING light_sampling = LIGHT_SAMPLING::LIGHT_BVH;          // How next event estimation picks the light to sample
+        bool skybox_sampling = true;                                        // Samples the skybox as an infinite light with next event estimation
+        double skybox_selection_probability = 0;                            // Chance of next event estimation choosing the skybox over the scene lights (set when the hierarchy is built)
 
         // Antialiasing and noise settings
-        int samples_per_pixel = 10;                                         // Count of random samples for each pixel
+        int samples_per_pixel = 10;                                         // Count of random samples for each pixel (the maximum with adaptive sampling)
+        bool adaptive_sampling = false;                                     // Stops sampling a pixel once its estimated error is low enough
+        int min_samples_per_pixel = 16;                                     // Samples taken by every pixel before its error is estimated
+        double adaptive_threshold = 0.01;                                   // Target standard error of a pixel, relative to its luminance
+        bool progressive = false;                                           // Renders the whole frame in passes that refine a shared accumulation buffer
+        int samples_per_pass = 1;                                           // Samples added to every pixel by each progressive pass
+        double time_budget = 0;                                             // Seconds of rendering, passes are added until they run out instead of stopping at samples_per_pixel (0 disables it)
+        bool denoise = false;                                               // Filters the render with the edge-aware denoiser before it is saved
+        int denoise_iterations = 5;                                         // A-trous passes of the denoiser, each one doubles the filter radius
+        bool primitive_ids = false;                                         // Numbers the leaf primitives for the primitive ID output
 
         // Background
         BACKGROUND_TYPE background_type = BACKGROUND_TYPE::STATIC_COLOR;    // Enables a background sky gradient
@@ -59,6 +75,18 @@ namespace Raytracing
         vector<shared_ptr<Hittable>> scene_hittables;
         vector<shared_ptr<Hittable>> hittables_with_pdf;
 
+        // Lights sampled by next event estimation (the hittables with pdf plus every emissive primitive)
+        LightSampler lights;
+
+        // Material and texture tables (primitives store indices into them)
+        MaterialTable materials;
+
+        // Number of every leaf primitive in the order of the hierarchy, filled only when primitive_ids is set
+        std::unordered_map<const Hittable*, int> primitive_numbers;
+
+        // Memory of the objects and BVH nodes created while building the scene
+        shared_ptr<MemoryArena> arena;
+
         // Stats
         scene_stats stats;
 
@@ -86,8 +114,27 @@ namespace Raytracing
         void build(vector<shared_ptr<Mesh>> meshes); // WebGPU scene
 
         bool hit(const Ray& r, const Interval& ray_t, hit_record& rec) const override;
+        void resolve_hit(const Ray& r, hit_record& rec) const; // Evaluates the surface attributes and material of the closest hit
+        int primitive_id(const hit_record& rec) const;         // Number of the primitive hit, -1 when primitives are not numbered
 
         void set_bbox();
+
+    private:
+        // Scene hierarchy
+        void build_hierarchy();
+        void count_references(const shared_ptr<Hittable>& object, std::unordered_map<const Hittable*, int>& references) const;
+        bool can_flatten(const Hittable& object, const Matrix44& parent_model, const std::unordered_map<const Hittable*, int>& references) const;
+        void flatten(const shared_ptr<Hittable>& object, const Matrix44& parent_model, const std::unordered_map<const Hittable*, int>& references, vector<shared_ptr<Hittable>>& primitives);
+        // Emissive primitive and the model of the aggregates above it
+        struct light_placement
+        {
+            shared_ptr<Hittable> primitive;
+            Matrix44 model;
+        };
+
+        void collect_lights(const shared_ptr<Hittable>& object, const Matrix44& parent_model, vector<light_placement>& placements) const;
+        void place_lights(const vector<light_placement>& placements);   // Lights of the placed primitives, wrapped in an InstancedLight below transformed aggregates
+        void number_primitives(const shared_ptr<Hittable>& object);     // Instanced primitives keep the number of their first occurrence
     };
 }
 
@@ -9,6 +9,7 @@
 #include "materials/material.hpp"
 #include "materials/texture.hpp"
 #include "hittables/sphere.hpp"
+#include "hittables/sphere_cloud.hpp"
 #include "hittables/triangle.hpp"
 #include "hittables/quad.hpp"
 #include "hittables/box.hpp"
@@ -21,6 +22,7 @@
 #include "utils/obj_loader.hpp"
 #include "utils/chrono.hpp"
 #include "math/transform.hpp"
+#include "core/arena.hpp"
 
 // Usings
 using Raytracing::Scene;
@@ -37,21 +39,24 @@ using Raytracing::axis;
 void Raytracing::book1_final_scene_creation(Scene& scene, bool blur_motion)
 {
     // Materials
-    auto material_ground = make_shared<Lambertian>(color(0.5, 0.5, 0.5));
-    auto material_center = make_shared<Lambertian>(color(0.5, 0.5, 0.5));
-    auto material_left = make_shared<Dielectric>(1.50);
-    auto material_bubble = make_shared<Dielectric>(1.00 / 1.50);
-    auto material_right = make_shared<Metal>(color(0.8, 0.6, 0.2), 1.0);
-    auto material1 = make_shared<Dielectric>(1.5);
-    auto material2 = make_shared<Lambertian>(color(0.4, 0.2, 0.1));
-    auto material3 = make_shared<Metal>(color(0.7, 0.6, 0.5), 0.0);
+    auto material_ground = make_arena_shared<Lambertian>(color(0.5, 0.5, 0.5));
+    auto material_center = make_arena_shared<Lambertian>(color(0.5, 0.5, 0.5));
+    auto material_left = make_arena_shared<Dielectric>(1.50);
+    auto material_bubble = make_arena_shared<Dielectric>(1.00 / 1.50);
+    auto material_right = make_arena_shared<Metal>(color(0.8, 0.6, 0.2), 1.0);
+    auto material1 = make_arena_shared<Dielectric>(1.5);
+    auto material2 = make_arena_shared<Lambertian>(color(0.4, 0.2, 0.1));
+    auto material3 = make_arena_shared<Metal>(color(0.7, 0.6, 0.5), 0.0);
 
     // Triangles (define them in counter-clockwise order)
     vertex A, B, C;
     A = vertex({ point3(0.2, -0.2, -0.5), nullopt, YELLOW });
     B = vertex({ point3(0.8, -0.2, -0.5), nullopt, CYAN });
     C = vertex({ point3(0.2, 0, -0.5), nullopt, MAGENTA });
-    auto triangle1 = make_shared<Triangle>(A, B, C, material_left);
+    auto triangle1 = make_arena_shared<Triangle>(A, B, C, material_left);
+
+    // Small random spheres are packed into a single cloud
+    auto small_spheres = make_arena_shared<SphereCloud>();
 
     // Random sphere creation loop
     for (int a = -11; a < 11; a++)
@@ -69,16 +74,16 @@ void Raytracing::book1_final_scene_creation(Scene& scene, bool blur_motion)
                 if (choose_mat < 0.8)
                 {
                     auto albedo = color::random() * color::random();
-                    sphere_material = make_shared<Lambertian>(albedo);
+                    sphere_material = make_arena_shared<Lambertian>(albedo);
 
                     if (blur_motion)
                     {
                         auto center2 = center + vec3(0, random_number<double>(0, .5), 0);
-                        scene.add(make_shared<Sphere>(center, center2, 0.2, sphere_material));
+                        small_spheres->add(center, center2, 0.2, sphere_material);
                     }
                     else
                     {
-                        scene.add(make_shared<Sphere>(center, 0.2, sphere_material));
+                        small_spheres->add(center, 0.2, sphere_material);
                     }
                 }
                 // Metal
@@ -86,30 +91,33 @@ void Raytracing::book1_final_scene_creation(Scene& scene, bool blur_motion)
                 {
                     auto albedo = color::random(0.5, 1);
                     auto fuzz = random_number<double>(0, 0.5);
-                    sphere_material = make_shared<Metal>(albedo, fuzz);
-                    scene.add(make_shared<Sphere>(center, 0.2, sphere_material));
+                    sphere_material = make_arena_shared<Metal>(albedo, fuzz);
+                    small_spheres->add(center, 0.2, sphere_material);
                 }
                 // Glass
                 else
                 {
-                    sphere_material = make_shared<Dielectric>(1.5);
-                    scene.add(make_shared<Sphere>(center, 0.2, sphere_material));
+                    sphere_material = make_arena_shared<Dielectric>(1.5);
+                    small_spheres->add(center, 0.2, sphere_material);
                 }
             }
         }
     }
 
+    small_spheres->build();
+
     // Spheres
-    auto sphere1 = make_shared<Sphere>(point3(0, 1, 0), 1.0, material1);
-    auto sphere2 = make_shared<Sphere>(point3(-4, 1, 0), 1.0, material2);
-    auto sphere3 = make_shared<Sphere>(point3(4, 1, 0), 1.0, material3);
-    auto sphere4 = make_shared<Sphere>(point3(0, -1000, 0), 1000, material_ground);
+    auto sphere1 = make_arena_shared<Sphere>(point3(0, 1, 0), 1.0, material1);
+    auto sphere2 = make_arena_shared<Sphere>(point3(-4, 1, 0), 1.0, material2);
+    auto sphere3 = make_arena_shared<Sphere>(point3(4, 1, 0), 1.0, material3);
+    auto sphere4 = make_arena_shared<Sphere>(point3(0, -1000, 0), 1000, material_ground);
 
     // Add primitives to the scene
     scene.add(sphere1);
     scene.add(sphere2);
     scene.add(sphere3);
     scene.add(sphere4);
+    scene.add(small_spheres);
     // scene1.add(triangle1);
 }
 
@@ -160,11 +168,11 @@ void Raytracing::checkered_spheres(Scene& scene, Camera& camera, ImageWriter& im
     scene.samples_per_pixel = 100;
 
     // Materials
-    auto checker = make_shared<CheckerTexture>(0.32, color(.2, .3, .1), color(.9, .9, .9));
+    auto checker = make_arena_shared<CheckerTexture>(0.32, color(.2, .3, .1), color(.9, .9, .9));
 
     // Spheres
-    auto sphere1 = make_shared<Sphere>(point3(0, -10, 0), 10, make_shared<Lambertian>(checker));
-    auto sphere2 = make_shared<Sphere>(point3(0, 10, 0), 10, make_shared<Lambertian>(checker));
+    auto sphere1 = make_arena_shared<Sphere>(point3(0, -10, 0), 10, make_arena_shared<Lambertian>(checker));
+    auto sphere2 = make_arena_shared<Sphere>(point3(0, 10, 0), 10, make_arena_shared<Lambertian>(checker));
 
     // Add primitives
     scene.add(sphere1);
@@ -184,13 +192,13 @@ void Raytracing::earth(Scene& scene, Camera& camera, ImageWriter& image)
     scene.samples_per_pixel = 100;
 
     // Textures
-    auto earth_texture = make_shared<ImageTexture>("earthmap.jpg");
+    auto earth_texture = make_arena_shared<ImageTexture>("earthmap.jpg");
 
     // Materials
-    auto earth_surface = make_shared<Lambertian>(earth_texture);
+    auto earth_surface = make_arena_shared<Lambertian>(earth_texture);
 
     // Spheres
-    auto globe = make_shared<Sphere>(point3(0, 0, 0), 2, earth_surface);
+    auto globe = make_arena_shared<Sphere>(point3(0, 0, 0), 2, earth_surface);
 
     // Add primitives
     scene.add(globe);
@@ -209,14 +217,14 @@ void Raytracing::perlin_spheres(Scene& scene, Camera& camera, ImageWriter& image
     scene.samples_per_pixel = 100;
 
     // Textures
-    auto perlin_texture = make_shared<NoiseTexture>(4, 7);
+    auto perlin_texture = make_arena_shared<NoiseTexture>(4, 7);
 
     // Materials
-    auto perlin_material = make_shared<Lambertian>(perlin_texture);
+    auto perlin_material = make_arena_shared<Lambertian>(perlin_texture);
 
     // Spheres
-    auto sphere1 = make_shared<Sphere>(point3(0, -1000, 0), 1000, perlin_material);
-    auto sphere2 = make_shared<Sphere>(point3(0, 2, 0), 2, perlin_material);
+    auto sphere1 = make_arena_shared<Sphere>(point3(0, -1000, 0), 1000, perlin_material);
+    auto sphere2 = make_arena_shared<Sphere>(point3(0, 2, 0), 2, perlin_material);
 
     // Add primitives
     scene.add(sphere1);
@@ -236,18 +244,18 @@ void Raytracing::quads_scene(Scene& scene, Camera& camera, ImageWriter& image)
     scene.samples_per_pixel = 100;
 
     // Materials
-    auto left_red = make_shared<Lambertian>(color(1.0, 0.2, 0.2));
-    auto back_green = make_shared<Lambertian>(color(0.2, 1.0, 0.2));
-    auto right_blue = make_shared<Lambertian>(color(0.2, 0.2, 1.0));
-    auto upper_orange = make_shared<Lambertian>(color(1.0, 0.5, 0.0));
-    auto lower_teal = make_shared<Lambertian>(color(0.2, 0.8, 0.8));
+    auto left_red = make_arena_shared<Lambertian>(color(1.0, 0.2, 0.2));
+    auto back_green = make_arena_shared<Lambertian>(color(0.2, 1.0, 0.2));
+    auto right_blue = make_arena_shared<Lambertian>(color(0.2, 0.2, 1.0));
+    auto upper_orange = make_arena_shared<Lambertian>(color(1.0, 0.5, 0.0));
+    auto lower_teal = make_arena_shared<Lambertian>(color(0.2, 0.8, 0.8));
 
     // Quads
-    auto quad1 = make_shared<Quad>(point3(-3, -2, 5), vec3(0, 0, -4), vec3(0, 4, 0), left_red);
-    auto quad2 = make_shared<Quad>(point3(-2, -2, 0), vec3(4, 0, 0), vec3(0, 4, 0), back_green);
-    auto quad3 = make_shared<Quad>(point3(3, -2, 1), vec3(0, 0, 4), vec3(0, 4, 0), right_blue);
-    auto quad4 = make_shared<Quad>(point3(-2, 3, 1), vec3(4, 0, 0), vec3(0, 0, 4), upper_orange);
-    auto quad5 = make_shared<Quad>(point3(-2, -3, 5), vec3(4, 0, 0), vec3(0, 0, -4), lower_teal);
+    auto quad1 = make_arena_shared<Quad>(point3(-3, -2, 5), vec3(0, 0, -4), vec3(0, 4, 0), left_red);
+    auto quad2 = make_arena_shared<Quad>(point3(-2, -2, 0), vec3(4, 0, 0), vec3(0, 4, 0), back_green);
+    auto quad3 = make_arena_shared<Quad>(point3(3, -2, 1), vec3(0, 0, 4), vec3(0, 4, 0), right_blue);
+    auto quad4 = make_arena_shared<Quad>(point3(-2, 3, 1), vec3(4, 0, 0), vec3(0, 0, 4), upper_orange);
+    auto quad5 = make_arena_shared<Quad>(point3(-2, -3, 5), vec3(4, 0, 0), vec3(0, 0, -4), lower_teal);
 
     // Add primitives
     scene.add(quad1);
@@ -271,19 +279,19 @@ void Raytracing::simple_light(Scene& scene, Camera& camera, ImageWriter& image)
     scene.samples_per_pixel = 100;
 
     // Textures
-    auto perlin_texture = make_shared<NoiseTexture>(4, 7);
+    auto perlin_texture = make_arena_shared<NoiseTexture>(4, 7);
 
     // Materials
-    auto perlin_material = make_shared<Lambertian>(perlin_texture);
-    auto diffuse_light_material = make_shared<DiffuseLight>(color(4, 4, 4));
+    auto perlin_material = make_arena_shared<Lambertian>(perlin_texture);
+    auto diffuse_light_material = make_arena_shared<DiffuseLight>(color(4, 4, 4));
 
     // Spheres
-    auto sphere1 = make_shared<Sphere>(point3(0, -1000, 0), 1000, perlin_material);
-    auto sphere2 = make_shared<Sphere>(point3(0, 2, 0), 2, perlin_material);
-    auto sphere3 = make_shared<Sphere>(point3(0, 7, 0), 2, diffuse_light_material);
+    auto sphere1 = make_arena_shared<Sphere>(point3(0, -1000, 0), 1000, perlin_material);
+    auto sphere2 = make_arena_shared<Sphere>(point3(0, 2, 0), 2, perlin_material);
+    auto sphere3 = make_arena_shared<Sphere>(point3(0, 7, 0), 2, diffuse_light_material);
 
     // Quads
-    auto quad1 = make_shared<Quad>(point3(3, 1, -2), vec3(2, 0, 0), vec3(0, 2, 0), diffuse_light_material);
+    auto quad1 = make_arena_shared<Quad>(point3(3, 1, -2), vec3(2, 0, 0), vec3(0, 2, 0), diffuse_light_material);
 
     // Add primitives
     scene.add(sphere1);
@@ -306,24 +314,24 @@ void Raytracing::cornell_box(Scene& scene, Camera& camera, ImageWriter& image)
     scene.samples_per_pixel = 50;
 
     // Materials
-    auto red = make_shared<Lambertian>(color(.65, .05, .05));
-    auto white = make_shared<Lambertian>(color(.73, .73, .73));
-    auto green = make_shared<Lambertian>(color(.12, .45, .15));
-    auto light = make_shared<DiffuseLight>(color(15, 15, 15));
-    auto aluminum = make_shared<Metal>(color(0.8, 0.85, 0.88), 0.0);
-    auto glass = make_shared<Dielectric>(1.5);
+    auto red = make_arena_shared<Lambertian>(color(.65, .05, .05));
+    auto white = make_arena_shared<Lambertian>(color(.73, .73, .73));
+    auto green = make_arena_shared<Lambertian>(color(.12, .45, .15));
+    auto light = make_arena_shared<DiffuseLight>(color(15, 15, 15));
+    auto aluminum = make_arena_shared<Metal>(color(0.8, 0.85, 0.88), 0.0);
+    auto glass = make_arena_shared<Dielectric>(1.5);
 
     // Quads
-    auto quad1 = make_shared<Quad>(point3(555, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), green);
-    auto quad2 = make_shared<Quad>(point3(0, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), red);
-    auto quad3 = make_shared<Quad>(point3(343, 554, 332), vec3(-130, 0, 0), vec3(0, 0, -105), light);
-    auto quad4 = make_shared<Quad>(point3(0, 0, 0), vec3(555, 0, 0), vec3(0, 0, 555), white);
-    auto quad5 = make_shared<Quad>(point3(555, 555, 555), vec3(-555, 0, 0), vec3(0, 0, -555), white);
-    auto quad6 = make_shared<Quad>(point3(0, 0, 555), vec3(555, 0, 0), vec3(0, 555, 0), white);
+    auto quad1 = make_arena_shared<Quad>(point3(555, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), green);
+    auto quad2 = make_arena_shared<Quad>(point3(0, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), red);
+    auto quad3 = make_arena_shared<Quad>(point3(343, 554, 332), vec3(-130, 0, 0), vec3(0, 0, -105), light);
+    auto quad4 = make_arena_shared<Quad>(point3(0, 0, 0), vec3(555, 0, 0), vec3(0, 0, 555), white);
+    auto quad5 = make_arena_shared<Quad>(point3(555, 555, 555), vec3(-555, 0, 0), vec3(0, 0, -555), white);
+    auto quad6 = make_arena_shared<Quad>(point3(0, 0, 555), vec3(555, 0, 0), vec3(0, 555, 0), white);
 
     // Boxes
-    auto box1 = make_shared<Box>(point3(0, 0, 0), point3(165, 330, 165), white);
-    auto box2 = make_shared<Box>(point3(0, 0, 0), point3(165, 165, 165), white);
+    auto box1 = make_arena_shared<Box>(point3(0, 0, 0), point3(165, 330, 165), white);
+    auto box2 = make_arena_shared<Box>(point3(0, 0, 0), point3(165, 165, 165), white);
 
     // Transformations
     box1->translate(vec3(265, 0, 295));
@@ -332,7 +340,7 @@ void Raytracing::cornell_box(Scene& scene, Camera& camera, ImageWriter& image)
     box2->rotate(y_axis, -18.0);
 
     // Glass Sphere
-    auto sphere1 = make_shared<Sphere>(point3(190, 90, 190), 90, glass);
+    auto sphere1 = make_arena_shared<Sphere>(point3(190, 90, 190), 90, glass);
 
     // Mesh
     auto mesh = load_obj("cube\\cube.obj");
@@ -363,21 +371,21 @@ void Raytracing::cornell_smoke(Scene& scene, Camera& camera, ImageWriter& image)
     scene.bounce_max_depth = 50;
     scene.samples_per_pixel = 200;
 
-    auto red = make_shared<Lambertian>(color(.65, .05, .05));
-    auto white = make_shared<Lambertian>(color(.73, .73, .73));
-    auto green = make_shared<Lambertian>(color(.12, .45, .15));
-    auto light = make_shared<DiffuseLight>(color(7, 7, 7));
+    auto red = make_arena_shared<Lambertian>(color(.65, .05, .05));
+    auto white = make_arena_shared<Lambertian>(color(.73, .73, .73));
+    auto green = make_arena_shared<Lambertian>(color(.12, .45, .15));
+    auto light = make_arena_shared<DiffuseLight>(color(7, 7, 7));
 
-    auto quad1 = make_shared<Quad>(point3(555, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), green);
-    auto quad2 = make_shared<Quad>(point3(0, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), red);
-    auto quad3 = make_shared<Quad>(point3(113, 554, 127), vec3(330, 0, 0), vec3(0, 0, 305), light);
-    auto quad4 = make_shared<Quad>(point3(0, 555, 0), vec3(555, 0, 0), vec3(0, 0, 555), white);
-    auto quad5 = make_shared<Quad>(point3(0, 0, 0), vec3(555, 0, 0), vec3(0, 0, 555), white);
-    auto quad6 = make_shared<Quad>(point3(0, 0, 555), vec3(555, 0, 0), vec3(0, 555, 0), white);
+    auto quad1 = make_arena_shared<Quad>(point3(555, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), green);
+    auto quad2 = make_arena_shared<Quad>(point3(0, 0, 0), vec3(0, 555, 0), vec3(0, 0, 555), red);
+    auto quad3 = make_arena_shared<Quad>(point3(113, 554, 127), vec3(330, 0, 0), vec3(0, 0, 305), light);
+    auto quad4 = make_arena_shared<Quad>(point3(0, 555, 0), vec3(555, 0, 0), vec3(0, 0, 555), white);
+    auto quad5 = make_arena_shared<Quad>(point3(0, 0, 0), vec3(555, 0, 0), vec3(0, 0, 555), white);
+    auto quad6 = make_arena_shared<Quad>(point3(0, 0, 555), vec3(555, 0, 0), vec3(0, 555, 0), white);
 
     // Boxes
-    shared_ptr<Hittable> box1 = make_shared<Box>(point3(0, 0, 0), point3(165, 330, 165), white);
-    shared_ptr<Hittable> box2 = make_shared<Box>(point3(0, 0, 0), point3(165, 165, 165), white);
+    shared_ptr<Hittable> box1 = make_arena_shared<Box>(point3(0, 0, 0), point3(165, 330, 165), white);
+    shared_ptr<Hittable> box2 = make_arena_shared<Box>(point3(0, 0, 0), point3(165, 165, 165), white);
 
     // Transformations
     box1->translate(vec3(265, 0, 295));
@@ -386,8 +394,8 @@ void Raytracing::cornell_smoke(Scene& scene, Camera& camera, ImageWriter& image)
     box2->rotate(y_axis, -18.0);
 
     // Constant medium
-    box1 = make_shared<constant_medium>(box1, 0.01, color(0, 0, 0));
-    box2 = make_shared<constant_medium>(box2, 0.01, color(1, 1, 1));
+    box1 = make_arena_shared<constant_medium>(box1, 0.01, color(0, 0, 0));
+    box2 = make_arena_shared<constant_medium>(box2, 0.01, color(1, 1, 1));
 
     // Add primitives
     scene.add(quad1);
@@ -416,18 +424,18 @@ void Raytracing::book2_final_scene(Scene& scene, Camera& camera, ImageWriter& im
     int number_of_spheres = 1000;
 
     // Textures
-    auto earth_texture = make_shared<ImageTexture>("earthmap.jpg");
-    auto perlin_texture = make_shared<NoiseTexture>(0.2, 7);
+    auto earth_texture = make_arena_shared<ImageTexture>("earthmap.jpg");
+    auto perlin_texture = make_arena_shared<NoiseTexture>(0.2, 7);
 
     // Materials
-    auto ground = make_shared<Lambertian>(color(0.48, 0.83, 0.53));
-    auto light = make_shared<DiffuseLight>(color(7, 7, 7));
-    auto sphere_material = make_shared<Lambertian>(color(0.7, 0.3, 0.1));
-    auto dielectric_material = make_shared<Dielectric>(1.5);
-    auto metal_material = make_shared<Metal>(color(0.8, 0.8, 0.9), 1.0);
-    auto white_material = make_shared<Lambertian>(color(.73, .73, .73));
-    auto perlin_material = make_shared<Lambertian>(perlin_texture);
-    auto earth_surface = make_shared<Lambertian>(earth_texture);
+    auto ground = make_arena_shared<Lambertian>(color(0.48, 0.83, 0.53));
+    auto light = make_arena_shared<DiffuseLight>(color(7, 7, 7));
+    auto sphere_material = make_arena_shared<Lambertian>(color(0.7, 0.3, 0.1));
+    auto dielectric_material = make_arena_shared<Dielectric>(1.5);
+    auto metal_material = make_arena_shared<Metal>(color(0.8, 0.8, 0.9), 1.0);
+    auto white_material = make_arena_shared<Lambertian>(color(.73, .73, .73));
+    auto perlin_material = make_arena_shared<Lambertian>(perlin_texture);
+    auto earth_surface = make_arena_shared<Lambertian>(earth_texture);
 
     // Create ground boxes
     hittable_list boxes;
@@ -444,48 +452,44 @@ void Raytracing::book2_final_scene(Scene& scene, Camera& camera, ImageWriter& im
             auto y1 = random_number<double>(1, 101);
             auto z1 = z0 + w;
 
-            auto box = make_shared<Box>(point3(x0, y0, z0), point3(x1, y1, z1), ground);
+            auto box = make_arena_shared<Box>(point3(x0, y0, z0), point3(x1, y1, z1), ground);
 
             boxes.add(box);
         }
     }
 
-    auto box_bvh_tree = make_shared<bvh_node>(boxes);
+    auto box_bvh_tree = make_arena_shared<bvh_node>(boxes);
 
     // Light source
-    auto quad1 = make_shared<Quad>(point3(123, 554, 147), vec3(300, 0, 0), vec3(0, 0, 265), light);
+    auto quad1 = make_arena_shared<Quad>(point3(123, 554, 147), vec3(300, 0, 0), vec3(0, 0, 265), light);
 
     // Material spheres
     auto center1 = point3(400, 400, 200);
     auto center2 = center1 + vec3(30, 0, 0);
-    auto sphere1 = make_shared<Sphere>(center1, center2, 50, sphere_material);
-    auto sphere2 = make_shared<Sphere>(point3(260, 150, 45), 50, dielectric_material);
-    auto sphere3 = make_shared<Sphere>(point3(0, 150, 145), 50, metal_material);
+    auto sphere1 = make_arena_shared<Sphere>(center1, center2, 50, sphere_material);
+    auto sphere2 = make_arena_shared<Sphere>(point3(260, 150, 45), 50, dielectric_material);
+    auto sphere3 = make_arena_shared<Sphere>(point3(0, 150, 145), 50, metal_material);
 
     // Texture spheres
-    auto sphere4 = make_shared<Sphere>(point3(400, 200, 400), 100, earth_surface);
+    auto sphere4 = make_arena_shared<Sphere>(point3(400, 200, 400), 100, earth_surface);
 
     // Perlin noise spheres
-    auto sphere5 = make_shared<Sphere>(point3(220, 280, 300), 80, perlin_material);
+    auto sphere5 = make_arena_shared<Sphere>(point3(220, 280, 300), 80, perlin_material);
 
     // Constant medium spheres
-    auto boundary1 = make_shared<Sphere>(point3(360, 150, 145), 70, dielectric_material);
-    auto sphere6 = make_shared<constant_medium>(boundary1, 0.2, color(0.2, 0.4, 0.9));
-    auto boundary2 = make_shared<Sphere>(point3(0, 0, 0), 5000, dielectric_material);
-    auto sphere7 = make_shared<constant_medium>(boundary2, 0.0001, color(1, 1, 1));
+    auto boundary1 = make_arena_shared<Sphere>(point3(360, 150, 145), 70, dielectric_material);
+    auto sphere6 = make_arena_shared<constant_medium>(boundary1, 0.2, color(0.2, 0.4, 0.9));
+    auto boundary2 = make_arena_shared<Sphere>(point3(0, 0, 0), 5000, dielectric_material);
+    auto sphere7 = make_arena_shared<constant_medium>(boundary2, 0.0001, color(1, 1, 1));
 
     // Transformed spheres
-    hittable_list spheres;
-    shared_ptr<bvh_node> spheres_bvh_tree;
+    auto spheres = make_arena_shared<SphereCloud>();
     for (int j = 0; j < number_of_spheres; j++)
-    {
-        auto sphere = make_shared<Sphere>(point3::random(0, 165), 10, white_material);
-        spheres.add(sphere);
-    }
+        spheres->add(point3::random(0, 165), 10, white_material);
 
-    spheres_bvh_tree = make_shared<bvh_node>(spheres);
-    spheres_bvh_tree->translate(vec3(-100, 270, 395));
-    spheres_bvh_tree->rotate(y_axis, 15);
+    spheres->build();
+    spheres->translate(vec3(-100, 270, 395));
+    spheres->rotate(y_axis, 15);
 
     // Add objects to the scene
     scene.add(box_bvh_tree);
@@ -498,7 +502,7 @@ void Raytracing::book2_final_scene(Scene& scene, Camera& camera, ImageWriter& im
     scene.add(sphere6);
     scene.add(sphere7);
     scene.add(boundary1);
-    scene.add(spheres_bvh_tree);
+    scene.add(spheres);
 }
 
 void Raytracing::obj_test(Scene& scene, Camera& camera, ImageWriter& image)
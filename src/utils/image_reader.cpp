@@ -3,14 +3,13 @@
 #include "image_reader.hpp"
 #include "utils/utilities.hpp"
 #include "graphics/color.hpp"
+#include "core/simd.hpp"
 
 // External Headers
 #include "stb_image.h"
 
 Raytracing::ImageReader::ImageReader(const char* image_filename)
 {
-    // Define image specs
-    image_type = ImageType::LOADED;
     auto filename = string(image_filename);
 
     // Hunt for the image file in some likely locations.
@@ -22,153 +21,365 @@ Raytracing::ImageReader::ImageReader(const char* image_filename)
     }
     if (load(filename)) return;
 
+    allocate(0, 0, TexelFormat::RGBA8);
+
     Logger::error("ImageReader", "Could not load image file: " + string(image_filename));
 }
 
 Raytracing::ImageReader::ImageReader(const sTextureData& tex_data)
 {
-    // Set image specs
-    is_linear = true; // All textures from framework are linear (assumption)
-    image_type = ImageType::PARSED;
+    // Set image specs (all textures from framework are linear, assumption)
     image_width = tex_data.image_width;
     image_height = tex_data.image_height;
     channels = tex_data.channels;
-    bytes_per_pixel = tex_data.bytes_per_pixel;
-    bytes_per_scanline = image_width * bytes_per_pixel;
-    bit_depth = (bytes_per_pixel / channels) * 8;
+    bit_depth = (tex_data.bytes_per_pixel / channels) * 8;
 
     // Get image data type
     data_type = get_data_type(bit_depth);
 
-    // Set proper pointer to point to texture data
+    // Copy the texture data into the texel layout, the framework keeps its own
     switch (data_type)
     {
     case ImageDataType::UINT8_T:
-        external_uint8_data = tex_data.data.data();
+        allocate(image_width, image_height, TexelFormat::RGBA8);
+        store_pixels(tex_data.data.data(), channels, 1.0f / 255.0f);
         break;
     case ImageDataType::UINT16_T:
-        external_uint16_data = reinterpret_cast<const uint16_t*>(tex_data.data.data());
+        allocate(image_width, image_height, TexelFormat::RGBA16F);
+        store_pixels(reinterpret_cast<const uint16_t*>(tex_data.data.data()), channels, 1.0f / 65535.0f);
         break;
     case ImageDataType::FLOAT:
-        external_float_data = reinterpret_cast<const float*>(tex_data.data.data());
+        allocate(image_width, image_height, TexelFormat::RGBA16F);
+        store_pixels(reinterpret_cast<const float*>(tex_data.data.data()), channels, 1.0f);
         break;
     }
 }
 
-Raytracing::ImageReader::~ImageReader()
+Raytracing::ImageReader::ImageReader(int width, int height, TexelFormat format)
 {
-    // No need to check for nullptr, since deleting nullptr is safe
-    delete[] owned_uint8_data;
-    delete[] owned_uint16_data;
-    stbi_image_free(owned_float_data);
-
+    image_width = width;
+    image_height = height;
+    allocate(width, height, format);
 }
 
 bool Raytracing::ImageReader::load(const string& filename)
 {
-    // Load image data (directly loads data in linear (gamma = 1))
-    float* float_ptr = stbi_loadf(filename.c_str(), &image_width, &image_height, &channels, 4);
+    // The header tells the bit depth, so the pixels are decoded straight to it, always expanded to four channels
+    ImageDataType file_data_type = get_data_type(filename);
+    int file_channels = 0;
+    void* pixels = nullptr;
+
+    switch (file_data_type)
+    {
+    case ImageDataType::UINT8_T:
+        pixels = stbi_load(filename.c_str(), &image_width, &image_height, &file_channels, 4);
+        break;
+    case ImageDataType::UINT16_T:
+        pixels = stbi_load_16(filename.c_str(), &image_width, &image_height, &file_channels, 4);
+        break;
+    case ImageDataType::FLOAT:
+        pixels = stbi_loadf(filename.c_str(), &image_width, &image_height, &file_channels, 4);
+        break;
+    }
 
     // Check
-    if (float_ptr == nullptr)
+    if (pixels == nullptr)
         return false;
 
     // Get image specs
-    data_type = get_data_type(filename);
+    channels = file_channels;
+    data_type = file_data_type;
 
+    // LDR files are gamma encoded, their colors go through a table to linear (gamma = 1) like stbi_loadf does
     switch (data_type)
     {
     case ImageDataType::UINT8_T:
-        owned_uint8_data = convert_float_to_uint8(float_ptr, image_width * image_height * channels);
-        bytes_per_pixel = sizeof(uint8_t) * channels;
         bit_depth = 8;
-        stbi_image_free(float_ptr);
+        allocate(image_width, image_height, TexelFormat::RGBA8);
+        store_pixels(static_cast<const uint8_t*>(pixels), 4, 1.0f / 255.0f, linear_table(bit_depth).data());
         break;
     case ImageDataType::UINT16_T:
-        owned_uint16_data = convert_float_to_uint16(float_ptr, image_width * image_height * channels);
-        bytes_per_pixel = sizeof(uint16_t) * channels;
         bit_depth = 16;
-        stbi_image_free(float_ptr);
+        allocate(image_width, image_height, TexelFormat::RGBA16F);
+        store_pixels(static_cast<const uint16_t*>(pixels), 4, 1.0f / 65535.0f, linear_table(bit_depth).data());
         break;
     case ImageDataType::FLOAT:
-        bytes_per_pixel = sizeof(float) * channels;
         bit_depth = 32;
-        owned_float_data = float_ptr;
+        allocate(image_width, image_height, TexelFormat::RGBA16F);
+        store_pixels(static_cast<const float*>(pixels), 4, 1.0f);
         break;
     }
 
-    is_linear = true; // stbi_loadf returns linearized data (assumption)
-    bytes_per_scanline = image_width * bytes_per_pixel;
+    stbi_image_free(pixels);
 
     return true;
 }
 
 const Raytracing::color Raytracing::ImageReader::pixel_data(int x, int y) const
 {
-    if (image_width == 0 && image_height == 0)
-        return MAGENTA;
+    // Repeat by mask, then clamp to the edge (an empty image clamps to its magenta texel)
+    x = std::clamp(x & x_mask, 0, std::max(image_width - 1, 0));
+    y = std::clamp(y & y_mask, 0, std::max(image_height - 1, 0));
+
+    const size_t index = texel_index(x, y);
 
-    if (!is_within(x, 0, image_width, BoundType::inclusive, BoundType::exclusive) ||
-        !is_within(y, 0, image_height, BoundType::inclusive, BoundType::exclusive))
+    // The format is fixed for the whole image, so this branch always goes the same way
+    if (texel_format == TexelFormat::RGBA8)
     {
-        Logger::error("IMAGE_READER", std::format("Pixel coordinates ({}, {}) out of bounds", x, y));
-        return MAGENTA;
+        const uint32_t texel = rgba8_texels[index];
+        constexpr float scale = 1.0f / 255.0f;
+
+        return color((texel & 0xff) * scale, ((texel >> 8) & 0xff) * scale, ((texel >> 16) & 0xff) * scale);
     }
 
-    color pixel_color = MAGENTA;
-    int index = (y * image_width + x) * channels;
+    float rgba[4];
+    decode_half4(rgba16f_texels[index], rgba);
 
-    switch (data_type)
+    return color(rgba[0], rgba[1], rgba[2]);
+}
+
+void Raytracing::ImageReader::set_address_modes(WGPUAddressMode u_mode, WGPUAddressMode v_mode)
+{
+    u_address_mode = u_mode;
+    v_address_mode = v_mode;
+
+    // Sides that are not a power of two (or mirror) clamp here, the texture coordinates were already wrapped
+    auto address_mask = [](WGPUAddressMode mode, int size)
     {
-    case ImageDataType::UINT8_T:
+        return mode == WGPUAddressMode_Repeat && size > 0 && std::has_single_bit(unsigned(size)) ? size - 1 : -1;
+    };
+
+    x_mask = address_mask(u_mode, image_width);
+    y_mask = address_mask(v_mode, image_height);
+}
+
+Raytracing::ImageReader Raytracing::ImageReader::downsample() const
+{
+    ImageReader level(std::max(1, image_width / 2), std::max(1, image_height / 2), texel_format);
+    level.channels = channels;
+    level.bit_depth = bit_depth;
+    level.data_type = data_type;
+
+    // Odd sides repeat their last row or column
+    for (int y = 0; y < level.image_height; y++)
     {
-        const auto pixel = image_type == ImageType::LOADED ? &owned_uint8_data[index] : &external_uint8_data[index];
-        auto scale = 1.0f / 255.0f;
-        pixel_color = vec3(pixel[0], pixel[1], pixel[2]) * scale;
-        break;
+        for (int x = 0; x < level.image_width; x++)
+        {
+            float sum[4] = { 0, 0, 0, 0 };
+
+            for (int dy = 0; dy < 2; dy++)
+            {
+                for (int dx = 0; dx < 2; dx++)
+                {
+                    float rgba[4];
+                    texel_rgba(std::min(2 * x + dx, image_width - 1), std::min(2 * y + dy, image_height - 1), rgba);
+
+                    for (int c = 0; c < 4; c++)
+                        sum[c] += rgba[c];
+                }
+            }
+
+            for (int c = 0; c < 4; c++)
+                sum[c] *= 0.25f;
+
+            level.store_texel(x, y, sum);
+        }
     }
-    case ImageDataType::UINT16_T:
+
+    level.set_address_modes(u_address_mode, v_address_mode);
+
+    return level;
+}
+
+void Raytracing::ImageReader::allocate(int width, int height, TexelFormat format)
+{
+    texel_format = format;
+
+    // Whole tiles, the texels past the right and bottom edges are never read
+    tiles_per_row = (std::max(width, 1) + tile_mask) >> tile_shift;
+    const int tile_rows = (std::max(height, 1) + tile_mask) >> tile_shift;
+    const size_t texel_count = size_t(tiles_per_row) * tile_rows << (2 * tile_shift);
+
+    rgba8_texels.clear();
+    rgba16f_texels.clear();
+
+    if (format == TexelFormat::RGBA8)
+        rgba8_texels.resize(texel_count);
+    else
+        rgba16f_texels.resize(texel_count);
+
+    if (width == 0 || height == 0)
     {
-        const auto pixel = image_type == ImageType::LOADED ? &owned_uint16_data[index] : &external_uint16_data[index];
-        auto scale = 1.0f / 65535.0f;
-        pixel_color = vec3(pixel[0], pixel[1], pixel[2]) * scale;
-        break;
+        const float magenta[4] = { float(MAGENTA.x), float(MAGENTA.y), float(MAGENTA.z), 1.0f };
+        store_texel(0, 0, magenta);
     }
-    case ImageDataType::FLOAT:
+
+    set_address_modes(u_address_mode, v_address_mode);
+}
+
+template <typename T>
+void Raytracing::ImageReader::store_pixels(const T* pixels, int pixel_channels, float scale, const float* color_table)
+{
+    // Alpha is never gamma encoded, only the colors use the table
+    auto color_value = [&](T value)
     {
-        const auto pixel = image_type == ImageType::LOADED ? &owned_float_data[index] : &external_float_data[index];
-        pixel_color = vec3(pixel[0], pixel[1], pixel[2]);
-        break;
-    }
+        if constexpr (std::is_integral_v<T>)
+        {
+            if (color_table)
+                return color_table[value];
+        }
+
+        return float(value) * scale;
+    };
+
+    for (int y = 0; y < image_height; y++)
+    {
+        for (int x = 0; x < image_width; x++)
+        {
+            const T* pixel = &pixels[(size_t(y) * image_width + x) * pixel_channels];
+            float rgba[4];
+
+            // Grey sources fill the three color channels, missing alpha is opaque
+            if (pixel_channels < 3)
+            {
+                rgba[0] = rgba[1] = rgba[2] = color_value(pixel[0]);
+                rgba[3] = pixel_channels == 2 ? float(pixel[1]) * scale : 1.0f;
+            }
+            else
+            {
+                rgba[0] = color_value(pixel[0]);
+                rgba[1] = color_value(pixel[1]);
+                rgba[2] = color_value(pixel[2]);
+                rgba[3] = pixel_channels == 4 ? float(pixel[3]) * scale : 1.0f;
+            }
+
+            store_texel(x, y, rgba);
+        }
     }
+}
+
+void Raytracing::ImageReader::store_texel(int x, int y, const float rgba[4])
+{
+    const size_t index = texel_index(x, y);
+
+    if (texel_format == TexelFormat::RGBA8)
+    {
+        uint32_t texel = 0;
+        for (int c = 0; c < 4; c++)
+            texel |= uint32_t(std::clamp(rgba[c], 0.0f, 1.0f) * 255.0f + 0.5f) << (8 * c);
 
-    return pixel_color;
+        rgba8_texels[index] = texel;
+    }
+    else
+    {
+        rgba16f_texels[index] = encode_half4(rgba);
+    }
 }
 
-uint8_t* Raytracing::ImageReader::convert_float_to_uint8(const float* float_data, size_t count)
+void Raytracing::ImageReader::texel_rgba(int x, int y, float rgba[4]) const
 {
-    uint8_t* result = new uint8_t[count];
+    const size_t index = texel_index(x, y);
 
-    for (size_t i = 0; i < count; ++i)
+    if (texel_format == TexelFormat::RGBA8)
+    {
+        const uint32_t texel = rgba8_texels[index];
+        for (int c = 0; c < 4; c++)
+            rgba[c] = float((texel >> (8 * c)) & 0xff) / 255.0f;
+    }
+    else
     {
-        float clamped = std::clamp(float_data[i], 0.0f, 1.0f);
-        result[i] = static_cast<uint8_t>(clamped * 255.0f + 0.5f); // +0.5f for rounding
+        decode_half4(rgba16f_texels[index], rgba);
     }
+}
+
+size_t Raytracing::ImageReader::texel_index(int x, int y) const
+{
+    const size_t tile = size_t(y >> tile_shift) * tiles_per_row + (x >> tile_shift);
+
+    return (tile << (2 * tile_shift)) + ((y & tile_mask) << tile_shift) + (x & tile_mask);
+}
 
-    return result;
+uint64_t Raytracing::ImageReader::encode_half4(const float rgba[4])
+{
+    // Values past the largest half would become infinite
+    float clamped[4];
+    for (int c = 0; c < 4; c++)
+        clamped[c] = std::clamp(rgba[c], -65504.0f, 65504.0f);
+
+#if RAYTRACING_SIMD_F16C
+    __m128i halves = _mm_cvtps_ph(_mm_loadu_ps(clamped), _MM_FROUND_TO_NEAREST_INT);
+    return uint64_t(_mm_cvtsi128_si64(halves));
+#else
+    uint64_t texel = 0;
+    for (int c = 0; c < 4; c++)
+        texel |= uint64_t(float_to_half(clamped[c])) << (16 * c);
+
+    return texel;
+#endif
+}
+
+void Raytracing::ImageReader::decode_half4(uint64_t texel, float rgba[4])
+{
+#if RAYTRACING_SIMD_F16C
+    _mm_storeu_ps(rgba, _mm_cvtph_ps(_mm_cvtsi64_si128(int64_t(texel))));
+#else
+    for (int c = 0; c < 4; c++)
+        rgba[c] = half_to_float(uint16_t(texel >> (16 * c)));
+#endif
 }
 
-uint16_t* Raytracing::ImageReader::convert_float_to_uint16(const float* float_data, size_t count)
+uint16_t Raytracing::ImageReader::float_to_half(float value)
 {
-    uint16_t* result = new uint16_t[count];
+    // Round to nearest even (F. Giesen's float_to_half_fast3_rtne), inputs are finite and within the half range
+    uint32_t bits = std::bit_cast<uint32_t>(value);
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
 
-    for (size_t i = 0; i < count; ++i)
+    uint16_t half;
+
+    if (bits < 0x38800000u)
+    {
+        // Subnormal or zero, the addition aligns the mantissa and rounds it
+        float aligned = std::bit_cast<float>(bits) + 0.5f;
+        half = uint16_t(std::bit_cast<uint32_t>(aligned) - 0x3f000000u);
+    }
+    else
     {
-        float clamped = std::clamp(float_data[i], 0.0f, 1.0f);
-        result[i] = static_cast<uint16_t>(clamped * 65535.0f + 0.5f); // +0.5f for rounding
+        const uint32_t mantissa_odd = (bits >> 13) & 1;
+        bits += 0xc8000fffu;    // Rebias the exponent from 127 to 15 and round
+        bits += mantissa_odd;
+        half = uint16_t(bits >> 13);
     }
 
-    return result;
+    return half | uint16_t(sign >> 16);
+}
+
+float Raytracing::ImageReader::half_to_float(uint16_t value)
+{
+    // Shift the exponent and mantissa into place and rebias with one multiplication, which also normalizes subnormals
+    const float magnitude = std::bit_cast<float>(uint32_t(value & 0x7fffu) << 13) * 0x1p112f;
+
+    return std::bit_cast<float>(std::bit_cast<uint32_t>(magnitude) | (uint32_t(value & 0x8000u) << 16));
+}
+
+const vector<float>& Raytracing::ImageReader::linear_table(int bit_depth)
+{
+    // Same curve and rounding as stbi_loadf (gamma 2.2 computed in double), built once for every thread
+    auto build_table = [](int levels)
+    {
+        vector<float> table(levels);
+        const float max_value = float(levels - 1);
+
+        for (int i = 0; i < levels; i++)
+            table[i] = float(std::pow(double(float(i) / max_value), double(2.2f)));
+
+        return table;
+    };
+
+    static const vector<float> table8 = build_table(1 << 8);
+    static const vector<float> table16 = build_table(1 << 16);
+
+    return bit_depth == 16 ? table16 : table8;
 }
 
 int Raytracing::ImageReader::width()  const
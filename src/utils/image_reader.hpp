@@ -14,10 +14,11 @@ namespace Raytracing
         FLOAT
     };
 
-    enum class ImageType
+    // Layout of the texels kept by an ImageReader, whatever the format of the source
+    enum class TexelFormat
     {
-        PARSED, // Image was parsed from the webgpu engine framework
-        LOADED // Image was loaded from a file
+        RGBA8,      // 8-bit sources, four bytes per texel
+        RGBA16F     // 16-bit and HDR sources, four half floats per texel
     };
 
     struct ImageReader
@@ -33,45 +34,62 @@ namespace Raytracing
         ImageReader(const char* image_filename); // Loading constructor
         ImageReader(const sTextureData& tex_data); // Parsing constructor
 
-        ~ImageReader();
-
         int width()  const;
         int height() const;
 
         // Returns true if the load succeeded.
-        // Loads the linear (gamma=1) image data from the given file name.
-        // The resulting data buffer points to the channel values of the first pixel.
-        // Pixels are contiguous, going left to right for the width of the image,
-        // followed by the next row below, for the full height of the image.
+        // Decodes the image file at its own bit depth and converts it to linear (gamma=1) data in the texel layout.
+        // Safe to call on different readers from several threads.
         bool load(const string& filename);
 
-        // Reads texture data and returns the address of the three RGB bytes [0.0, 1.0] of the pixel at x,y.
-        // If there is no image data, returns magenta.
+        // Reads the linear RGB [0.0, 1.0] (higher for HDR images) of the texel at x,y. Coordinates outside the image
+        // repeat on power of two sides set to repeat and clamp to the edge otherwise. If there is no image data,
+        // returns magenta.
         const color pixel_data(int x, int y) const;
 
-        static uint8_t* convert_float_to_uint8(const float* float_data, size_t count);
-        static uint16_t* convert_float_to_uint16(const float* float_data, size_t count);
+        void set_address_modes(WGPUAddressMode u_mode, WGPUAddressMode v_mode);
+        ImageReader downsample() const;     // Next mip level, a 2x2 box filter of this one with the same layout and address modes
 
     private:
-        bool            is_linear;                          // Is the image linear (gamma = 1) or not (gamma != 1)
-        int             channels;                           // Number of channels (1, 3, 4, etc.)
-        int             bit_depth;                          // Number of bits per channel (8 bits, 16 bits, 32 bits, etc.)
-        ImageType       image_type;                         // Type of the image (parsed or loaded)
-        ImageDataType   data_type;                          // Data type of the image data based on the bit depth
+        // Texels are stored in 4x4 tiles, row-major inside each tile and tiles row-major across the image. An RGBA8
+        // tile fills one 64 byte cache line and an RGBA16F one two, so neighbouring texels in both directions are
+        // a few cache lines apart instead of a scanline.
+        static constexpr int tile_shift = 2;
+        static constexpr int tile_mask = (1 << tile_shift) - 1;
+
+        int             channels = 0;                       // Number of channels of the source (1, 3, 4, etc.)
+        int             bit_depth = 0;                      // Number of bits per channel of the source (8 bits, 16 bits, 32 bits, etc.)
+        ImageDataType   data_type = ImageDataType::UINT8_T; // Data type of the source based on the bit depth
         int             image_width = 0;                    // Loaded image width
         int             image_height = 0;                   // Loaded image height
-        int             bytes_per_pixel = 0;                // Number of bytes per pixel (num_channels x bit_depth) 
-        int             bytes_per_scanline = 0;             // Number of bytes per scanline (width x bytes_per_pixel)
-
-        // Owned data (loaded from file)
-        uint8_t* owned_uint8_data = nullptr;                // Linear 8-bit pixel data
-        uint16_t* owned_uint16_data = nullptr;              // Linear 16-bit pixel data
-        float* owned_float_data = nullptr;                  // Linear 32-bit pixel data
-
-        // Parsed data (from the webgpu engine framework)
-        const uint8_t* external_uint8_data = nullptr;       // Linear 8-bit pixel data
-        const uint16_t* external_uint16_data = nullptr;     // Linear 16-bit pixel data
-        const float* external_float_data = nullptr;         // Linear 32-bit pixel data
+
+        // Texel storage
+        TexelFormat     texel_format = TexelFormat::RGBA8;
+        int             tiles_per_row = 1;
+        vector<uint32_t> rgba8_texels;                      // R in the low byte
+        vector<uint64_t> rgba16f_texels;                    // R in the low half
+
+        // Addressing, coordinates are masked and then clamped so a fetch never branches on the wrap mode
+        WGPUAddressMode u_address_mode = WGPUAddressMode_ClampToEdge;
+        WGPUAddressMode v_address_mode = WGPUAddressMode_ClampToEdge;
+        int             x_mask = -1;                        // width - 1 when repeating a power of two width, all bits otherwise
+        int             y_mask = -1;
+
+        ImageReader(int width, int height, TexelFormat format);    // Blank image, used by downsample
+
+        void allocate(int width, int height, TexelFormat format);  // Storage for the texels, a single magenta one when the image is empty
+        template <typename T>
+        void store_pixels(const T* pixels, int pixel_channels, float scale, const float* color_table = nullptr);   // Converts row-major source pixels into the texel layout, integer colors through color_table when given
+        void store_texel(int x, int y, const float rgba[4]);
+        void texel_rgba(int x, int y, float rgba[4]) const;
+        size_t texel_index(int x, int y) const;
+
+        static const vector<float>& linear_table(int bit_depth);  // Linear value of every 8 or 16 bit gamma encoded level
+
+        static uint64_t encode_half4(const float rgba[4]);
+        static void decode_half4(uint64_t texel, float rgba[4]);
+        static uint16_t float_to_half(float value);
+        static float half_to_float(uint16_t value);
 
         ImageDataType get_data_type(int bit_depth) const;
         Raytracing::ImageDataType get_data_type(const string& filename) const;
@@ -142,7 +142,12 @@ void Raytracing::ImageWriter::write_pixel(const int pixel_row, const int pixel_c
 void Raytracing::ImageWriter::save()
 {
     // Get current date and time
-    name = get_current_timestamp();
+    save(get_current_timestamp());
+}
+
+void Raytracing::ImageWriter::save(const string& image_name)
+{
+    name = image_name;
 
     // Set formatted image name 
     full_name = name + format_str;
@@ -181,6 +186,105 @@ void Raytracing::ImageWriter::save()
     size = file_size(get_file_size(image_path));
 }
 
+void Raytracing::ImageWriter::save_sample_map(const vector<int>& pixel_samples, int max_samples) const
+{
+    if (pixel_samples.size() != size_t(width) * height || max_samples <= 0)
+    {
+        Logger::error("ImageWriter", "Samples map does not match the image, it was not written.");
+        return;
+    }
+
+    // White pixels took every sample
+    vector<uint8_t> map(pixel_samples.size());
+    for (size_t i = 0; i < pixel_samples.size(); i++)
+        map[i] = uint8_t(std::clamp(255.0 * pixel_samples[i] / max_samples + 0.5, 0.0, 255.0));
+
+    string map_name = name + "_spp.png";
+    string map_path = output_destination + "\\" + map_name;
+
+    if (stbi_write_png(map_path.c_str(), width, height, 1, map.data(), width))
+        Logger::info("ImageWriter", "Samples map successfully written: " + map_name);
+    else
+        Logger::error("ImageWriter", "Failed to write samples map: " + map_name);
+}
+
+void Raytracing::ImageWriter::save_layers(const vector<ImageLayer>& layers) const
+{
+    const size_t total_pixels = size_t(width) * height;
+
+    // Channels are named layer.channel, the main layer keeps the bare names
+    vector<pair<string, const float*>> channels;
+
+    for (const auto& layer : layers)
+    {
+        if (layer.channels.size() != layer.planes.size())
+        {
+            Logger::error("ImageWriter", "Layer " + layer.name + " has a different number of channels and planes, layers were not written.");
+            return;
+        }
+
+        for (size_t c = 0; c < layer.channels.size(); c++)
+        {
+            if (layer.planes[c].size() != total_pixels)
+            {
+                Logger::error("ImageWriter", "Layer " + layer.name + " does not match the image size, layers were not written.");
+                return;
+            }
+
+            string channel_name = layer.name.empty() ? layer.channels[c] : layer.name + "." + layer.channels[c];
+            channels.emplace_back(channel_name, layer.planes[c].data());
+        }
+    }
+
+    // EXR readers expect the channel list sorted by name
+    std::ranges::sort(channels, {}, &pair<string, const float*>::first);
+
+    const int num_channels = int(channels.size());
+    vector<const float*> image_ptr(num_channels);
+    vector<EXRChannelInfo> channel_infos(num_channels);
+
+    EXRHeader header; InitEXRHeader(&header);
+    EXRImage exr_image; InitEXRImage(&exr_image);
+
+    for (int i = 0; i < num_channels; i++)
+    {
+        image_ptr[i] = channels[i].second;
+        strncpy_s(channel_infos[i].name, channels[i].first.c_str(), 255);
+    }
+
+    exr_image.num_channels = num_channels;
+    exr_image.images = (unsigned char**)image_ptr.data();
+    exr_image.width = width;
+    exr_image.height = height;
+
+    header.channels = channel_infos.data();
+    header.num_channels = num_channels;
+
+    // Depth and IDs need full precision, every channel is kept as 32 bit float
+    vector<int> pixel_types(num_channels, TINYEXR_PIXELTYPE_FLOAT);
+    header.pixel_types = pixel_types.data();
+    header.requested_pixel_types = pixel_types.data();
+    header.compression_type = TINYEXR_COMPRESSIONTYPE_PIZ;
+
+    string layers_name = name + "_aovs.exr";
+    string layers_path = output_destination + "\\" + layers_name;
+
+    const char* err = nullptr;
+    int success = SaveEXRImageToFile(&exr_image, &header, layers_path.c_str(), &err);
+
+    if (success != TINYEXR_SUCCESS)
+    {
+        Logger::error("ImageWriter", "Failed to write layers: " + layers_name + (err ? " (" + string(err) + ")" : ""));
+
+        if (err)
+            FreeEXRErrorMessage(err);
+
+        return;
+    }
+
+    Logger::info("ImageWriter", "Layers successfully written: " + layers_name + " (" + std::to_string(num_channels) + " channels)");
+}
+
 int Raytracing::ImageWriter::get_width() const
 {
     return width;
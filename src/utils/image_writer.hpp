@@ -36,6 +36,14 @@ enum IMAGE_PIXEL_TYPE
 
 namespace Raytracing
 {
+    // Channels written together under one name in a multi-layer image
+    struct ImageLayer
+    {
+        string name;                        // Empty for the main color layer
+        vector<string> channels;            // Channel names inside the layer (R, G, B, Z...)
+        vector<vector<float>> planes;       // One plane per channel (row-major)
+    };
+
     struct ImageWriter
     {
     public:
@@ -57,7 +65,10 @@ namespace Raytracing
         void initialize(const RendererSettings& settings);
 
         void write_pixel(const int pixel_row, const int pixel_column, const tuple<float, float, float, float> color_tuple);
-        void save();
+        void save();                                // Named after the current timestamp
+        void save(const string& image_name);        // Overwrites any previous image with that name
+        void save_sample_map(const vector<int>& pixel_samples, int max_samples) const;   // Grayscale PNG of the samples taken per pixel, named after the last saved image
+        void save_layers(const vector<ImageLayer>& layers) const;                       // Multi-layer 32 bit float EXR, named after the last saved image
 
         int get_width() const;
         int get_height() const;
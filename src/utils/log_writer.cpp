@@ -67,7 +67,15 @@ void LogWriter::write(const Scene& scene, const Camera& camera, ImageWriter& ima
     log << "## Scene 🌆\n\n";
     log << "**Name:** " << scene.name << "  \n";
     log << "**Background Color:** " << scene.background << " \n";
-    log << "**Samples per Pixel:** " << scene.samples_per_pixel << "  \n";
+    if (scene.time_budget > 0)
+        log << "**Time Budget:** " << scene.time_budget << " s, " << camera.average_samples_per_pixel << " samples per pixel reached  \n";
+    else
+        log << "**Samples per Pixel:** " << scene.samples_per_pixel << "  \n";
+    if (scene.adaptive_sampling)
+        log << "**Adaptive Sampling:** " << scene.min_samples_per_pixel << " to " << (scene.time_budget > 0 ? string("unlimited") : std::to_string(scene.samples_per_pixel)) << " samples, " << camera.average_samples_per_pixel << " on average (threshold " << scene.adaptive_threshold << ")  \n";
+    if (scene.progressive || scene.time_budget > 0)
+        log << "**Progressive:** " << camera.passes << " passes of " << scene.samples_per_pass << " samples  \n";
+    log << "**Sampler:** " << magic_enum::enum_name(camera.sampler_type) << "  \n";
     log << "**Max Ray Bounces:** " << scene.bounce_max_depth << "  \n";
     log << "**Build Time:** " << scene.build_chrono.elapsed_to_string() << "\n\n";
 
@@ -81,6 +89,7 @@ void LogWriter::write(const Scene& scene, const Camera& camera, ImageWriter& ima
     log << "## Primitives 🔵\n\n";
     log << "**Spheres:** " << scene.stats.spheres << "  \n";
     log << "**Quads:** " << scene.stats.quads << "  \n";
+    log << "**Boxes:** " << scene.stats.boxes << "  \n";
     log << "**Triangles:** " << scene.stats.triangles << "  \n";
     log << "**Total:** " << scene.stats.primitives << "  \n\n";
 
@@ -107,12 +116,15 @@ void LogWriter::write(const Scene& scene, const Camera& camera, ImageWriter& ima
     // Render Benchmark
     log << "## Render Benchmark 🎇\n\n";
     log << "**Rendering Time:** " << camera.render_chrono.elapsed_to_string() << " \n";
+    if (scene.denoise)
+        log << "**Denoising Time:** " << camera.denoise_chrono.elapsed_to_string() << " (" << scene.denoise_iterations << " iterations) \n";
     log << "**Rays:**\n";
     log << "    - **Primary Rays:** " << camera.primary_rays << "  \n";
     log << "    - **Background Rays:** " << camera.background_rays << "  \n";
     log << "    - **Light Rays:** " << camera.light_rays << "  \n";
     log << "    - **Reflected Rays:** " << camera.reflected_rays << "  \n";
     log << "    - **Refracted Rays:** " << camera.refracted_rays << "  \n";
+    log << "    - **Shadow Rays:** " << camera.shadow_rays << "  \n";
     log << "    - **Unknwon Rays:** " << camera.unknwon_rays << "  \n";
     log << "    - **Total Rays Casted:** " << camera.rays_casted << "  \n";
     log << "    - **Average Rays per Second:** " << camera.average_rays_per_second << "  \n\n";
@@ -8,6 +8,8 @@
 #include "hittables/hittable_list.hpp"
 #include "materials/material.hpp"
 #include "materials/texture.hpp"
+#include "materials/texture_cache.hpp"
+#include "core/arena.hpp"
 
 // External Headers
 #include "tiny_obj_loader.h"
@@ -18,9 +20,11 @@ using Raytracing::Surface;
 using Raytracing::Material;
 using Raytracing::Lambertian;
 using Raytracing::ImageTexture;
+using Raytracing::TextureCache;
 using Raytracing::color;
+using Raytracing::make_arena_shared;
 
-shared_ptr<Mesh> load_obj(const string& filename)
+shared_ptr<Mesh> load_obj(const string& filename, TextureCache* textures)
 {
     // Create tiny obj reader object
     tinyobj::ObjReaderConfig reader_config;
@@ -51,6 +55,10 @@ shared_ptr<Mesh> load_obj(const string& filename)
     // Mesh vars
     hittable_list surfaces;
 
+    // Textures of this file only, unless the caller shares its cache
+    TextureCache file_textures;
+    TextureCache& texture_cache = textures ? *textures : file_textures;
+
     // Loop over shapes (surfaces)
     for (size_t s = 0; s < shapes.size(); s++)
     {
@@ -72,14 +80,14 @@ shared_ptr<Mesh> load_obj(const string& filename)
                     static_cast<double>(materials[material_id].diffuse[1]),
                     static_cast<double>(materials[material_id].diffuse[2]));
 
-                material = make_shared<Lambertian>(albedo);
+                material = make_arena_shared<Lambertian>(albedo);
             }
             // Else, load diffuse texture
             else
             {
                 auto texture_name = materials[material_id].diffuse_texname;
-                auto texture = make_shared<ImageTexture>(obj_path_fs.parent_path().string() + "/" + texture_name);
-                material = make_shared<Lambertian>(texture);
+                auto texture = texture_cache.get(obj_path_fs.parent_path().string() + "/" + texture_name);
+                material = make_arena_shared<Lambertian>(texture);
             }
         }
 
@@ -140,7 +148,7 @@ shared_ptr<Mesh> load_obj(const string& filename)
             }
 
             // Create and add triangle
-            triangle = make_shared<Triangle>(vertices[0], vertices[1], vertices[2], material);
+            triangle = make_arena_shared<Triangle>(vertices[0], vertices[1], vertices[2], material);
             triangles.add(triangle);
 
             index_offset += fv;
@@ -150,12 +158,16 @@ shared_ptr<Mesh> load_obj(const string& filename)
         }
 
         // Create and add surface
-        surface = make_shared<Surface>(triangles, material);
+        surface = make_arena_shared<Surface>(triangles, material);
         surfaces.add(surface);
     }
 
+    // Decode the images now unless the caller loads them with the rest of its textures
+    if (!textures)
+        file_textures.load();
+
     // Create mesh
-    auto mesh = make_shared<Mesh>(filename, surfaces);
+    auto mesh = make_arena_shared<Mesh>(filename, surfaces);
 
     return mesh;
 }
@@ -7,7 +7,10 @@
 namespace Raytracing
 {
     class Mesh;
+    class TextureCache;
 }
 
-shared_ptr<Raytracing::Mesh> load_obj(const string& filename);
+// Shapes that use the same texture file share one texture, across calls too when they are given the same cache.
+// The textures of a given cache stay empty until its owner calls TextureCache::load.
+shared_ptr<Raytracing::Mesh> load_obj(const string& filename, Raytracing::TextureCache* textures = nullptr);
 
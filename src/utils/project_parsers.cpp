@@ -6,11 +6,13 @@
 #include "math/matrix.hpp"
 #include "materials/material.hpp"
 #include "materials/texture.hpp"
+#include "materials/texture_cache.hpp"
 #include "graphics/color.hpp"
 #include "hittables/triangle.hpp"
 #include "hittables/hittable_list.hpp"
 #include "graphics/texture.h"
 #include "graphics/camera.hpp"
+#include "core/arena.hpp"
 
 // Framework headers
 #include "framework/nodes/mesh_instance_3d.h"
@@ -22,35 +24,52 @@ using Raytracing::Mesh;
 using Raytracing::Matrix44;
 using Raytracing::ImageTexture;
 using Raytracing::Lambertian;
+using Raytracing::DiffuseLight;
 using Raytracing::color;
 using Raytracing::normal;
 using Raytracing::CameraData;
 using Raytracing::SkyboxTexture;
+using Raytracing::MemoryArena;
+using Raytracing::TextureCache;
+using Raytracing::make_arena_shared;
 
-shared_ptr<ParsedScene> parse_nodes(const vector<Node*>& nodes, const bool use_bvh)
+shared_ptr<ParsedScene> parse_nodes(const vector<Node*>& nodes, const bool use_bvh, const bool huge_pages)
 {
     shared_ptr<ParsedScene> parsed_scene;
     vector<shared_ptr<Mesh>> meshes;
 
+    // Every object parsed below is placed in the scene arena and released with it
+    auto arena = make_shared<MemoryArena>(MemoryArena::default_block_size, huge_pages);
+    MemoryArena::Scope arena_scope(arena);
+
+    // Textures shared by several surfaces, even of different nodes, are only loaded once
+    TextureCache textures;
+
     for (auto node : nodes)
     {
         // Skip skybox node
         if (node->get_node_type() == "Environment3D")
             continue;
 
-        auto parsed_node = parse_node(node, use_bvh);
+        auto parsed_node = parse_node(node, use_bvh, textures);
         auto node_meshes = parsed_node.meshes;
 
         if (!node_meshes.empty())
             meshes.insert(meshes.end(), node_meshes.begin(), node_meshes.end());
     }
 
-    parsed_scene = make_shared<ParsedScene>(meshes);
+    // Decode the images of every surface at once
+    textures.load();
+
+    parsed_scene = make_shared<ParsedScene>(meshes, arena);
+
+    Logger::info("PARSER", "Scene arena: " + arena->to_string());
+    Logger::info("PARSER", std::to_string(textures.size()) + " textures loaded, " + std::to_string(textures.reused()) + " reused.");
 
     return parsed_scene;
 }
 
-ParsedNode parse_node(Node* node, const bool use_bvh)
+ParsedNode parse_node(Node* node, const bool use_bvh, TextureCache& textures)
 {
     ParsedNode parsed_node;
     vector<shared_ptr<Mesh>> meshes;
@@ -72,12 +91,12 @@ ParsedNode parse_node(Node* node, const bool use_bvh)
 
             for (auto surface : scene_mesh->get_surfaces())
             {
-                auto new_surface = parse_surface(surface, model, use_bvh);
+                auto new_surface = parse_surface(surface, model, use_bvh, textures);
                 surfaces.add(new_surface);
             }
 
             // Mesh
-            auto new_mesh = make_shared<Mesh>(name, surfaces, model, use_bvh);
+            auto new_mesh = make_arena_shared<Mesh>(name, surfaces, model, use_bvh);
 
             meshes.push_back(new_mesh);
         }
@@ -115,7 +134,7 @@ SkyboxTexture* parse_skybox(Environment3D* skybox)
     return parsed_skybox_texture;
 }
 
-shared_ptr<Raytracing::Surface> parse_surface(Surface* surface, const Raytracing::Matrix44& mesh_model, const bool use_bvh)
+shared_ptr<Raytracing::Surface> parse_surface(Surface* surface, const Raytracing::Matrix44& mesh_model, const bool use_bvh, TextureCache& textures)
 {
     // Material
     shared_ptr<Raytracing::Material> parsed_material;
@@ -123,21 +142,48 @@ shared_ptr<Raytracing::Surface> parse_surface(Surface* surface, const Raytracing
 
     // Texture
     Texture* diffuse_texture = material->get_diffuse_texture();
+    Texture* emissive_texture = material->get_emissive_texture();
+
+    // Emission
+    const color emissive = color(material->get_emissive());
+
+    // Diffuse surface
+    shared_ptr<Lambertian> diffuse_material;
 
     // Load diffuse texture
     if (diffuse_texture)
     {
-        sTextureData& texture_data = diffuse_texture->get_texture_data();
-        pair<WGPUAddressMode, WGPUAddressMode> uv_wrap_modes = make_pair(diffuse_texture->get_wrap_u(), diffuse_texture->get_wrap_v());
-
-        auto texture = make_shared<ImageTexture>(texture_data, uv_wrap_modes);
-        parsed_material = make_shared<Lambertian>(texture);
+        auto texture = textures.get(diffuse_texture);
+        diffuse_material = make_arena_shared<Lambertian>(texture);
     }
     // If there is no diffuse texture, create one
     else
     {
         const color albedo = color(material->get_color());
-        parsed_material = make_shared<Lambertian>(albedo);
+        diffuse_material = make_arena_shared<Lambertian>(albedo);
+    }
+
+    // Emissive materials become area lights, their triangles are sampled by next event estimation. The emission is
+    // added on top of the diffuse surface, so masked emitters still show it where the mask is dark; only black
+    // untextured bases are left out and end the path as pure lights.
+    if (emissive.max_component() > 0)
+    {
+        if (!diffuse_texture && color(material->get_color()).max_component() <= 0)
+            diffuse_material = nullptr;
+
+        if (emissive_texture)
+        {
+            shared_ptr<Raytracing::Texture> texture = textures.get(emissive_texture);
+            parsed_material = make_arena_shared<DiffuseLight>(texture, emissive, diffuse_material);
+        }
+        else
+        {
+            parsed_material = make_arena_shared<DiffuseLight>(emissive, diffuse_material);
+        }
+    }
+    else
+    {
+        parsed_material = diffuse_material;
     }
 
     // Triangles
@@ -173,7 +219,7 @@ shared_ptr<Raytracing::Surface> parse_surface(Surface* surface, const Raytracing
 			// Create and add triangle
 			if ((i + 1) % 3 == 0)
 			{
-				auto triangle = make_shared<Triangle>(triangle_vertices[0], triangle_vertices[1], triangle_vertices[2], parsed_material, mesh_model, false);
+				auto triangle = make_arena_shared<Triangle>(triangle_vertices[0], triangle_vertices[1], triangle_vertices[2], parsed_material, mesh_model, false);
 				triangles.add(triangle);
 			}
         }
@@ -211,14 +257,14 @@ shared_ptr<Raytracing::Surface> parse_surface(Surface* surface, const Raytracing
 			// Create and add triangle
 			if ((i + 1) % 3 == 0)
 			{
-				auto triangle = make_shared<Triangle>(triangle_vertices[0], triangle_vertices[1], triangle_vertices[2], parsed_material, mesh_model, false);
+				auto triangle = make_arena_shared<Triangle>(triangle_vertices[0], triangle_vertices[1], triangle_vertices[2], parsed_material, mesh_model, false);
 				triangles.add(triangle);
 			}
         }
     }
 
     // Parsed surface
-    auto parsed_surface = make_shared<Raytracing::Surface>(triangles, parsed_material, nullopt, use_bvh);
+    auto parsed_surface = make_arena_shared<Raytracing::Surface>(triangles, parsed_material, nullopt, use_bvh);
 
     return parsed_surface;
 }
@@ -20,22 +20,25 @@ namespace Raytracing
     class Matrix44;
     struct CameraData;
     class SkyboxTexture;
+    class MemoryArena;
+    class TextureCache;
 }
 
 struct ParsedScene
 {
     vector<shared_ptr<Raytracing::Mesh>> meshes;
+    shared_ptr<Raytracing::MemoryArena> arena;   // Owns the parsed meshes, surfaces, triangles and materials
 
     ParsedScene() = default;
-    ParsedScene(const vector<shared_ptr<Raytracing::Mesh>>& m) : meshes(m) {}
+    ParsedScene(const vector<shared_ptr<Raytracing::Mesh>>& m, const shared_ptr<Raytracing::MemoryArena>& arena = nullptr) : meshes(m), arena(arena) {}
 };
 
 using ParsedNode = ParsedScene;
 
 // Object parsers
-shared_ptr<ParsedScene> parse_nodes(const vector<Node*>& nodes, const bool use_bvh);
-ParsedScene parse_node(Node* node, const bool use_bvh);
-shared_ptr<Raytracing::Surface> parse_surface(Surface* surface, const Raytracing::Matrix44& model, const bool use_bvh);
+shared_ptr<ParsedScene> parse_nodes(const vector<Node*>& nodes, const bool use_bvh, const bool huge_pages = false);
+ParsedScene parse_node(Node* node, const bool use_bvh, Raytracing::TextureCache& textures);
+shared_ptr<Raytracing::Surface> parse_surface(Surface* surface, const Raytracing::Matrix44& model, const bool use_bvh, Raytracing::TextureCache& textures);
 Raytracing::SkyboxTexture* parse_skybox(Environment3D* skybox);
 optional<pair<double, double>> parse_texture_uvs(const optional<pair<double, double>>& uvs, const pair<WGPUAddressMode, WGPUAddressMode>& uv_wrap_mode);
 double parse_uv(double coord, WGPUAddressMode wrap_mode);
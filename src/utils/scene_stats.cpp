@@ -6,6 +6,7 @@
 #include "hittables/mesh.hpp"
 #include "materials/material.hpp"
 #include "hittables/bvh.hpp"
+#include "hittables/sphere_cloud.hpp"
 
 // Usings
 using Raytracing::Mesh;
@@ -21,16 +22,16 @@ int scene_stats::get_bvh_depth(const shared_ptr<Hittable> object)
     switch (object->get_type())
     {
    
-    case BOX:
-    {
-        auto box_ptr = std::dynamic_pointer_cast<Box>(object);
-        return box_ptr->get_stats().bvh_depth;
-    }
     case MESH:
     {
         auto mesh_ptr = std::dynamic_pointer_cast<Mesh>(object);
         return mesh_ptr->get_stats().bvh_depth;
     }
+    case SPHERE_CLOUD:
+    {
+        auto cloud_ptr = std::dynamic_pointer_cast<SphereCloud>(object);
+        return cloud_ptr->get_stats().bvh_depth;
+    }
     case BVH_NODE:
     {
         auto bvh_node_ptr = std::dynamic_pointer_cast<bvh_node>(object);
@@ -59,7 +60,7 @@ void scene_stats::add(const shared_ptr<Hittable> object)
         auto quad_ptr = std::dynamic_pointer_cast<Quad>(object);
 
         auto material = quad_ptr->get_material();
-        if (material->get_type() == DIFFUSE_LIGHT) emissives++;
+        if (material && material->get_type() == DIFFUSE_LIGHT) emissives++;
 
         quads++;
         primitives++;
@@ -68,15 +69,12 @@ void scene_stats::add(const shared_ptr<Hittable> object)
     case BOX:
     {
         auto box_ptr = std::dynamic_pointer_cast<Box>(object);
-        if (box_ptr->is_bvh())
-        {
-            *this += box_ptr->get_stats();
-        }
-        else
-        {
-            quads += 6;
-            primitives += 6;
-        }
+
+        auto material = box_ptr->get_material();
+        if (material && material->get_type() == DIFFUSE_LIGHT) emissives++;
+
+        boxes++;
+        primitives++;
         break;
     }
     case MESH:
@@ -95,6 +93,12 @@ void scene_stats::add(const shared_ptr<Hittable> object)
         }
         break;
     }
+    case SPHERE_CLOUD:
+    {
+        auto cloud_ptr = std::dynamic_pointer_cast<SphereCloud>(object);
+        *this += cloud_ptr->get_stats();
+        break;
+    }
     case BVH_NODE:
     {
         auto bvh_node_ptr = std::dynamic_pointer_cast<bvh_node>(object);
@@ -109,6 +113,7 @@ scene_stats& scene_stats::operator+=(const scene_stats& s)
 {
     spheres += s.spheres;
     quads += s.quads;
+    boxes += s.boxes;
     triangles += s.triangles;
     primitives += s.primitives;
     emissives += s.emissives;
@@ -17,6 +17,7 @@ struct scene_stats
 {
     int spheres = 0;
     int quads = 0;
+    int boxes = 0;
     int triangles = 0;
     int primitives = 0;
     int emissives = 0;
@@ -257,14 +257,6 @@ inline vec3 sample_square() // Returns the vector to a random point in the [-.5,
     return vec3(random_number<double>() - 0.5, random_number<double>() - 0.5, 0);
 }
 
-inline vec3 sample_square_stratified(int sample_row, int sample_column, double pixel_sample_sqrt_inv) // Returns the vector to a random point in the square sub-pixel specified by grid indices sample_row and sample_column, for an idealized unit square pixel [-.5,-.5] to [+.5,+.5].
-{
-    auto px = ((sample_column + random_number<double>()) * pixel_sample_sqrt_inv) - 0.5;
-    auto py = ((sample_row + random_number<double>()) * pixel_sample_sqrt_inv) - 0.5;
-
-    return vec3(px, py, 0);
-}
-
 inline vec3 random_in_unit_disk() // Returns a random point in the unit disk.
 {
     while (true)
@@ -317,3 +309,55 @@ inline vec3 random_cosine_hemisphere_direction()
 
     return vec3(x, y, z);
 }
+
+// The functions below warp a sample point u of the unit square, given by a Sampler, instead of drawing random numbers.
+// They are continuous, so well distributed sample points stay well distributed after the mapping.
+
+inline vec3 sample_cosine_hemisphere(const pair<double, double>& u) // Cosine weighted direction around +z.
+{
+    auto phi = 2 * Raytracing::pi * u.first;
+    auto x = std::cos(phi) * std::sqrt(u.second);
+    auto y = std::sin(phi) * std::sqrt(u.second);
+    auto z = std::sqrt(1 - u.second);
+
+    return vec3(x, y, z);
+}
+
+inline vec3 sample_uniform_sphere(const pair<double, double>& u) // Uniformly distributed unit vector.
+{
+    auto z = 1 - 2 * u.first;
+    auto r = std::sqrt(std::max(0.0, 1 - z * z));
+    auto phi = 2 * Raytracing::pi * u.second;
+
+    return vec3(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+inline vec3 sample_concentric_disk(const pair<double, double>& u) // Point in the unit disk, Shirley-Chiu concentric mapping (squares map to rings without folding).
+{
+    auto x = 2 * u.first - 1;
+    auto y = 2 * u.second - 1;
+
+    if (x == 0 && y == 0)
+        return vec3(0, 0, 0);
+
+    double r, theta;
+
+    if (std::abs(x) > std::abs(y))
+    {
+        r = x;
+        theta = (Raytracing::pi / 4) * (y / x);
+    }
+    else
+    {
+        r = y;
+        theta = (Raytracing::pi / 2) - (Raytracing::pi / 4) * (x / y);
+    }
+
+    return vec3(r * std::cos(theta), r * std::sin(theta), 0);
+}
+
+inline point3 defocus_disk_sample(vec3 center, vec3 defocus_disk_u, vec3 defocus_disk_v, const pair<double, double>& u) // Point of the defocus disk given for the sample point u.
+{
+    auto p = sample_concentric_disk(u);
+    return center + (p[0] * defocus_disk_u) + (p[1] * defocus_disk_v);
+}